@@ -0,0 +1,26 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+// Every texture in the bindless table
+layout(set = 0, binding = 1) uniform sampler2D textures[];
+
+// Matches bindless.vert, with a texture index of 0xffffffff for untextured draws
+layout(push_constant) uniform DrawIndices {
+    uint bufferIndex;
+    uint dataIndex;
+    uint textureIndex;
+} drawIndices;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    if (drawIndices.textureIndex == 0xffffffffu) {
+        outColor = vec4(fragColor, 1.0);
+    } else {
+        outColor = texture(textures[drawIndices.textureIndex], fragTexCoord);
+    }
+}
@@ -0,0 +1,31 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+// Every buffer in the bindless table, read as vec4s
+layout(set = 0, binding = 0) readonly buffer Buffers {
+    vec4 data[];
+} buffers[];
+
+// Where this draw's data lives - xy is the offset and z the scale, matching test.vert
+// The texture is only read by bindless.frag, but both stages declare the whole block
+layout(push_constant) uniform DrawIndices {
+    uint bufferIndex;
+    uint dataIndex;
+    uint textureIndex;
+} drawIndices;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+void main() {
+    vec4 drawData = buffers[drawIndices.bufferIndex].data[drawIndices.dataIndex];
+    gl_Position = vec4(inPosition * drawData.z + drawData.xy, 0.0, 1.0);
+    fragColor = inColor;
+
+    // The triangle spans -0.5 to 0.5, so its texture covers it exactly
+    fragTexCoord = inPosition + 0.5;
+}
@@ -0,0 +1,25 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+// xy is the position, z the scale and w the bounding circle radius, matching cull.comp
+layout(set = 0, binding = 0) readonly buffer Instances {
+    vec4 instances[];
+};
+
+// View bounds are min xy then max xy in scene space, matching cull.comp
+layout(push_constant) uniform View {
+    vec4 viewBounds;
+} view;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    vec4 instance = instances[gl_InstanceIndex];
+    vec2 position = inPosition * instance.z + instance.xy;
+    vec2 normalized = (position - view.viewBounds.xy) / (view.viewBounds.zw - view.viewBounds.xy);
+    gl_Position = vec4(normalized * 2.0 - 1.0, 0.0, 1.0);
+    fragColor = inColor;
+}
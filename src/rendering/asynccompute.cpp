@@ -0,0 +1,81 @@
+#include "asynccompute.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    AsyncCompute::AsyncCompute(size_t frameCount)
+    {
+        auto& device = Context::get().getDevice();
+        auto queueFamily = device.getProperties().getComputeQueue();
+        if (!device.getHasAsyncCompute())
+        {
+            spdlog::warn("No separate compute queue, so compute work will queue up behind rendering");
+        }
+
+        spdlog::info("Creating async compute for {} frames on queue family {}", frameCount, queueFamily);
+
+        m_frames.resize(frameCount);
+        for (auto& i : m_frames)
+        {
+            vk::CommandPoolCreateInfo poolInfo;
+            poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+            poolInfo.queueFamilyIndex = queueFamily;
+            i.commandPool = Context::getVulkanDevice().createCommandPoolUnique(poolInfo);
+
+            // Freed along with the pool
+            i.commandBuffer = Context::getVulkanDevice().allocateCommandBuffers({
+                *i.commandPool,
+                vk::CommandBufferLevel::ePrimary,
+                1
+            }).front();
+        }
+    }
+
+    AsyncCompute::~AsyncCompute()
+    {
+        spdlog::info("Destroying async compute");
+    }
+
+
+    const vk::CommandBuffer& AsyncCompute::begin(size_t frameIndex)
+    {
+        m_currentFrame = frameIndex;
+        auto& frame = m_frames[frameIndex];
+
+        Context::getVulkanDevice().resetCommandPool(*frame.commandPool, {});
+        frame.commandBuffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+        return frame.commandBuffer;
+    }
+
+    void AsyncCompute::submit(SemaphoreWaits& waits, vk::PipelineStageFlags destinationStages)
+    {
+        PROFILE_FUNCTION();
+
+        auto& frame = m_frames[m_currentFrame];
+        frame.commandBuffer.end();
+
+        // Compute work starts with transfers or dispatches, which is where it waits on everything else
+        auto computeWaits = waits;
+        for (auto& i : computeWaits.stageMasks)
+        {
+            i = vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader;
+        }
+
+        auto& timeline = Context::get().getDevice().getComputeTimeline();
+        auto value = timeline.submit({frame.commandBuffer}, computeWaits);
+
+        // Waiting on the compute work transitively waits on everything it waited on, but the graphics
+        // queue still has to block at the earliest stage any of those waits covered, as barriers
+        // like upload acquires are ordered after them
+        for (auto& i : waits.stageMasks)
+        {
+            destinationStages |= i;
+        }
+        waits = {};
+        waits.add(timeline, value, destinationStages);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "timeline.hpp"
+
+namespace Rendering
+{
+    // Runs a frame's compute work on the device's compute queue, handing the results to the graphics
+    // submission through the compute timeline, so compute overlaps with rasterization instead of queueing
+    // behind it
+    // Each frame in flight gets its own command pool, which is free again once the frame's graphics
+    // timeline value has been waited on, as the graphics submission waits on the compute one
+    // Buffers crossing between the queues need to be shared with both queue families, or to have their
+    // ownership transferred by the caller
+    class AsyncCompute
+    {
+        public:
+            AsyncCompute(size_t frameCount);
+            ~AsyncCompute();
+
+            AsyncCompute(const AsyncCompute&) = delete;
+            AsyncCompute& operator=(const AsyncCompute&) = delete;
+
+            // Resets the frame's command pool and begins its command buffer, so the frame must have been
+            // waited on
+            const vk::CommandBuffer& begin(size_t frameIndex);
+
+            // Submits the current frame's compute work, taking over the waits the graphics submission had so
+            // far, like for uploads
+            // They're replaced by a single wait on the compute work, at the stages the graphics queue first
+            // uses its results as well as the stages the old waits were at
+            void submit(SemaphoreWaits& waits, vk::PipelineStageFlags destinationStages);
+
+        private:
+            struct Frame
+            {
+                Frame() :
+                    commandPool(nullptr)
+                {};
+
+                vk::UniqueCommandPool commandPool;
+                vk::CommandBuffer commandBuffer;
+            };
+
+            std::vector<Frame> m_frames;
+            size_t m_currentFrame = 0;
+    };
+}
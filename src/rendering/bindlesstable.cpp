@@ -0,0 +1,143 @@
+#include "bindlesstable.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "device.hpp"
+
+namespace Rendering
+{
+    BindlessTable::BindlessTable(Device& device, uint32_t maxBuffers, uint32_t maxTextures) :
+        m_device(device)
+    {
+        auto properties = m_device.getProperties();
+        auto& limits = properties.getDescriptorIndexingProperties();
+        m_bufferSlots.capacity = std::min({maxBuffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+            limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+        m_textureSlots.capacity = std::min({maxTextures, limits.maxDescriptorSetUpdateAfterBindSampledImages,
+            limits.maxDescriptorSetUpdateAfterBindSamplers, limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            limits.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+        // Both bindings are visible to every stage, so together they also count against each stage's
+        // total, which gets split in proportion to what was asked for
+        uint64_t totalSlots = static_cast<uint64_t>(m_bufferSlots.capacity) + m_textureSlots.capacity;
+        auto maxStageResources = limits.maxPerStageUpdateAfterBindResources;
+        if (totalSlots > maxStageResources)
+        {
+            m_bufferSlots.capacity = static_cast<uint32_t>(
+                static_cast<uint64_t>(maxStageResources) * m_bufferSlots.capacity / totalSlots);
+            m_textureSlots.capacity = maxStageResources - m_bufferSlots.capacity;
+        }
+
+        std::vector<vk::DescriptorSetLayoutBinding> bindings = {
+            {BufferBinding, vk::DescriptorType::eStorageBuffer, m_bufferSlots.capacity,
+                vk::ShaderStageFlagBits::eAll},
+            {TextureBinding, vk::DescriptorType::eCombinedImageSampler, m_textureSlots.capacity,
+                vk::ShaderStageFlagBits::eAll}
+        };
+        std::vector<vk::DescriptorBindingFlags> bindingFlags(bindings.size(),
+            vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::ePartiallyBound);
+
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+        vk::DescriptorSetLayoutCreateInfo layoutInfo;
+        layoutInfo.pNext = &bindingFlagsInfo;
+        layoutInfo.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+
+        spdlog::info("Creating bindless table with {} buffers and {} textures", m_bufferSlots.capacity,
+            m_textureSlots.capacity);
+        m_layout = m_device.getVulkanDevice().createDescriptorSetLayoutUnique(layoutInfo);
+
+        std::vector<vk::DescriptorPoolSize> poolSizes = {
+            {vk::DescriptorType::eStorageBuffer, m_bufferSlots.capacity},
+            {vk::DescriptorType::eCombinedImageSampler, m_textureSlots.capacity}
+        };
+
+        vk::DescriptorPoolCreateInfo poolInfo;
+        poolInfo.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        m_pool = m_device.getVulkanDevice().createDescriptorPoolUnique(poolInfo);
+
+        m_set = m_device.getVulkanDevice().allocateDescriptorSets({*m_pool, 1, &*m_layout}).front();
+    }
+
+
+    uint32_t BindlessTable::addBuffer(const vk::Buffer& buffer, vk::DeviceSize offset, vk::DeviceSize range)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto index = takeSlot(m_bufferSlots);
+        vk::DescriptorBufferInfo bufferInfo{buffer, offset, range};
+
+        vk::WriteDescriptorSet write;
+        write.dstSet = m_set;
+        write.dstBinding = BufferBinding;
+        write.dstArrayElement = index;
+        write.descriptorCount = 1;
+        write.descriptorType = vk::DescriptorType::eStorageBuffer;
+        write.pBufferInfo = &bufferInfo;
+        m_device.getVulkanDevice().updateDescriptorSets({write}, {});
+
+        return index;
+    }
+
+    uint32_t BindlessTable::addTexture(const vk::ImageView& imageView, const vk::Sampler& sampler,
+        vk::ImageLayout imageLayout)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto index = takeSlot(m_textureSlots);
+        vk::DescriptorImageInfo imageInfo{sampler, imageView, imageLayout};
+
+        vk::WriteDescriptorSet write;
+        write.dstSet = m_set;
+        write.dstBinding = TextureBinding;
+        write.dstArrayElement = index;
+        write.descriptorCount = 1;
+        write.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        write.pImageInfo = &imageInfo;
+        m_device.getVulkanDevice().updateDescriptorSets({write}, {});
+
+        return index;
+    }
+
+    void BindlessTable::removeBuffer(uint32_t index)
+    {
+        // Partially bound slots can be left holding a stale descriptor, as long as nothing reads it
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bufferSlots.freeSlots.push_back(index);
+    }
+
+    void BindlessTable::removeTexture(uint32_t index)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_textureSlots.freeSlots.push_back(index);
+    }
+
+
+    uint32_t BindlessTable::takeSlot(Slots& slots)
+    {
+        if (!slots.freeSlots.empty())
+        {
+            auto index = slots.freeSlots.back();
+            slots.freeSlots.pop_back();
+            return index;
+        }
+
+        if (slots.nextSlot >= slots.capacity)
+        {
+            spdlog::error("Bindless table is full at {} entries", slots.capacity);
+            throw std::runtime_error("Bindless table is full");
+        }
+
+        return slots.nextSlot++;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Rendering
+{
+    class Device;
+
+    // One large descriptor set holding every buffer and texture, which shaders index into with
+    // indices passed through push constants, so draws never need their own descriptor sets
+    // Uses update-after-bind, so resources can be added while the set is bound in command buffers
+    // that haven't been submitted yet, and partially bound, so unused slots can stay empty
+    // Shaders declare the arrays as runtime sized in whichever set they like:
+    //     layout(set = 0, binding = 0) readonly buffer Buffers { vec4 data[]; } buffers[];
+    //     layout(set = 0, binding = 1) uniform sampler2D textures[];
+    class BindlessTable
+    {
+        public:
+            static constexpr uint32_t BufferBinding = 0;
+            static constexpr uint32_t TextureBinding = 1;
+
+            // Sizes are clamped to what the device allows
+            BindlessTable(Device& device, uint32_t maxBuffers = 16 * 1024, uint32_t maxTextures = 16 * 1024);
+
+            BindlessTable(const BindlessTable&) = delete;
+            BindlessTable& operator=(const BindlessTable&) = delete;
+
+            // Returns the index shaders use to reach the resource
+            uint32_t addBuffer(const vk::Buffer& buffer, vk::DeviceSize offset = 0,
+                vk::DeviceSize range = VK_WHOLE_SIZE);
+            uint32_t addTexture(const vk::ImageView& imageView, const vk::Sampler& sampler,
+                vk::ImageLayout imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+            // Frees up the slot for reuse - nothing the GPU is still running can be using it
+            void removeBuffer(uint32_t index);
+            void removeTexture(uint32_t index);
+
+            const vk::DescriptorSetLayout& getLayout() const {
+                return *m_layout;
+            }
+            const vk::DescriptorSet& getSet() const {
+                return m_set;
+            }
+            vk::DescriptorType getBindingType(uint32_t binding) const {
+                return binding == BufferBinding ? vk::DescriptorType::eStorageBuffer :
+                    vk::DescriptorType::eCombinedImageSampler;
+            }
+
+        private:
+            // Slots handed out for one binding, reusing removed ones first
+            struct Slots
+            {
+                uint32_t capacity = 0;
+                uint32_t nextSlot = 0;
+                std::vector<uint32_t> freeSlots;
+            };
+
+            uint32_t takeSlot(Slots& slots);
+
+            Device& m_device;
+
+            std::mutex m_mutex;
+            Slots m_bufferSlots;
+            Slots m_textureSlots;
+
+            vk::UniqueDescriptorSetLayout m_layout;
+            vk::UniqueDescriptorPool m_pool;
+            vk::DescriptorSet m_set;
+    };
+}
@@ -0,0 +1,36 @@
+#include "buffer.hpp"
+
+#include <algorithm>
+
+#include "context.hpp"
+
+namespace Rendering
+{
+    Buffer::Buffer(vk::DeviceSize size, vk::BufferUsageFlags usage, const MemoryAllocator::AllocationInfo& memoryInfo,
+        const std::vector<uint32_t>& queueFamilies) :
+        m_size(size)
+    {
+        // Listing the same family twice isn't allowed, and a single family is just exclusive
+        auto uniqueFamilies = queueFamilies;
+        std::sort(uniqueFamilies.begin(), uniqueFamilies.end());
+        uniqueFamilies.erase(std::unique(uniqueFamilies.begin(), uniqueFamilies.end()), uniqueFamilies.end());
+        m_isConcurrent = uniqueFamilies.size() > 1;
+
+        vk::BufferCreateInfo createInfo;
+        createInfo.size = size;
+        createInfo.usage = usage;
+        if (m_isConcurrent)
+        {
+            createInfo.sharingMode = vk::SharingMode::eConcurrent;
+            createInfo.queueFamilyIndexCount = static_cast<uint32_t>(uniqueFamilies.size());
+            createInfo.pQueueFamilyIndices = uniqueFamilies.data();
+        }
+        else
+        {
+            createInfo.sharingMode = vk::SharingMode::eExclusive;
+        }
+
+        m_buffer = Context::getVulkanDevice().createBufferUnique(createInfo);
+        m_memory = Context::getAllocator().allocateForBuffer(*m_buffer, memoryInfo);
+    }
+}
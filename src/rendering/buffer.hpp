@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "memory.hpp"
+
+namespace Rendering
+{
+    // Vulkan buffer along with the memory backing it
+    class Buffer
+    {
+        public:
+            // Buffers used from more than one queue family are shared between them concurrently, which
+            // saves ownership transfers on buffers that cross queues every frame
+            Buffer(vk::DeviceSize size, vk::BufferUsageFlags usage,
+                const MemoryAllocator::AllocationInfo& memoryInfo = {},
+                const std::vector<uint32_t>& queueFamilies = {});
+
+            const vk::Buffer& getBuffer() const {
+                return *m_buffer;
+            }
+            auto getSize() const {
+                return m_size;
+            }
+            // Null unless the buffer is in host visible memory
+            void* getMappedData() const {
+                return m_memory.getMappedData();
+            }
+            const auto& getMemory() const {
+                return m_memory;
+            }
+            // Concurrent buffers never need queue family ownership transfers
+            bool getIsConcurrent() const {
+                return m_isConcurrent;
+            }
+
+        private:
+            vk::DeviceSize m_size;
+            bool m_isConcurrent = false;
+
+            // Declared first so the memory outlives the buffer bound to it
+            MemoryAllocation m_memory;
+            vk::UniqueBuffer m_buffer;
+    };
+}
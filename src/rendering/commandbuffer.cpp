@@ -6,11 +6,15 @@
 
 namespace Rendering
 {
-    CommandBuffer::CommandBuffer(CommandBuffer::Type type)
+    CommandBuffer::CommandBuffer(CommandBuffer::Type type) :
+        CommandBuffer(type, Context::getCommandPool())
+    {}
+
+    CommandBuffer::CommandBuffer(CommandBuffer::Type type, const vk::CommandPool& commandPool)
     {
         vk::CommandBufferAllocateInfo allocateInfo;
         allocateInfo.commandBufferCount = 1;
-        allocateInfo.commandPool = Context::getCommandPool();
+        allocateInfo.commandPool = commandPool;
         
         switch (type)
         {
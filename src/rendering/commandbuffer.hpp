@@ -15,7 +15,9 @@ namespace Rendering
                 Secondary
             };
 
+            // Allocates from the context's command pool
             CommandBuffer(Type type);
+            CommandBuffer(Type type, const vk::CommandPool& commandPool);
 
             const vk::CommandBuffer& getCommandBuffer() const {
                 return *m_commandBuffer;
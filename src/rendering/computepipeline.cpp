@@ -0,0 +1,38 @@
+#include "computepipeline.hpp"
+
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    ComputePipeline::ComputePipeline(const Shader& shader) :
+        m_layout(Context::getLayoutCache().getShaderLayout({&shader}, false)), m_pipeline(nullptr)
+    {
+        PROFILE_FUNCTION();
+
+        if (shader.getReflection().stage != vk::ShaderStageFlagBits::eCompute)
+        {
+            spdlog::error("Compute pipelines need a compute shader");
+            throw std::runtime_error("Compute pipelines need a compute shader");
+        }
+
+        vk::ComputePipelineCreateInfo createInfo;
+        createInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+        createInfo.stage.module = shader.getShaderModule();
+        createInfo.stage.pName = "main";
+        createInfo.layout = m_layout.pipelineLayout;
+
+        spdlog::info("Creating compute pipeline");
+        m_pipeline = Context::getVulkanDevice().createComputePipelineUnique(
+            Context::getPipelineCache().getThreadCache(), createInfo);
+    }
+
+    ComputePipeline::~ComputePipeline()
+    {
+        spdlog::info("Destroying compute pipeline");
+    }
+}
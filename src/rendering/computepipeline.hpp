@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include "shader.hpp"
+#include "layoutcache.hpp"
+
+namespace Rendering
+{
+    // Compute pipeline, with a layout built from what its shader uses
+    // Uniform buffers are plain uniform buffers, as compute work is usually bound once per dispatch
+    class ComputePipeline
+    {
+        public:
+            ComputePipeline(const Shader& shader);
+            ~ComputePipeline();
+
+            const vk::Pipeline& getPipeline() const {
+                return *m_pipeline;
+            }
+            const vk::PipelineLayout& getPipelineLayout() const {
+                return m_layout.pipelineLayout;
+            }
+            // Set layouts indexed by set number, with empty layouts filling any gaps
+            const std::vector<vk::DescriptorSetLayout>& getDescriptorSetLayouts() const {
+                return m_layout.setLayouts;
+            }
+
+        private:
+            ShaderLayout m_layout;
+            vk::UniquePipeline m_pipeline;
+    };
+}
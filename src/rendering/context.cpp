@@ -1,9 +1,12 @@
 #include "context.hpp"
 
 #include <algorithm>
+#include <stdexcept>
 
 #include <spdlog/spdlog.h>
 
+#include "settings.hpp"
+
 namespace Rendering
 {
     Context& Context::get()
@@ -21,12 +24,24 @@ namespace Rendering
 
         // We also need to create a window to get a Vulkan surface
         // and determine which devices support that surface
-        m_window.emplace(800, 600);
+        // Headless rendering skips this and only considers offscreen support
+        if (!settings.headless)
+        {
+            m_window.emplace(static_cast<int>(settings.width), static_cast<int>(settings.height));
+        }
         chooseDevice();
 
         // Right now there is a single graphics command pool
         createCommandPool();
 
+        m_pipelineCache.emplace(m_device.value(), settings.pipelineCachePath);
+        m_layoutCache.emplace(m_device.value());
+        if (m_device->getIsBindlessEnabled())
+        {
+            m_bindlessTable.emplace(m_device.value());
+        }
+        m_deletionQueue.emplace(m_device.value());
+
         spdlog::info("Rendering context created");
     }
 
@@ -42,7 +57,7 @@ namespace Rendering
         if (physicalDevices.empty())
         {
             spdlog::error("No graphics devices with Vulkan support");
-            throw std::exception("No graphics devices with Vulkan support");
+            throw std::runtime_error("No graphics devices with Vulkan support");
         }
 
         spdlog::info("{} graphics devices with Vulkan support found", physicalDevices.size());
@@ -50,9 +65,10 @@ namespace Rendering
         // Get device properties using property wrapper
         std::vector<DeviceProperties> deviceProperties;
         deviceProperties.reserve(physicalDevices.size());
+        vk::SurfaceKHR surface = isHeadless() ? vk::SurfaceKHR() : m_window->getSurface();
         for (auto& i : physicalDevices)
         {
-            deviceProperties.emplace_back(i, m_window->getSurface());
+            deviceProperties.emplace_back(i, surface);
         }
 
         // Remove devices that don't support required features
@@ -65,7 +81,7 @@ namespace Rendering
         if (deviceProperties.empty())
         {
             spdlog::error("No graphics devices support required Vulkan features");
-            throw std::exception("No graphics devices support required Vulkan features");
+            throw std::runtime_error("No graphics devices support required Vulkan features");
         }
         spdlog::info("{} graphics devices with required Vulkan features found", deviceProperties.size());
 
@@ -8,6 +8,10 @@
 #include "window.hpp"
 #include "device.hpp"
 #include "swapchain.hpp"
+#include "pipelinecache.hpp"
+#include "layoutcache.hpp"
+#include "bindlesstable.hpp"
+#include "deletionqueue.hpp"
 
 namespace Rendering
 {
@@ -24,12 +28,32 @@ namespace Rendering
             Window& getWindow() {
                 return m_window.value();
             }
+            bool isHeadless() const {
+                return !m_window.has_value();
+            }
             static const vk::CommandPool& getCommandPool() {
                 return *get().m_commandPool;
             }
             static const vk::Device& getVulkanDevice() {
                 return get().getDevice().getVulkanDevice();
             }
+            static MemoryAllocator& getAllocator() {
+                return get().getDevice().getAllocator();
+            }
+            static PipelineCache& getPipelineCache() {
+                return get().m_pipelineCache.value();
+            }
+            static LayoutCache& getLayoutCache() {
+                return get().m_layoutCache.value();
+            }
+            // Null unless the device supports bindless resources and they're enabled in the settings
+            static BindlessTable* getBindlessTable() {
+                auto& bindlessTable = get().m_bindlessTable;
+                return bindlessTable.has_value() ? &bindlessTable.value() : nullptr;
+            }
+            static DeletionQueue& getDeletionQueue() {
+                return get().m_deletionQueue.value();
+            }
         
         private:
             Context();
@@ -42,5 +66,11 @@ namespace Rendering
             std::optional<Window> m_window;
             std::optional<Device> m_device;
             vk::UniqueCommandPool m_commandPool;
+            std::optional<PipelineCache> m_pipelineCache;
+            std::optional<LayoutCache> m_layoutCache;
+            std::optional<BindlessTable> m_bindlessTable;
+
+            // Declared last so retired objects go before anything they were built from
+            std::optional<DeletionQueue> m_deletionQueue;
     };
 }
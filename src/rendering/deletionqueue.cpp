@@ -0,0 +1,73 @@
+#include "deletionqueue.hpp"
+
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    DeletionQueue::DeletionQueue(Device& device) :
+        m_device(device)
+    {
+    }
+
+    DeletionQueue::~DeletionQueue()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_entries.empty())
+        {
+            spdlog::info("Waiting on {} retired objects before destroying them", m_entries.size());
+        }
+
+        // Going through them in order just makes for one wait per entry - like releaseRetired, this
+        // makes no promise about the order objects are destroyed in
+        while (!m_entries.empty())
+        {
+            auto& entry = m_entries.front();
+            entry.timeline->wait(entry.value);
+            m_entries.pop_front();
+        }
+    }
+
+
+    void DeletionQueue::releaseRetired()
+    {
+        PROFILE_FUNCTION();
+
+        // Objects are destroyed outside the lock, so retiring never waits on the driver
+        std::vector<std::unique_ptr<RetiredObject>> released;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // Entries on other timelines can finish out of order, so look at all of them rather than
+            // stopping at the first one still in use
+            for (auto i = m_entries.begin(); i != m_entries.end();)
+            {
+                if (i->timeline->getIsComplete(i->value))
+                {
+                    released.push_back(std::move(i->object));
+                    i = m_entries.erase(i);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+
+        if (!released.empty())
+        {
+            spdlog::debug("Destroying {} retired objects", released.size());
+        }
+    }
+
+
+    void DeletionQueue::push(std::unique_ptr<RetiredObject> object, Timeline& timeline, uint64_t value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.push_back({std::move(object), &timeline, value});
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "device.hpp"
+#include "timeline.hpp"
+
+namespace Rendering
+{
+    // Holds on to objects the GPU may still be using until the timeline value that last used them has
+    // been reached, so anything can be freed mid-run without waiting for the device to go idle
+    // Takes anything that frees itself when destroyed, like unique handles, buffers, memory allocations
+    // or shared pointers to pipelines
+    // Retiring is safe from any thread, while releasing is done once a frame by whoever drives frames
+    class DeletionQueue
+    {
+        public:
+            DeletionQueue(Device& device);
+            // Waits on whatever is still in use before destroying it
+            ~DeletionQueue();
+
+            DeletionQueue(const DeletionQueue&) = delete;
+            DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+            // Keeps the object until every graphics submission so far has finished, so nothing recorded
+            // after this can use it
+            template <typename T>
+            void retire(T&& object);
+
+            // Keeps the object until the timeline reaches the value, like for objects only a transfer or
+            // compute submission used
+            template <typename T>
+            void retire(T&& object, Timeline& timeline, uint64_t value);
+
+            // Destroys everything whose timeline value has been reached
+            // Entries on different timelines finish independently, so objects aren't necessarily destroyed
+            // in the order they were retired - anything one object depends on has to be kept alive by it
+            void releaseRetired();
+
+        private:
+            struct RetiredObject
+            {
+                virtual ~RetiredObject() = default;
+            };
+
+            template <typename T>
+            struct RetiredObjectOf : RetiredObject
+            {
+                RetiredObjectOf(T&& object) :
+                    object(std::move(object))
+                {};
+
+                T object;
+            };
+
+            struct Entry
+            {
+                std::unique_ptr<RetiredObject> object;
+                Timeline* timeline;
+                uint64_t value;
+            };
+
+            void push(std::unique_ptr<RetiredObject> object, Timeline& timeline, uint64_t value);
+
+            Device& m_device;
+
+            std::mutex m_mutex;
+            // In retirement order
+            std::deque<Entry> m_entries;
+    };
+
+
+    template <typename T>
+    void DeletionQueue::retire(T&& object)
+    {
+        auto& timeline = m_device.getGraphicsTimeline();
+        retire(std::forward<T>(object), timeline, timeline.getSubmittedValue());
+    }
+
+    template <typename T>
+    void DeletionQueue::retire(T&& object, Timeline& timeline, uint64_t value)
+    {
+        static_assert(!std::is_lvalue_reference_v<T>, "Retired objects have to be moved in");
+        push(std::make_unique<RetiredObjectOf<std::decay_t<T>>>(std::move(object)), timeline, value);
+    }
+}
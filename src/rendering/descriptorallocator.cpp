@@ -0,0 +1,206 @@
+#include "descriptorallocator.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "util/hash.hpp"
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    DescriptorAllocator::DescriptorAllocator(size_t frameCount, uint32_t setsPerPool) :
+        m_setsPerPool(setsPerPool), m_framePools(frameCount)
+    {}
+
+
+    void DescriptorAllocator::beginFrame(size_t frameIndex)
+    {
+        PROFILE_FUNCTION();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Resetting a pool frees every set in it at once
+        for (auto& i : m_framePools[frameIndex])
+        {
+            Context::getVulkanDevice().resetDescriptorPool(*i);
+            m_freePools.push_back(std::move(i));
+        }
+        m_framePools[frameIndex].clear();
+        m_currentFrame = frameIndex;
+    }
+
+    vk::DescriptorSet DescriptorAllocator::allocate(const vk::DescriptorSetLayout& layout)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return allocateFrom(m_framePools[m_currentFrame], layout);
+    }
+
+    vk::DescriptorSet DescriptorAllocator::allocate(const vk::DescriptorSetLayout& layout,
+        const std::vector<Binding>& bindings)
+    {
+        auto set = allocate(layout);
+        writeSet(set, bindings);
+        return set;
+    }
+
+    vk::DescriptorSet DescriptorAllocator::getCachedSet(const vk::DescriptorSetLayout& layout,
+        const std::vector<Binding>& bindings)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        SetKey key{layout, bindings};
+        auto set = m_cachedSets.find(key);
+        if (set == m_cachedSets.end())
+        {
+            auto newSet = allocateFrom(m_cachedPools, layout);
+            writeSet(newSet, bindings);
+            set = m_cachedSets.emplace(std::move(key), newSet).first;
+        }
+
+        return set->second;
+    }
+
+    size_t DescriptorAllocator::getPoolCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_poolCount;
+    }
+
+    size_t DescriptorAllocator::getCachedSetCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_cachedSets.size();
+    }
+
+
+    vk::DescriptorSet DescriptorAllocator::allocateFrom(std::vector<vk::UniqueDescriptorPool>& pools,
+        const vk::DescriptorSetLayout& layout)
+    {
+        vk::DescriptorSetAllocateInfo allocateInfo;
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &layout;
+
+        // Only the newest pool can have room, as older ones were already found to be full
+        if (!pools.empty())
+        {
+            allocateInfo.descriptorPool = *pools.back();
+
+            vk::DescriptorSet set;
+            auto result = Context::getVulkanDevice().allocateDescriptorSets(&allocateInfo, &set);
+            if (result == vk::Result::eSuccess)
+            {
+                return set;
+            }
+            if (result != vk::Result::eErrorOutOfPoolMemory && result != vk::Result::eErrorFragmentedPool)
+            {
+                spdlog::error("Failed to allocate descriptor set: {}", vk::to_string(result));
+                throw std::runtime_error("Failed to allocate descriptor set");
+            }
+        }
+
+        pools.push_back(takePool());
+        allocateInfo.descriptorPool = *pools.back();
+
+        // A fresh pool failing means the layout needs more than a whole pool holds, which is worth
+        // the exception
+        vk::DescriptorSet set;
+        auto result = Context::getVulkanDevice().allocateDescriptorSets(&allocateInfo, &set);
+        if (result != vk::Result::eSuccess)
+        {
+            spdlog::error("Failed to allocate descriptor set from a new pool: {}", vk::to_string(result));
+            throw std::runtime_error("Failed to allocate descriptor set");
+        }
+        return set;
+    }
+
+    vk::UniqueDescriptorPool DescriptorAllocator::takePool()
+    {
+        if (!m_freePools.empty())
+        {
+            auto pool = std::move(m_freePools.back());
+            m_freePools.pop_back();
+            return pool;
+        }
+
+        // Rough mix of descriptors per set, weighted towards what materials tend to use
+        static const std::vector<std::pair<vk::DescriptorType, float>> descriptorsPerSet = {
+            {vk::DescriptorType::eUniformBuffer, 1.0f},
+            {vk::DescriptorType::eUniformBufferDynamic, 1.0f},
+            {vk::DescriptorType::eStorageBuffer, 1.0f},
+            {vk::DescriptorType::eStorageBufferDynamic, 0.5f},
+            {vk::DescriptorType::eCombinedImageSampler, 4.0f},
+            {vk::DescriptorType::eSampledImage, 1.0f},
+            {vk::DescriptorType::eSampler, 0.5f},
+            {vk::DescriptorType::eStorageImage, 0.5f}
+        };
+
+        std::vector<vk::DescriptorPoolSize> poolSizes;
+        for (auto& i : descriptorsPerSet)
+        {
+            poolSizes.emplace_back(i.first, static_cast<uint32_t>(i.second * static_cast<float>(m_setsPerPool)));
+        }
+
+        vk::DescriptorPoolCreateInfo createInfo;
+        createInfo.maxSets = m_setsPerPool;
+        createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        createInfo.pPoolSizes = poolSizes.data();
+
+        m_poolCount++;
+        spdlog::info("Creating descriptor pool {}", m_poolCount);
+        return Context::getVulkanDevice().createDescriptorPoolUnique(createInfo);
+    }
+
+    void DescriptorAllocator::writeSet(vk::DescriptorSet set, const std::vector<Binding>& bindings)
+    {
+        std::vector<vk::WriteDescriptorSet> writes;
+        writes.reserve(bindings.size());
+
+        for (auto& i : bindings)
+        {
+            auto& write = writes.emplace_back();
+            write.dstSet = set;
+            write.dstBinding = i.binding;
+            write.descriptorCount = 1;
+            write.descriptorType = i.type;
+
+            switch (i.type)
+            {
+                case vk::DescriptorType::eUniformBuffer:
+                case vk::DescriptorType::eUniformBufferDynamic:
+                case vk::DescriptorType::eStorageBuffer:
+                case vk::DescriptorType::eStorageBufferDynamic:
+                    write.pBufferInfo = &i.buffer;
+                    break;
+                default:
+                    write.pImageInfo = &i.image;
+                    break;
+            }
+        }
+
+        Context::getVulkanDevice().updateDescriptorSets(writes, {});
+    }
+
+
+    size_t DescriptorAllocator::SetKeyHash::operator()(const SetKey& key) const
+    {
+        size_t seed = 0;
+
+        Util::hashCombine(seed, static_cast<VkDescriptorSetLayout>(key.layout));
+        for (auto& i : key.bindings)
+        {
+            Util::hashCombine(seed, i.binding);
+            Util::hashCombine(seed, i.type);
+            Util::hashCombine(seed, static_cast<VkBuffer>(i.buffer.buffer));
+            Util::hashCombine(seed, i.buffer.offset);
+            Util::hashCombine(seed, i.buffer.range);
+            Util::hashCombine(seed, static_cast<VkSampler>(i.image.sampler));
+            Util::hashCombine(seed, static_cast<VkImageView>(i.image.imageView));
+            Util::hashCombine(seed, i.image.imageLayout);
+        }
+
+        return seed;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Rendering
+{
+    // Hands out descriptor sets from pools that grow on demand
+    // Sets for a single frame come from that frame's pools, which are reset all at once when the
+    // frame slot comes around again rather than freeing sets one by one
+    // Sets that never change are cached by their contents, so asking for the same bindings twice
+    // returns the same set without writing it again
+    class DescriptorAllocator
+    {
+        public:
+            // One resource bound to a set - only the info matching the type is used
+            struct Binding
+            {
+                uint32_t binding = 0;
+                vk::DescriptorType type = vk::DescriptorType::eUniformBuffer;
+                vk::DescriptorBufferInfo buffer;
+                vk::DescriptorImageInfo image;
+
+                bool operator==(const Binding& other) const {
+                    return binding == other.binding && type == other.type && buffer == other.buffer &&
+                        image == other.image;
+                }
+            };
+
+            DescriptorAllocator(size_t frameCount, uint32_t setsPerPool = 256);
+
+            DescriptorAllocator(const DescriptorAllocator&) = delete;
+            DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+            // Must be called once the frame has been waited on
+            // Resets every pool the frame slot allocated from last time
+            void beginFrame(size_t frameIndex);
+
+            // Allocates a set that's only valid until this frame slot begins again
+            vk::DescriptorSet allocate(const vk::DescriptorSetLayout& layout);
+
+            // Writes the bindings into a set allocated from the current frame
+            vk::DescriptorSet allocate(const vk::DescriptorSetLayout& layout, const std::vector<Binding>& bindings);
+
+            // Returns a set with these bindings that lives as long as the allocator, creating it the first
+            // time - the bound resources must live as long as the set is used
+            vk::DescriptorSet getCachedSet(const vk::DescriptorSetLayout& layout, const std::vector<Binding>& bindings);
+
+            size_t getPoolCount() const;
+            size_t getCachedSetCount() const;
+
+        private:
+            struct SetKey
+            {
+                vk::DescriptorSetLayout layout;
+                std::vector<Binding> bindings;
+
+                bool operator==(const SetKey& other) const {
+                    return layout == other.layout && bindings == other.bindings;
+                }
+            };
+
+            struct SetKeyHash
+            {
+                size_t operator()(const SetKey& key) const;
+            };
+
+            // Tries each pool in the list, adding a fresh one when they're all full
+            vk::DescriptorSet allocateFrom(std::vector<vk::UniqueDescriptorPool>& pools,
+                const vk::DescriptorSetLayout& layout);
+            vk::UniqueDescriptorPool takePool();
+            static void writeSet(vk::DescriptorSet set, const std::vector<Binding>& bindings);
+
+            uint32_t m_setsPerPool;
+
+            mutable std::mutex m_mutex;
+            size_t m_currentFrame = 0;
+            std::vector<std::vector<vk::UniqueDescriptorPool>> m_framePools;
+            // Reset pools waiting to be handed to a frame
+            std::vector<vk::UniqueDescriptorPool> m_freePools;
+            size_t m_poolCount = 0;
+
+            std::vector<vk::UniqueDescriptorPool> m_cachedPools;
+            std::unordered_map<SetKey, vk::DescriptorSet, SetKeyHash> m_cachedSets;
+    };
+}
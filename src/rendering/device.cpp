@@ -1,15 +1,21 @@
 #include "device.hpp"
 
-#include <set>
+#include <algorithm>
+#include <map>
+#include <stdexcept>
 #include <string_view>
 
 #include <spdlog/spdlog.h>
 
 #include "instance.hpp"
+#include "settings.hpp"
 
 namespace Rendering
 {
     std::vector<const char*> requiredDeviceExtensions = {
+    };
+
+    std::vector<const char*> presentationDeviceExtensions = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 
@@ -18,15 +24,47 @@ namespace Rendering
 
 
     DeviceProperties::DeviceProperties(const vk::PhysicalDevice& physicalDevice, const vk::SurfaceKHR& surface) :
-        m_physicalDevice(physicalDevice), m_totalHeapSize(0)
+        m_physicalDevice(physicalDevice), m_totalHeapSize(0), m_isHeadless(!surface)
     {
         // Query main property structures
         m_deviceProperties = m_physicalDevice.getProperties();
         m_memoryProperties = m_physicalDevice.getMemoryProperties();
         m_queueProperties = m_physicalDevice.getQueueFamilyProperties();
         m_extensionProperties = m_physicalDevice.enumerateDeviceExtensionProperties();
-        m_surfaceFormats = m_physicalDevice.getSurfaceFormatsKHR(surface);
-        m_presentModes = m_physicalDevice.getSurfacePresentModesKHR(surface);
+
+        // Surface information only exists when we have a surface to present to
+        if (!m_isHeadless)
+        {
+            m_surfaceFormats = m_physicalDevice.getSurfaceFormatsKHR(surface);
+            m_presentModes = m_physicalDevice.getSurfacePresentModesKHR(surface);
+        }
+
+        // Newer features are only looked at on 1.2 devices, where they're all core
+        if (m_deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+        {
+            auto features = m_physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                vk::PhysicalDeviceVulkan12Features>();
+            auto& coreFeatures = features.get<vk::PhysicalDeviceFeatures2>().features;
+            auto& vulkan12Features = features.get<vk::PhysicalDeviceVulkan12Features>();
+
+            // Shaders index the arrays with push constants, which takes dynamic indexing
+            m_supportsBindless = coreFeatures.shaderStorageBufferArrayDynamicIndexing &&
+                coreFeatures.shaderSampledImageArrayDynamicIndexing &&
+                vulkan12Features.descriptorIndexing &&
+                vulkan12Features.runtimeDescriptorArray &&
+                vulkan12Features.descriptorBindingPartiallyBound &&
+                vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind &&
+                vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+                vulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+            m_supportsIndirectCount = vulkan12Features.drawIndirectCount && coreFeatures.multiDrawIndirect &&
+                coreFeatures.drawIndirectFirstInstance;
+            m_supportsTimelineSemaphores = vulkan12Features.timelineSemaphore;
+            m_supportsTextureCompressionBC = coreFeatures.textureCompressionBC;
+
+            auto properties = m_physicalDevice.getProperties2<vk::PhysicalDeviceProperties2,
+                vk::PhysicalDeviceDescriptorIndexingProperties>();
+            m_descriptorIndexingProperties = properties.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+        }
 
         // Calculate total heap size
         for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i ++)
@@ -52,8 +90,42 @@ namespace Rendering
             }
         }
 
+        // Find a transfer queue family, preferring one that can only do transfers as it
+        // usually maps to a dedicated copy engine that runs alongside rendering
+        for (size_t i = 0; i < m_queueProperties.size() && !m_transferQueue.has_value(); i++)
+        {
+            auto flags = m_queueProperties[i].queueFlags;
+            if ((flags & vk::QueueFlagBits::eTransfer) &&
+                !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)))
+            {
+                spdlog::debug("\tDedicated transfer queue selected at index {}", i);
+                m_transferQueue = static_cast<uint32_t>(i);
+            }
+        }
+        for (size_t i = 0; i < m_queueProperties.size() && !m_transferQueue.has_value(); i++)
+        {
+            auto flags = m_queueProperties[i].queueFlags;
+            if ((flags & vk::QueueFlagBits::eTransfer) && !(flags & vk::QueueFlagBits::eGraphics))
+            {
+                spdlog::debug("\tNon-graphics transfer queue selected at index {}", i);
+                m_transferQueue = static_cast<uint32_t>(i);
+            }
+        }
+
+        // Find a compute family without graphics, which usually maps to compute units that can take
+        // work while rasterization is running
+        for (size_t i = 0; i < m_queueProperties.size() && !m_computeQueue.has_value(); i++)
+        {
+            auto flags = m_queueProperties[i].queueFlags;
+            if ((flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics))
+            {
+                spdlog::debug("\tDedicated compute queue selected at index {}", i);
+                m_computeQueue = static_cast<uint32_t>(i);
+            }
+        }
+
         // Find the first available presentation queue family
-        for (size_t i = 0; i < m_queueProperties.size(); i++)
+        for (size_t i = 0; i < m_queueProperties.size() && !m_isHeadless; i++)
         {
             if (m_physicalDevice.getSurfaceSupportKHR(static_cast<uint32_t>(i), surface))
             {
@@ -67,34 +139,34 @@ namespace Rendering
     bool DeviceProperties::getSupportsRequiredFeatures() const
     {
         // Check if we have a supported graphics queue
-        if (!m_graphicsQueue.has_value() || !m_presentationQueue.has_value())
+        if (!m_graphicsQueue.has_value())
         {
             return false;
         }
 
-        // Check if our device has all of the required extensions
-        for (auto& i : requiredDeviceExtensions)
+        // Frame synchronization is built on timeline semaphores
+        if (!m_supportsTimelineSemaphores)
         {
-            bool wasExtensionFound = false;
-            std::string_view extensionName(i);
-
-            for (auto& j : m_extensionProperties)
-            {
-                if (j.extensionName == extensionName)
-                {
-                    wasExtensionFound = true;
-                    break;
-                }
-            }
+            return false;
+        }
 
-            if (!wasExtensionFound)
+        // Check if our device has all of the required extensions
+        for (auto& i : getRequiredExtensions())
+        {
+            if (!getSupportsExtension(i))
             {
                 return false;
             }
         }
 
-        // Check for supported formats
-        if (m_surfaceFormats.empty() || m_presentModes.empty())
+        // Headless devices never present, so they don't need anything else
+        if (m_isHeadless)
+        {
+            return true;
+        }
+
+        // Check for presentation support and supported formats
+        if (!m_presentationQueue.has_value() || m_surfaceFormats.empty() || m_presentModes.empty())
         {
             return false;
         }
@@ -102,6 +174,33 @@ namespace Rendering
         return true;
     }
 
+    bool DeviceProperties::getSupportsExtension(const std::string_view& extensionName) const
+    {
+        for (auto& i : m_extensionProperties)
+        {
+            if (i.extensionName == extensionName)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::vector<const char*> DeviceProperties::getRequiredExtensions() const
+    {
+        std::vector<const char*> extensions = requiredDeviceExtensions;
+
+        // Swapchain support is only needed if we're going to present
+        if (!m_isHeadless)
+        {
+            extensions.insert(extensions.end(), presentationDeviceExtensions.begin(),
+                presentationDeviceExtensions.end());
+        }
+
+        return extensions;
+    }
+
     bool operator<(const DeviceProperties& a, const DeviceProperties& b)
     {
         // Prioritize discrete GPUs
@@ -128,18 +227,44 @@ namespace Rendering
         {
             spdlog::error("Cannot create logical device for {} - does not support required features",
                 m_properties.getDeviceProperties().deviceName);
-            throw std::exception("Physical device does not support required Vulkan features");
+            throw std::runtime_error("Physical device does not support required Vulkan features");
         }
 
-        float defaultQueuePriority = 1.0f;
-        std::vector<vk::DeviceQueueCreateInfo> queueCreateInfo;
+        // Give each role its own queue where the family has enough of them, so transfers and compute
+        // can run alongside rendering even when they share the graphics family
+        // Once a family runs out, later roles share its last queue
+        std::map<uint32_t, uint32_t> familyQueueCounts;
+        auto requestQueue = [&](uint32_t family) {
+            auto available = m_properties.getQueueProperties()[family].queueCount;
+            auto& count = familyQueueCounts[family];
+            auto index = std::min(count, available - 1);
+            count = std::min(count + 1, available);
+            return index;
+        };
+
+        auto graphicsQueueIndex = requestQueue(m_properties.getGraphicsQueue());
+        auto computeQueueIndex = requestQueue(m_properties.getComputeQueue());
+        auto transferQueueIndex = requestQueue(m_properties.getTransferQueue());
+
+        // Presenting from the graphics queue saves a queue when the families match
+        uint32_t presentationQueueIndex = 0;
+        if (!m_properties.getIsHeadless())
+        {
+            presentationQueueIndex = m_properties.getPresentationQueue() == m_properties.getGraphicsQueue() ?
+                graphicsQueueIndex : requestQueue(m_properties.getPresentationQueue());
+        }
 
-        // Add a request for graphics and presentation queues
-        std::set<uint32_t> requestedQueueFamilies = {m_properties.getGraphicsQueue(), m_properties.getPresentationQueue()};
+        uint32_t maxQueueCount = 0;
+        for (auto& i : familyQueueCounts)
+        {
+            maxQueueCount = std::max(maxQueueCount, i.second);
+        }
+        std::vector<float> queuePriorities(maxQueueCount, 1.0f);
 
-        for (auto& i : requestedQueueFamilies)
+        std::vector<vk::DeviceQueueCreateInfo> queueCreateInfo;
+        for (auto& i : familyQueueCounts)
         {
-            queueCreateInfo.push_back(vk::DeviceQueueCreateInfo{{}, m_properties.getGraphicsQueue(), 1, &defaultQueuePriority});
+            queueCreateInfo.push_back(vk::DeviceQueueCreateInfo{{}, i.first, i.second, queuePriorities.data()});
         }
 
         // Populate our device info with all requested queues
@@ -148,8 +273,48 @@ namespace Rendering
         createInfo.pQueueCreateInfos = queueCreateInfo.data();
 
         // Add all required device extensions
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
+        auto enabledExtensions = m_properties.getRequiredExtensions();
+
+        // Turn on just the features we use
+        vk::PhysicalDeviceFeatures2 features;
+        vk::PhysicalDeviceVulkan12Features vulkan12Features;
+        features.pNext = &vulkan12Features;
+        createInfo.pNext = &features;
+
+        vulkan12Features.timelineSemaphore = true;
+
+        if (settings.bindless && m_properties.getSupportsBindless())
+        {
+            vulkan12Features.descriptorIndexing = true;
+            vulkan12Features.runtimeDescriptorArray = true;
+            vulkan12Features.descriptorBindingPartiallyBound = true;
+            vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = true;
+            vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = true;
+            vulkan12Features.shaderSampledImageArrayNonUniformIndexing = true;
+            features.features.shaderStorageBufferArrayDynamicIndexing = true;
+            features.features.shaderSampledImageArrayDynamicIndexing = true;
+
+            spdlog::info("Enabling descriptor indexing for bindless resources");
+            m_isBindlessEnabled = true;
+        }
+
+        if (m_properties.getSupportsIndirectCount())
+        {
+            vulkan12Features.drawIndirectCount = true;
+            features.features.multiDrawIndirect = true;
+            features.features.drawIndirectFirstInstance = true;
+
+            spdlog::info("Enabling indirect draw counts for GPU driven rendering");
+            m_isIndirectCountEnabled = true;
+        }
+
+        if (m_properties.getSupportsTextureCompressionBC())
+        {
+            features.features.textureCompressionBC = true;
+        }
+
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         // Create the device with exception handling
         spdlog::info("Creating Vulkan device for {}", m_properties.getDeviceProperties().deviceName);
@@ -164,8 +329,22 @@ namespace Rendering
         }
 
         spdlog::info("Aquiring queues");
-        m_graphicsQueue = m_device->getQueue(m_properties.getGraphicsQueue(), 0);
-        m_presentationQueue = m_device->getQueue(m_properties.getPresentationQueue(), 0);
+        m_graphicsQueue = m_device->getQueue(m_properties.getGraphicsQueue(), graphicsQueueIndex);
+        m_computeQueue = m_device->getQueue(m_properties.getComputeQueue(), computeQueueIndex);
+        m_transferQueue = m_device->getQueue(m_properties.getTransferQueue(), transferQueueIndex);
+        if (!m_properties.getIsHeadless())
+        {
+            m_presentationQueue = m_device->getQueue(m_properties.getPresentationQueue(), presentationQueueIndex);
+        }
+        spdlog::info("Using queue families {} for graphics, {} for compute and {} for transfers{}",
+            m_properties.getGraphicsQueue(), m_properties.getComputeQueue(), m_properties.getTransferQueue(),
+            getHasAsyncCompute() ? ", with async compute" : "");
+
+        m_graphicsTimeline.emplace(*m_device, m_graphicsQueue);
+        m_transferTimeline.emplace(*m_device, m_transferQueue);
+        m_computeTimeline.emplace(*m_device, m_computeQueue);
+
+        m_allocator.emplace(*m_device, m_properties.getMemoryProperties(), m_properties.getDeviceProperties().limits);
 
         chooseSurfaceFormat();
     }
@@ -179,6 +358,14 @@ namespace Rendering
     {
         auto& surfaceFormats = m_properties.getSurfaceFormats();
 
+        // Offscreen images can use whatever format we like
+        if (m_properties.getIsHeadless())
+        {
+            m_surfaceFormat.format = defaultSurfaceColorFormat;
+            m_surfaceFormat.colorSpace = vk::ColorSpaceKHR::eSrgbNonlinear;
+            return;
+        }
+
         // If there is a single supported format with the type undefined
         // then any surface format is supported
         if (surfaceFormats.size() == 1 &&
@@ -2,17 +2,23 @@
 
 #include <optional>
 #include <vector>
+#include <string_view>
 
 #include <vulkan/vulkan.hpp>
 
+#include "memory.hpp"
+#include "timeline.hpp"
+
 namespace Rendering
 {
     extern std::vector<const char*> requiredDeviceExtensions;
+    extern std::vector<const char*> presentationDeviceExtensions;
     extern vk::Format defaultSurfaceColorFormat;
 
     // Queries and stores Vulkan physical device properties in addition
     // to computing some metrics for determining optimal device
     // and feature support
+    // A null surface means the device is being considered for headless rendering
     class DeviceProperties
     {
         public:
@@ -51,8 +57,42 @@ namespace Rendering
             auto getPresentationQueue() const {
                 return m_presentationQueue.value();
             }
+            // Falls back to the graphics queue family if there is no separate transfer family
+            auto getTransferQueue() const {
+                return m_transferQueue.value_or(m_graphicsQueue.value());
+            }
+            auto getHasDedicatedTransferQueue() const {
+                return m_transferQueue.has_value();
+            }
+            // Falls back to the graphics queue family if there is no compute only family
+            auto getComputeQueue() const {
+                return m_computeQueue.value_or(m_graphicsQueue.value());
+            }
+            auto getHasDedicatedComputeQueue() const {
+                return m_computeQueue.has_value();
+            }
+            auto getIsHeadless() const {
+                return m_isHeadless;
+            }
+            // Descriptor indexing with everything a bindless descriptor table needs
+            auto getSupportsBindless() const {
+                return m_supportsBindless;
+            }
+            // Multi-draw indirect with a GPU written draw count and first instance
+            auto getSupportsIndirectCount() const {
+                return m_supportsIndirectCount;
+            }
+            // Block compressed texture formats, as used by DDS files and most KTX2 files
+            auto getSupportsTextureCompressionBC() const {
+                return m_supportsTextureCompressionBC;
+            }
+            auto& getDescriptorIndexingProperties() const {
+                return m_descriptorIndexingProperties;
+            }
 
             bool getSupportsRequiredFeatures() const;
+            bool getSupportsExtension(const std::string_view& extensionName) const;
+            std::vector<const char*> getRequiredExtensions() const;
 
 
         private:
@@ -66,6 +106,14 @@ namespace Rendering
             std::vector<vk::PresentModeKHR> m_presentModes;
             std::optional<uint32_t> m_graphicsQueue;
             std::optional<uint32_t> m_presentationQueue;
+            std::optional<uint32_t> m_transferQueue;
+            std::optional<uint32_t> m_computeQueue;
+            bool m_isHeadless;
+            bool m_supportsBindless = false;
+            bool m_supportsIndirectCount = false;
+            bool m_supportsTimelineSemaphores = false;
+            bool m_supportsTextureCompressionBC = false;
+            vk::PhysicalDeviceDescriptorIndexingProperties m_descriptorIndexingProperties;
     };
 
     // Sort operator
@@ -91,17 +139,62 @@ namespace Rendering
             vk::Queue& getPresentationQueue() {
                 return m_presentationQueue;
             }
+            vk::Queue& getTransferQueue() {
+                return m_transferQueue;
+            }
+            // Shares the graphics queue if the device only has the one queue that can run compute work
+            vk::Queue& getComputeQueue() {
+                return m_computeQueue;
+            }
+            // Whether compute work can run alongside rendering on a queue of its own
+            bool getHasAsyncCompute() const {
+                return m_computeQueue != m_graphicsQueue;
+            }
+            // Every submission to a queue goes through its timeline, even where queues are shared
+            Timeline& getGraphicsTimeline() {
+                return m_graphicsTimeline.value();
+            }
+            Timeline& getTransferTimeline() {
+                return m_transferTimeline.value();
+            }
+            Timeline& getComputeTimeline() {
+                return m_computeTimeline.value();
+            }
             vk::SurfaceFormatKHR getSurfaceFormat() const {
                 return m_surfaceFormat;
             }
+            MemoryAllocator& getAllocator() {
+                return m_allocator.value();
+            }
+            // Whether descriptor indexing was enabled for a bindless descriptor table
+            bool getIsBindlessEnabled() const {
+                return m_isBindlessEnabled;
+            }
+            // Whether indirect draws can take their count from a buffer
+            bool getIsIndirectCountEnabled() const {
+                return m_isIndirectCountEnabled;
+            }
 
         private:
             void chooseSurfaceFormat();
 
             DeviceProperties m_properties;
             vk::UniqueDevice m_device;
+            bool m_isBindlessEnabled = false;
+            bool m_isIndirectCountEnabled = false;
+
+            // Declared after the device so all of its memory is freed first
+            std::optional<MemoryAllocator> m_allocator;
+
             vk::Queue m_graphicsQueue;
             vk::Queue m_presentationQueue;
+            vk::Queue m_transferQueue;
+            vk::Queue m_computeQueue;
             vk::SurfaceFormatKHR m_surfaceFormat;
+
+            // Declared after the device so their semaphores are destroyed first
+            std::optional<Timeline> m_graphicsTimeline;
+            std::optional<Timeline> m_transferTimeline;
+            std::optional<Timeline> m_computeTimeline;
     };
 }
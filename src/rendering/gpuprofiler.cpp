@@ -0,0 +1,199 @@
+#include "gpuprofiler.hpp"
+
+#include <limits>
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    GpuProfiler::Scope::Scope(GpuProfiler& profiler, const vk::CommandBuffer& commandBuffer,
+        const std::string_view& name) :
+        m_profiler(profiler), m_commandBuffer(commandBuffer)
+    {
+        m_scopeIndex = m_profiler.beginScope(m_commandBuffer, name);
+    }
+
+    GpuProfiler::Scope::~Scope()
+    {
+        if (m_scopeIndex.has_value())
+        {
+            m_profiler.endScope(m_commandBuffer, m_scopeIndex.value());
+        }
+    }
+
+
+
+    GpuProfiler::GpuProfiler(size_t frameCount, uint32_t maxScopesPerFrame) :
+        m_maxQueries(maxScopesPerFrame * 2), m_frames(frameCount)
+    {
+        // Timestamps are only supported if the graphics queue reports valid bits
+        auto properties = Context::get().getDevice().getProperties();
+        auto timestampValidBits = properties.getQueueProperties()[properties.getGraphicsQueue()].timestampValidBits;
+
+        m_isSupported = timestampValidBits != 0;
+        m_timestampPeriod = properties.getDeviceProperties().limits.timestampPeriod;
+        m_timestampMask = (timestampValidBits >= 64) ?
+            std::numeric_limits<uint64_t>::max() : ((uint64_t(1) << timestampValidBits) - 1);
+
+        if (!m_isSupported)
+        {
+            spdlog::warn("Graphics queue does not support timestamps, GPU profiling is disabled");
+            return;
+        }
+
+        spdlog::info("Creating GPU profiler query pools for {} frames", frameCount);
+        for (auto& i : m_frames)
+        {
+            i.queryPool = Context::getVulkanDevice().createQueryPoolUnique({
+                {},
+                vk::QueryType::eTimestamp,
+                m_maxQueries
+            });
+        }
+    }
+
+    GpuProfiler::~GpuProfiler()
+    {
+        spdlog::info("Destroying GPU profiler");
+    }
+
+
+    void GpuProfiler::beginFrame(size_t frameIndex, uint64_t frameNumber, const vk::CommandBuffer& commandBuffer)
+    {
+        if (!m_isSupported)
+        {
+            return;
+        }
+
+        auto& frame = m_frames[frameIndex];
+
+        // The frame has been waited on, so everything written last time is available
+        resolveFrame(frame);
+
+        commandBuffer.resetQueryPool(*frame.queryPool, 0, m_maxQueries);
+        frame.scopes.clear();
+        frame.usedQueries = 0;
+        frame.frameNumber = frameNumber;
+
+        m_currentFrame = &frame;
+        m_currentDepth = 0;
+    }
+
+    std::optional<uint32_t> GpuProfiler::beginScope(const vk::CommandBuffer& commandBuffer,
+        const std::string_view& name)
+    {
+        if (m_currentFrame == nullptr)
+        {
+            return {};
+        }
+
+        // Each scope needs a begin and end query
+        if (m_currentFrame->usedQueries + 2 > m_maxQueries)
+        {
+            if (!m_hasWarnedOverflow)
+            {
+                spdlog::warn("GPU profiler ran out of queries, dropping scope \"{}\"", name);
+                m_hasWarnedOverflow = true;
+            }
+            return {};
+        }
+
+        auto beginQuery = m_currentFrame->usedQueries;
+        m_currentFrame->usedQueries += 2;
+
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *m_currentFrame->queryPool, beginQuery);
+        m_currentFrame->scopes.push_back(ScopeRecord{std::string(name), m_currentDepth, beginQuery, {}});
+        m_currentDepth++;
+
+        return static_cast<uint32_t>(m_currentFrame->scopes.size() - 1);
+    }
+
+    void GpuProfiler::endScope(const vk::CommandBuffer& commandBuffer, uint32_t scopeIndex)
+    {
+        if (m_currentFrame == nullptr)
+        {
+            return;
+        }
+
+        auto& scope = m_currentFrame->scopes[scopeIndex];
+        scope.endQuery = scope.beginQuery + 1;
+
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *m_currentFrame->queryPool,
+            scope.endQuery.value());
+        m_currentDepth--;
+    }
+
+    std::optional<double> GpuProfiler::getScopeMilliseconds(const std::string_view& name) const
+    {
+        for (auto& i : m_results)
+        {
+            if (i.name == name)
+            {
+                return i.milliseconds;
+            }
+        }
+
+        return {};
+    }
+
+
+    void GpuProfiler::resolveFrame(FrameQueries& frame)
+    {
+        PROFILE_FUNCTION();
+
+        // Nothing to do if the frame was never used, or was already resolved
+        if (!m_isSupported || !frame.frameNumber.has_value() || frame.usedQueries == 0)
+        {
+            return;
+        }
+
+        std::vector<uint64_t> timestamps(frame.usedQueries);
+        auto result = Context::getVulkanDevice().getQueryPoolResults(*frame.queryPool, 0, frame.usedQueries,
+            timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+            vk::QueryResultFlagBits::e64);
+
+        // Shouldn't happen once the frame has finished, but never block waiting on it
+        if (result != vk::Result::eSuccess)
+        {
+            spdlog::debug("GPU profiler results for frame {} not ready", frame.frameNumber.value());
+            return;
+        }
+
+        m_results.clear();
+        for (auto& i : frame.scopes)
+        {
+            // Skip scopes that were never closed
+            if (!i.endQuery.has_value())
+            {
+                continue;
+            }
+
+            auto ticks = (timestamps[i.endQuery.value()] & m_timestampMask) - (timestamps[i.beginQuery] & m_timestampMask);
+            m_results.push_back(ScopeResult{
+                i.name,
+                i.depth,
+                static_cast<double>(ticks) * m_timestampPeriod / 1e6
+            });
+        }
+        // The frame's number is cleared to mark it resolved, so go by the copy in the results
+        m_resultsFrameNumber = frame.frameNumber;
+        frame.frameNumber.reset();
+
+        if (m_logInterval != 0 && m_resultsFrameNumber.value() % m_logInterval == 0)
+        {
+            logResults();
+        }
+    }
+
+    void GpuProfiler::logResults() const
+    {
+        spdlog::info("GPU times for frame {}:", m_resultsFrameNumber.value());
+        for (auto& i : m_results)
+        {
+            spdlog::info("\t{:>{}}{}: {:.3f}ms", "", i.depth * 2, i.name, i.milliseconds);
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Rendering
+{
+    // Measures GPU time spent in named scopes using timestamp queries
+    // Each frame in flight gets its own query pool, and results are read back the next time that
+    // frame slot comes around - after it has been waited on - so reading never stalls
+    class GpuProfiler
+    {
+        public:
+            struct ScopeResult
+            {
+                std::string name;
+                uint32_t depth;
+                double milliseconds;
+            };
+
+            // Writes timestamps around the lifetime of the object
+            class Scope
+            {
+                public:
+                    Scope(GpuProfiler& profiler, const vk::CommandBuffer& commandBuffer, const std::string_view& name);
+                    ~Scope();
+
+                    Scope(const Scope&) = delete;
+                    Scope& operator=(const Scope&) = delete;
+
+                private:
+                    GpuProfiler& m_profiler;
+                    vk::CommandBuffer m_commandBuffer;
+                    std::optional<uint32_t> m_scopeIndex;
+            };
+
+            GpuProfiler(size_t frameCount, uint32_t maxScopesPerFrame = 64);
+            ~GpuProfiler();
+
+            bool getIsSupported() const {
+                return m_isSupported;
+            }
+
+            // Must be called at the start of a frame's command buffer, after the frame has been
+            // waited on
+            // Resolves the results from the last time this frame slot was used and resets its queries
+            void beginFrame(size_t frameIndex, uint64_t frameNumber, const vk::CommandBuffer& commandBuffer);
+
+            // Resolves a frame slot's results early, once it has been waited on
+            void resolve(size_t frameIndex) {
+                resolveFrame(m_frames[frameIndex]);
+            }
+
+            // Scopes must be properly nested, and ended on the command buffer they were begun on
+            std::optional<uint32_t> beginScope(const vk::CommandBuffer& commandBuffer, const std::string_view& name);
+            void endScope(const vk::CommandBuffer& commandBuffer, uint32_t scopeIndex);
+
+            // Results of the most recently resolved frame
+            const auto& getResults() const {
+                return m_results;
+            }
+            auto getResultsFrameNumber() const {
+                return m_resultsFrameNumber;
+            }
+            std::optional<double> getScopeMilliseconds(const std::string_view& name) const;
+
+            // Logs resolved results every N frames, or never if 0
+            void setLogInterval(uint64_t frames) {
+                m_logInterval = frames;
+            }
+
+        private:
+            struct ScopeRecord
+            {
+                std::string name;
+                uint32_t depth;
+                uint32_t beginQuery;
+                std::optional<uint32_t> endQuery;
+            };
+
+            struct FrameQueries
+            {
+                FrameQueries() :
+                    queryPool(nullptr)
+                {};
+
+                vk::UniqueQueryPool queryPool;
+                std::vector<ScopeRecord> scopes;
+                uint32_t usedQueries = 0;
+                std::optional<uint64_t> frameNumber;
+            };
+
+            void resolveFrame(FrameQueries& frame);
+            void logResults() const;
+
+            bool m_isSupported;
+            uint32_t m_maxQueries;
+            double m_timestampPeriod;
+            uint64_t m_timestampMask;
+            uint64_t m_logInterval = 0;
+
+            std::vector<FrameQueries> m_frames;
+            FrameQueries* m_currentFrame = nullptr;
+            uint32_t m_currentDepth = 0;
+            bool m_hasWarnedOverflow = false;
+
+            std::vector<ScopeResult> m_results;
+            std::optional<uint64_t> m_resultsFrameNumber;
+    };
+}
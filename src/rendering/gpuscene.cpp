@@ -0,0 +1,142 @@
+#include "gpuscene.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    // Matches local_size_x in cull.comp
+    static constexpr uint32_t cullGroupSize = 64;
+
+    GpuScene::GpuScene(const Shader& cullShader, UploadQueue& uploadQueue, DescriptorAllocator& descriptorAllocator,
+        const Mesh& mesh, const std::vector<Instance>& instances, size_t frameCount,
+        bool asyncCompute) :
+        m_mesh(mesh), m_descriptorAllocator(descriptorAllocator), m_cullPipeline(cullShader),
+        m_instanceCount(static_cast<uint32_t>(instances.size()))
+    {
+        PROFILE_FUNCTION();
+
+        if (!Context::get().getDevice().getIsIndirectCountEnabled())
+        {
+            throw std::runtime_error("GPU driven rendering needs indirect count support");
+        }
+        if (instances.empty())
+        {
+            throw std::runtime_error("GPU scenes need at least one instance");
+        }
+
+        // Anything past the device's limit is culled as if it were out of view
+        auto limits = Context::get().getDevice().getProperties().getDeviceProperties().limits;
+        m_maxDrawCount = std::min(m_instanceCount, limits.maxDrawIndirectCount);
+        if (m_maxDrawCount < m_instanceCount)
+        {
+            spdlog::warn("Only drawing {} of {} instances, as that's the most one indirect draw can do",
+                m_maxDrawCount, m_instanceCount);
+        }
+
+        spdlog::info("Creating GPU scene with {} instances", m_instanceCount);
+
+        // Sharing the buffers saves transferring ownership between the queues twice a frame, and the
+        // instances are uploaded on the transfer queue, so it needs them too
+        std::vector<uint32_t> queueFamilies;
+        std::vector<uint32_t> instanceQueueFamilies;
+        if (asyncCompute)
+        {
+            auto properties = Context::get().getDevice().getProperties();
+            queueFamilies = {properties.getGraphicsQueue(), properties.getComputeQueue()};
+            instanceQueueFamilies = {properties.getGraphicsQueue(), properties.getComputeQueue(),
+                properties.getTransferQueue()};
+        }
+
+        m_instanceBuffer.emplace(instances.size() * sizeof(Instance),
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+            MemoryAllocator::AllocationInfo(), instanceQueueFamilies);
+        uploadQueue.uploadBuffer(m_instanceBuffer.value(), instances,
+            vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eVertexShader,
+            vk::AccessFlagBits::eShaderRead);
+
+        auto& cullLayout = m_cullPipeline.getDescriptorSetLayouts().front();
+        m_frames.resize(frameCount);
+        for (auto& i : m_frames)
+        {
+            i.drawCommands.emplace(instances.size() * sizeof(vk::DrawIndexedIndirectCommand),
+                vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+                MemoryAllocator::AllocationInfo(), queueFamilies);
+            i.drawCount.emplace(sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer |
+                vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                MemoryAllocator::AllocationInfo(), queueFamilies);
+
+            std::vector<DescriptorAllocator::Binding> bindings(3);
+            bindings[0].binding = 0;
+            bindings[0].type = vk::DescriptorType::eStorageBuffer;
+            bindings[0].buffer = vk::DescriptorBufferInfo{m_instanceBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+            bindings[1].binding = 1;
+            bindings[1].type = vk::DescriptorType::eStorageBuffer;
+            bindings[1].buffer = vk::DescriptorBufferInfo{i.drawCommands->getBuffer(), 0, VK_WHOLE_SIZE};
+            bindings[2].binding = 2;
+            bindings[2].type = vk::DescriptorType::eStorageBuffer;
+            bindings[2].buffer = vk::DescriptorBufferInfo{i.drawCount->getBuffer(), 0, VK_WHOLE_SIZE};
+            i.cullSet = m_descriptorAllocator.getCachedSet(cullLayout, bindings);
+        }
+    }
+
+
+    void GpuScene::cull(const vk::CommandBuffer& commandBuffer, size_t frameIndex, const ViewBounds& viewBounds)
+    {
+        PROFILE_FUNCTION();
+
+        auto& frame = m_frames[frameIndex];
+
+        // The frame has been waited on, so last use of these buffers is done
+        commandBuffer.fillBuffer(frame.drawCount->getBuffer(), 0, sizeof(uint32_t), 0);
+
+        vk::BufferMemoryBarrier clearBarrier;
+        clearBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        clearBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+        clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        clearBarrier.buffer = frame.drawCount->getBuffer();
+        clearBarrier.offset = 0;
+        clearBarrier.size = VK_WHOLE_SIZE;
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+            {}, {}, {clearBarrier}, {});
+
+        CullParameters parameters{viewBounds, m_instanceCount, m_mesh.getIndexCount()};
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_cullPipeline.getPipeline());
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_cullPipeline.getPipelineLayout(), 0,
+            {frame.cullSet}, {});
+        commandBuffer.pushConstants(m_cullPipeline.getPipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0,
+            sizeof(parameters), &parameters);
+        commandBuffer.dispatch((m_instanceCount + cullGroupSize - 1) / cullGroupSize, 1, 1);
+    }
+
+    void GpuScene::draw(const vk::CommandBuffer& commandBuffer, size_t frameIndex, const Pipeline& pipeline,
+        const ViewBounds& viewBounds)
+    {
+        PROFILE_FUNCTION();
+
+        auto& frame = m_frames[frameIndex];
+
+        // Pipelines sharing a layout share the set, so this is a lookup after the first frame
+        DescriptorAllocator::Binding binding;
+        binding.binding = 0;
+        binding.type = vk::DescriptorType::eStorageBuffer;
+        binding.buffer = vk::DescriptorBufferInfo{m_instanceBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+        auto instanceSet = m_descriptorAllocator.getCachedSet(pipeline.getDescriptorSetLayouts().front(), {binding});
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline.getPipeline());
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline.getPipelineLayout(), 0,
+            {instanceSet}, {});
+        commandBuffer.pushConstants(pipeline.getPipelineLayout(), vk::ShaderStageFlagBits::eVertex, 0,
+            sizeof(viewBounds), viewBounds.data());
+        m_mesh.bind(commandBuffer);
+
+        commandBuffer.drawIndexedIndirectCount(frame.drawCommands->getBuffer(), 0, frame.drawCount->getBuffer(), 0,
+            m_maxDrawCount, sizeof(vk::DrawIndexedIndirectCommand));
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "buffer.hpp"
+#include "computepipeline.hpp"
+#include "descriptorallocator.hpp"
+#include "mesh.hpp"
+#include "pipeline.hpp"
+#include "upload.hpp"
+
+namespace Rendering
+{
+    // Instances of a mesh drawn without the CPU touching each one
+    // Instance data is uploaded once, then every frame a compute pass culls the instances against the
+    // view and writes an indexed indirect draw for each visible one, along with the number of draws,
+    // so the whole scene goes out in a single drawIndexedIndirectCount
+    // Needs the device's indirect count support
+    class GpuScene
+    {
+        public:
+            // Matches the instance buffer in cull.comp and gpudriven.vert
+            struct Instance
+            {
+                std::array<float, 2> position;
+                float scale;
+                // Bounding circle around the scaled mesh, centered on the position
+                float radius;
+            };
+
+            // View rectangle in scene space, as min xy then max xy
+            using ViewBounds = std::array<float, 4>;
+
+            // The cull shader and mesh have to outlive the scene
+            // Scenes culled on the async compute queue share their buffers with its queue family
+            GpuScene(const Shader& cullShader, UploadQueue& uploadQueue, DescriptorAllocator& descriptorAllocator,
+                const Mesh& mesh, const std::vector<Instance>& instances, size_t frameCount,
+                bool asyncCompute = false);
+
+            GpuScene(const GpuScene&) = delete;
+            GpuScene& operator=(const GpuScene&) = delete;
+
+            // Must be recorded outside of a render pass, before draw is recorded for the same frame
+            // With async compute this goes in a compute queue command buffer instead, which the graphics
+            // submission waits on
+            // The draw commands and count are written by compute shaders, and the caller has to make
+            // them visible to indirect reads, like by declaring them in a render graph
+            void cull(const vk::CommandBuffer& commandBuffer, size_t frameIndex, const ViewBounds& viewBounds);
+
+            // Draws every instance that survived culling with a pipeline built from gpudriven.vert, or a
+            // vertex shader with the same interface
+            void draw(const vk::CommandBuffer& commandBuffer, size_t frameIndex, const Pipeline& pipeline,
+                const ViewBounds& viewBounds);
+
+            const vk::Buffer& getDrawCommandBuffer(size_t frameIndex) const {
+                return m_frames[frameIndex].drawCommands->getBuffer();
+            }
+            // Also cleared by a transfer at the start of culling
+            const vk::Buffer& getDrawCountBuffer(size_t frameIndex) const {
+                return m_frames[frameIndex].drawCount->getBuffer();
+            }
+            auto getInstanceCount() const {
+                return m_instanceCount;
+            }
+
+        private:
+            // Matches the push constants in cull.comp
+            struct CullParameters
+            {
+                ViewBounds viewBounds;
+                uint32_t instanceCount;
+                uint32_t indexCount;
+            };
+
+            // Written by the cull pass while the previous frames may still be drawing from theirs
+            struct FrameBuffers
+            {
+                std::optional<Buffer> drawCommands;
+                std::optional<Buffer> drawCount;
+                vk::DescriptorSet cullSet;
+            };
+
+            const Mesh& m_mesh;
+            DescriptorAllocator& m_descriptorAllocator;
+            ComputePipeline m_cullPipeline;
+            uint32_t m_instanceCount;
+            uint32_t m_maxDrawCount;
+
+            std::optional<Buffer> m_instanceBuffer;
+            std::vector<FrameBuffers> m_frames;
+    };
+}
@@ -1,7 +1,7 @@
 #include "instance.hpp"
 
 // Standard libraries
-#include <exception>
+#include <stdexcept>
 #include <vector>
 #include <string>
 
@@ -11,6 +11,8 @@
 #include <SDL2/SDL_vulkan.h>
 #include <vulkan/vulkan.hpp>
 
+#include "settings.hpp"
+
 
 // Allow default Vulkan-Hpp loader
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
@@ -43,7 +45,17 @@ namespace Rendering
     // Private
     Instance::Instance()
     {
-        initializeSdl();
+        // Headless rendering never opens a window, so there's no reason to bring up
+        // SDL video - load Vulkan directly instead
+        if (settings.headless)
+        {
+            loadVulkanLibrary();
+        }
+        else
+        {
+            initializeSdl();
+        }
+
         initializeVulkan();
 
         #ifndef NDEBUG
@@ -66,14 +78,28 @@ namespace Rendering
         if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0)
         {
             spdlog::error("SDL failed to initialize: {}", SDL_GetError());
-            throw std::exception("SDL initialization failure");
+            throw std::runtime_error("SDL initialization failure");
         }
 
         spdlog::info("Loading Vulkan library");
         if (SDL_Vulkan_LoadLibrary(nullptr) != 0)
         {
             spdlog::error("Failed to load Vulkan library: {}", SDL_GetError());
-            throw std::exception("SDL Vulkan library load failure");
+            throw std::runtime_error("SDL Vulkan library load failure");
+        }
+    }
+
+    void Instance::loadVulkanLibrary()
+    {
+        spdlog::info("Loading Vulkan library without SDL");
+        try
+        {
+            m_dynamicLoader.emplace();
+        }
+        catch (const std::exception& exception)
+        {
+            spdlog::error("Failed to load Vulkan library: {}", exception.what());
+            throw;
         }
     }
 
@@ -81,8 +107,16 @@ namespace Rendering
     {
         // Set up Vulkan dynamic loader to get access to extension functions
         // SDL provides a function to get the vkGetInstanceProcAddress function pointer via its own chosen
-        // Vulkan loader
-        auto getInstanceProcAddr = static_cast<PFN_vkGetInstanceProcAddr>(SDL_Vulkan_GetVkGetInstanceProcAddr());
+        // Vulkan loader, otherwise we grab it from our own loader in headless mode
+        PFN_vkGetInstanceProcAddr getInstanceProcAddr;
+        if (m_dynamicLoader.has_value())
+        {
+            getInstanceProcAddr = m_dynamicLoader->getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
+        }
+        else
+        {
+            getInstanceProcAddr = static_cast<PFN_vkGetInstanceProcAddr>(SDL_Vulkan_GetVkGetInstanceProcAddr());
+        }
         VULKAN_HPP_DEFAULT_DISPATCHER.init(getInstanceProcAddr);
 
         // Basic application info for driver support
@@ -126,12 +160,6 @@ namespace Rendering
 
     std::vector<const char*> Instance::getRequiredExtensions()
     {
-        // Query extensions required for rendering to SDL window
-        unsigned int sdlRequiredExtensionCount;
-        SDL_Vulkan_GetInstanceExtensions(nullptr, &sdlRequiredExtensionCount, nullptr);
-        const char** sdlRequiredExtensionNames = new const char*[sdlRequiredExtensionCount];
-        SDL_Vulkan_GetInstanceExtensions(nullptr, &sdlRequiredExtensionCount, sdlRequiredExtensionNames);
-
         std::vector<const char*> requiredExtensions;
 
         // Request the debug trace extension in debug builds
@@ -139,12 +167,22 @@ namespace Rendering
         requiredExtensions.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         #endif
 
-        // Add the SDL extensions to the full list
-        for (unsigned int i = 0; i < sdlRequiredExtensionCount; i++)
+        // Headless rendering doesn't need any surface extensions
+        if (settings.headless)
         {
-            requiredExtensions.push_back(sdlRequiredExtensionNames[i]);
+            return requiredExtensions;
         }
 
+        // Query extensions required for rendering to SDL window
+        unsigned int sdlRequiredExtensionCount;
+        SDL_Vulkan_GetInstanceExtensions(nullptr, &sdlRequiredExtensionCount, nullptr);
+        std::vector<const char*> sdlRequiredExtensionNames(sdlRequiredExtensionCount);
+        SDL_Vulkan_GetInstanceExtensions(nullptr, &sdlRequiredExtensionCount, sdlRequiredExtensionNames.data());
+
+        // Add the SDL extensions to the full list
+        requiredExtensions.insert(requiredExtensions.end(), sdlRequiredExtensionNames.begin(),
+            sdlRequiredExtensionNames.end());
+
         return requiredExtensions;
     }
 
@@ -3,6 +3,8 @@
 // Defines a singleton to access a Vulkan instance
 // Also hooks in SDL initialization as it is required for Vulkan use
 
+#include <optional>
+
 #include <vulkan/vulkan.hpp>
 
 namespace Rendering
@@ -21,6 +23,7 @@ namespace Rendering
 
             // Initialization steps
             void initializeSdl();
+            void loadVulkanLibrary();
             void initializeVulkan();
             void setupVulkanDebug();
 
@@ -28,6 +31,9 @@ namespace Rendering
             std::vector<const char*> getRequiredExtensions();
             std::vector<const char*> getSupportedValidationLayers();
 
+            // Only used when SDL isn't loading Vulkan for us
+            std::optional<vk::DynamicLoader> m_dynamicLoader;
+
             vk::UniqueInstance m_vulkanInstance;
             vk::UniqueDebugUtilsMessengerEXT m_vulkanDebugMessenger;
     };
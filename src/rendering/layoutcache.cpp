@@ -0,0 +1,213 @@
+#include "layoutcache.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "device.hpp"
+#include "shader.hpp"
+#include "util/hash.hpp"
+
+namespace Rendering
+{
+    LayoutCache::LayoutCache(Device& device) :
+        m_device(device)
+    {}
+
+
+    vk::DescriptorSetLayout LayoutCache::getDescriptorSetLayout(
+        const std::vector<vk::DescriptorSetLayoutBinding>& bindings)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto setLayout = m_setLayouts.find(bindings);
+        if (setLayout == m_setLayouts.end())
+        {
+            vk::DescriptorSetLayoutCreateInfo createInfo;
+            createInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+            createInfo.pBindings = bindings.data();
+
+            spdlog::info("Creating descriptor set layout with {} bindings", bindings.size());
+            setLayout = m_setLayouts.emplace(bindings,
+                m_device.getVulkanDevice().createDescriptorSetLayoutUnique(createInfo)).first;
+        }
+
+        return *setLayout->second;
+    }
+
+    vk::PipelineLayout LayoutCache::getPipelineLayout(const std::vector<vk::DescriptorSetLayout>& setLayouts,
+        const std::vector<vk::PushConstantRange>& pushConstantRanges)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        PipelineLayoutKey key{setLayouts, pushConstantRanges};
+        auto pipelineLayout = m_pipelineLayouts.find(key);
+        if (pipelineLayout == m_pipelineLayouts.end())
+        {
+            vk::PipelineLayoutCreateInfo createInfo;
+            createInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+            createInfo.pSetLayouts = setLayouts.data();
+            createInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+            createInfo.pPushConstantRanges = pushConstantRanges.data();
+
+            spdlog::info("Creating pipeline layout with {} descriptor sets and {} push constant ranges",
+                setLayouts.size(), pushConstantRanges.size());
+            pipelineLayout = m_pipelineLayouts.emplace(std::move(key),
+                m_device.getVulkanDevice().createPipelineLayoutUnique(createInfo)).first;
+        }
+
+        return *pipelineLayout->second;
+    }
+
+    ShaderLayout LayoutCache::getShaderLayout(const std::vector<const Shader*>& shaders, bool dynamicUniformBuffers)
+    {
+        // Bindings by set then binding number, gathered from every stage
+        std::map<uint32_t, std::map<uint32_t, vk::DescriptorSetLayoutBinding>> sets;
+        std::vector<vk::PushConstantRange> pushConstantRanges;
+        std::set<uint32_t> bindlessSets;
+
+        for (auto shader : shaders)
+        {
+            auto& reflection = shader->getReflection();
+
+            for (auto& i : reflection.descriptorBindings)
+            {
+                // Runtime sized arrays live in the bindless table, which brings its own layout
+                if (i.count == 0)
+                {
+                    auto bindlessTable = Context::getBindlessTable();
+                    if (bindlessTable == nullptr)
+                    {
+                        throw std::runtime_error("Runtime sized descriptor arrays need bindless support");
+                    }
+                    if (bindlessTable->getBindingType(i.binding) != i.type)
+                    {
+                        spdlog::error("Descriptor set {} binding {} doesn't match the bindless table", i.set,
+                            i.binding);
+                        throw std::runtime_error("Mismatched bindless descriptor binding");
+                    }
+
+                    bindlessSets.insert(i.set);
+                    continue;
+                }
+
+                auto type = i.type;
+                if (dynamicUniformBuffers && type == vk::DescriptorType::eUniformBuffer)
+                {
+                    type = vk::DescriptorType::eUniformBufferDynamic;
+                }
+
+                auto [binding, isNew] = sets[i.set].try_emplace(i.binding, i.binding, type, i.count,
+                    reflection.stage);
+                if (isNew)
+                {
+                    continue;
+                }
+
+                // Stages sharing a binding have to agree on what's bound there
+                if (binding->second.descriptorType != type || binding->second.descriptorCount != i.count)
+                {
+                    spdlog::error("Shader stages disagree on descriptor set {} binding {}", i.set, i.binding);
+                    throw std::runtime_error("Mismatched descriptor bindings between shader stages");
+                }
+                binding->second.stageFlags |= reflection.stage;
+            }
+
+            // Stages using the same block share one range
+            for (auto& i : reflection.pushConstantRanges)
+            {
+                auto range = std::find_if(pushConstantRanges.begin(), pushConstantRanges.end(),
+                    [&](const auto& other) {
+                        return other.offset == i.offset && other.size == i.size;
+                    });
+                if (range == pushConstantRanges.end())
+                {
+                    pushConstantRanges.push_back(i);
+                }
+                else
+                {
+                    range->stageFlags |= i.stageFlags;
+                }
+            }
+        }
+
+        // Set numbers index the layouts, so any unused sets in between get an empty layout
+        ShaderLayout layout;
+        uint32_t setCount = std::max(sets.empty() ? 0 : sets.rbegin()->first + 1,
+            bindlessSets.empty() ? 0 : *bindlessSets.rbegin() + 1);
+        for (uint32_t set = 0; set < setCount; set++)
+        {
+            if (bindlessSets.count(set) != 0)
+            {
+                if (!sets[set].empty())
+                {
+                    spdlog::error("Descriptor set {} mixes bindless arrays with other bindings", set);
+                    throw std::runtime_error("Bindless arrays must have a descriptor set to themselves");
+                }
+
+                layout.setLayouts.push_back(Context::getBindlessTable()->getLayout());
+                continue;
+            }
+
+            std::vector<vk::DescriptorSetLayoutBinding> bindings;
+            for (auto& i : sets[set])
+            {
+                bindings.push_back(i.second);
+            }
+            layout.setLayouts.push_back(getDescriptorSetLayout(bindings));
+        }
+        layout.pipelineLayout = getPipelineLayout(layout.setLayouts, pushConstantRanges);
+
+        return layout;
+    }
+
+    size_t LayoutCache::getDescriptorSetLayoutCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_setLayouts.size();
+    }
+
+    size_t LayoutCache::getPipelineLayoutCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pipelineLayouts.size();
+    }
+
+
+    size_t LayoutCache::SetLayoutHash::operator()(const std::vector<vk::DescriptorSetLayoutBinding>& bindings) const
+    {
+        size_t seed = 0;
+
+        for (auto& i : bindings)
+        {
+            Util::hashCombine(seed, i.binding);
+            Util::hashCombine(seed, i.descriptorType);
+            Util::hashCombine(seed, i.descriptorCount);
+            Util::hashCombine(seed, static_cast<VkShaderStageFlags>(i.stageFlags));
+        }
+
+        return seed;
+    }
+
+    size_t LayoutCache::PipelineLayoutHash::operator()(const PipelineLayoutKey& key) const
+    {
+        size_t seed = 0;
+
+        for (auto& i : key.setLayouts)
+        {
+            Util::hashCombine(seed, static_cast<VkDescriptorSetLayout>(i));
+        }
+        for (auto& i : key.pushConstantRanges)
+        {
+            Util::hashCombine(seed, static_cast<VkShaderStageFlags>(i.stageFlags));
+            Util::hashCombine(seed, i.offset);
+            Util::hashCombine(seed, i.size);
+        }
+
+        return seed;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Rendering
+{
+    class Device;
+    class Shader;
+
+    // Layouts shared by every stage of a pipeline, with set layouts indexed by set number
+    struct ShaderLayout
+    {
+        vk::PipelineLayout pipelineLayout;
+        std::vector<vk::DescriptorSetLayout> setLayouts;
+    };
+
+    // Deduplicates descriptor set and pipeline layouts, so every pipeline with the same resources
+    // shares the same layout objects - pipelines with matching layouts can then keep descriptor sets
+    // bound between draws
+    // Layouts live as long as the cache, and it's safe to request them from any thread
+    class LayoutCache
+    {
+        public:
+            LayoutCache(Device& device);
+
+            vk::DescriptorSetLayout getDescriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+            vk::PipelineLayout getPipelineLayout(const std::vector<vk::DescriptorSetLayout>& setLayouts,
+                const std::vector<vk::PushConstantRange>& pushConstantRanges);
+
+            // Merges the resources of every shader stage into cached layouts, with empty layouts filling
+            // any gaps between sets
+            // Uniform buffers become dynamic uniform buffers if requested
+            ShaderLayout getShaderLayout(const std::vector<const Shader*>& shaders, bool dynamicUniformBuffers);
+
+            size_t getDescriptorSetLayoutCount() const;
+            size_t getPipelineLayoutCount() const;
+
+        private:
+            // Immutable samplers aren't supported, so bindings compare by value
+            struct SetLayoutHash
+            {
+                size_t operator()(const std::vector<vk::DescriptorSetLayoutBinding>& bindings) const;
+            };
+
+            struct PipelineLayoutKey
+            {
+                std::vector<vk::DescriptorSetLayout> setLayouts;
+                std::vector<vk::PushConstantRange> pushConstantRanges;
+
+                bool operator==(const PipelineLayoutKey& other) const {
+                    return setLayouts == other.setLayouts && pushConstantRanges == other.pushConstantRanges;
+                }
+            };
+
+            struct PipelineLayoutHash
+            {
+                size_t operator()(const PipelineLayoutKey& key) const;
+            };
+
+            Device& m_device;
+
+            mutable std::mutex m_mutex;
+            std::unordered_map<std::vector<vk::DescriptorSetLayoutBinding>, vk::UniqueDescriptorSetLayout,
+                SetLayoutHash> m_setLayouts;
+            std::unordered_map<PipelineLayoutKey, vk::UniquePipelineLayout, PipelineLayoutHash> m_pipelineLayouts;
+    };
+}
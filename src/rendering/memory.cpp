@@ -0,0 +1,410 @@
+#include "memory.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    // Size of the blocks we request from the driver, unless the heap is small
+    static const vk::DeviceSize defaultBlockSize = 64 * 1024 * 1024;
+    static const vk::DeviceSize minimumBlockSize = 1024 * 1024;
+
+    // Anything bigger than this fraction of a block gets a dedicated allocation
+    static const vk::DeviceSize dedicatedAllocationDivisor = 2;
+
+    static double toMebibytes(vk::DeviceSize bytes)
+    {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+
+
+
+    MemoryAllocation::MemoryAllocation(MemoryAllocation&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MemoryAllocation& MemoryAllocation::operator=(MemoryAllocation&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+
+            m_allocator = other.m_allocator;
+            m_block = other.m_block;
+            m_memory = other.m_memory;
+            m_offset = other.m_offset;
+            m_size = other.m_size;
+            m_memoryType = other.m_memoryType;
+            m_mappedData = other.m_mappedData;
+
+            other.m_allocator = nullptr;
+            other.m_block = nullptr;
+        }
+
+        return *this;
+    }
+
+    MemoryAllocation::~MemoryAllocation()
+    {
+        release();
+    }
+
+    void MemoryAllocation::release()
+    {
+        if (m_allocator != nullptr)
+        {
+            m_allocator->free(*this);
+            m_allocator = nullptr;
+            m_block = nullptr;
+        }
+    }
+
+
+
+    MemoryAllocator::MemoryAllocator(const vk::Device& device, const vk::PhysicalDeviceMemoryProperties& memoryProperties,
+        const vk::PhysicalDeviceLimits& limits) :
+        m_device(device), m_memoryProperties(memoryProperties),
+        m_maxAllocationCount(limits.maxMemoryAllocationCount),
+        m_dedicatedBytes(memoryProperties.memoryHeapCount, 0),
+        m_dedicatedCounts(memoryProperties.memoryHeapCount, 0)
+    {
+        spdlog::info("Creating memory allocator for {} memory types in {} heaps",
+            m_memoryProperties.memoryTypeCount, m_memoryProperties.memoryHeapCount);
+    }
+
+    MemoryAllocator::~MemoryAllocator()
+    {
+        spdlog::info("Destroying memory allocator");
+        logStatistics();
+
+        // Anything still in a pool at this point is leaked by its owner, but the blocks
+        // need to go before the device does
+        for (auto& [key, blocks] : m_pools)
+        {
+            for (auto& i : blocks)
+            {
+                if (!i->subAllocator->getIsEmpty())
+                {
+                    spdlog::warn("Freeing memory block with {} live allocations", i->subAllocator->getAllocationCount());
+                }
+                m_device.freeMemory(i->memory);
+            }
+        }
+    }
+
+
+    MemoryAllocation MemoryAllocator::allocate(const vk::MemoryRequirements& requirements, const AllocationInfo& info,
+        bool isOptimalImage)
+    {
+        PROFILE_FUNCTION();
+        std::lock_guard lock(m_mutex);
+
+        auto memoryTypes = findMemoryTypes(requirements.memoryTypeBits, info);
+        if (memoryTypes.empty())
+        {
+            spdlog::error("No memory type supports the requested properties {:#x}",
+                static_cast<uint32_t>(info.requiredFlags));
+            throw std::runtime_error("No suitable memory type");
+        }
+
+        // Try each usable memory type in turn, in case some heaps are full
+        for (auto memoryType : memoryTypes)
+        {
+            std::optional<MemoryAllocation> allocation;
+
+            bool useDedicated = info.dedicated ||
+                requirements.size > getBlockSize(memoryType) / dedicatedAllocationDivisor;
+            if (!useDedicated)
+            {
+                allocation = allocateFromPool({memoryType, info.strategy, isOptimalImage}, requirements);
+            }
+
+            // If we can't get a new block, a smaller dedicated allocation might still fit
+            if (!allocation.has_value())
+            {
+                allocation = allocateDedicated(memoryType, requirements.size);
+            }
+
+            if (allocation.has_value())
+            {
+                return std::move(allocation.value());
+            }
+        }
+
+        spdlog::error("Out of device memory allocating {} bytes", requirements.size);
+        throw std::runtime_error("Out of device memory");
+    }
+
+    MemoryAllocation MemoryAllocator::allocateForBuffer(const vk::Buffer& buffer, const AllocationInfo& info)
+    {
+        auto allocation = allocate(m_device.getBufferMemoryRequirements(buffer), info);
+        m_device.bindBufferMemory(buffer, allocation.getMemory(), allocation.getOffset());
+        return allocation;
+    }
+
+    MemoryAllocation MemoryAllocator::allocateForImage(const vk::Image& image, const AllocationInfo& info,
+        bool isOptimalImage)
+    {
+        auto allocation = allocate(m_device.getImageMemoryRequirements(image), info, isOptimalImage);
+        m_device.bindImageMemory(image, allocation.getMemory(), allocation.getOffset());
+        return allocation;
+    }
+
+    std::vector<MemoryAllocator::HeapStatistics> MemoryAllocator::getStatistics() const
+    {
+        std::lock_guard lock(m_mutex);
+
+        std::vector<HeapStatistics> statistics(m_memoryProperties.memoryHeapCount);
+        for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++)
+        {
+            statistics[i].heapSize = m_memoryProperties.memoryHeaps[i].size;
+            statistics[i].heapFlags = m_memoryProperties.memoryHeaps[i].flags;
+            statistics[i].dedicatedBytes = m_dedicatedBytes[i];
+            statistics[i].dedicatedCount = m_dedicatedCounts[i];
+            statistics[i].allocationCount = m_dedicatedCounts[i];
+        }
+
+        for (auto& [key, blocks] : m_pools)
+        {
+            auto& heap = statistics[m_memoryProperties.memoryTypes[std::get<0>(key)].heapIndex];
+            for (auto& i : blocks)
+            {
+                heap.blockBytes += i->subAllocator->getSize();
+                heap.usedBytes += i->subAllocator->getUsedBytes();
+                heap.allocationCount += i->subAllocator->getAllocationCount();
+                heap.blockCount++;
+            }
+        }
+
+        return statistics;
+    }
+
+    void MemoryAllocator::logStatistics() const
+    {
+        auto statistics = getStatistics();
+
+        spdlog::info("Device memory usage:");
+        for (size_t i = 0; i < statistics.size(); i++)
+        {
+            auto& heap = statistics[i];
+            spdlog::info("\tHeap {} ({}, {:.1f} MiB): {:.1f} of {:.1f} MiB used in {} blocks, "
+                "{} dedicated allocations using {:.1f} MiB, {} allocations total",
+                i, (heap.heapFlags & vk::MemoryHeapFlagBits::eDeviceLocal) ? "device local" : "host",
+                toMebibytes(heap.heapSize), toMebibytes(heap.usedBytes), toMebibytes(heap.blockBytes),
+                heap.blockCount, heap.dedicatedCount, toMebibytes(heap.dedicatedBytes), heap.allocationCount);
+        }
+    }
+
+
+    std::vector<uint32_t> MemoryAllocator::findMemoryTypes(uint32_t typeBits, const AllocationInfo& info) const
+    {
+        std::vector<uint32_t> preferredTypes;
+        std::vector<uint32_t> requiredTypes;
+
+        for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+        {
+            auto flags = m_memoryProperties.memoryTypes[i].propertyFlags;
+            if ((typeBits & (1u << i)) == 0 || (flags & info.requiredFlags) != info.requiredFlags)
+            {
+                continue;
+            }
+
+            if ((flags & info.preferredFlags) == info.preferredFlags)
+            {
+                preferredTypes.push_back(i);
+            }
+            else
+            {
+                requiredTypes.push_back(i);
+            }
+        }
+
+        preferredTypes.insert(preferredTypes.end(), requiredTypes.begin(), requiredTypes.end());
+        return preferredTypes;
+    }
+
+    vk::DeviceSize MemoryAllocator::getBlockSize(uint32_t memoryType) const
+    {
+        // Small heaps (like host visible device memory windows) get smaller blocks
+        // Blocks are kept to a power of two so the buddy allocator can use all of it
+        auto heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+        auto blockSize = defaultBlockSize;
+        while (blockSize > minimumBlockSize && blockSize > heapSize / 8)
+        {
+            blockSize /= 2;
+        }
+
+        return blockSize;
+    }
+
+    std::optional<MemoryAllocation> MemoryAllocator::allocateFromPool(const PoolKey& key,
+        const vk::MemoryRequirements& requirements)
+    {
+        auto& blocks = m_pools[key];
+
+        auto makeAllocation = [&](MemoryBlock& block, vk::DeviceSize offset) {
+            MemoryAllocation allocation;
+            allocation.m_allocator = this;
+            allocation.m_block = &block;
+            allocation.m_memory = block.memory;
+            allocation.m_offset = offset;
+            allocation.m_size = requirements.size;
+            allocation.m_memoryType = block.memoryType;
+            allocation.m_mappedData = block.mappedData ?
+                static_cast<char*>(block.mappedData) + offset : nullptr;
+            return allocation;
+        };
+
+        // Look for space in an existing block
+        for (auto& i : blocks)
+        {
+            auto offset = i->subAllocator->allocate(requirements.size, requirements.alignment);
+            if (offset.has_value())
+            {
+                return makeAllocation(*i, offset.value());
+            }
+        }
+
+        // Otherwise we need a new block
+        auto memoryType = std::get<0>(key);
+        auto blockSize = getBlockSize(memoryType);
+        auto memory = allocateDeviceMemory(memoryType, blockSize);
+        if (!memory.has_value())
+        {
+            return {};
+        }
+
+        auto block = std::make_unique<MemoryBlock>();
+        block->memory = memory.value();
+        block->mappedData = mapIfHostVisible(memoryType, block->memory);
+        block->memoryType = memoryType;
+        block->strategy = std::get<1>(key);
+        block->isOptimalImage = std::get<2>(key);
+
+        switch (block->strategy)
+        {
+            case AllocationStrategy::Tlsf:
+                block->subAllocator = std::make_unique<TlsfSubAllocator>(blockSize);
+                break;
+
+            case AllocationStrategy::Buddy:
+                block->subAllocator = std::make_unique<BuddySubAllocator>(blockSize);
+                break;
+
+            case AllocationStrategy::Linear:
+                block->subAllocator = std::make_unique<LinearSubAllocator>(blockSize);
+                break;
+        }
+
+        spdlog::debug("Allocated {:.1f} MiB memory block for memory type {}", toMebibytes(blockSize), memoryType);
+
+        auto offset = block->subAllocator->allocate(requirements.size, requirements.alignment);
+        auto& newBlock = *blocks.emplace_back(std::move(block));
+        if (!offset.has_value())
+        {
+            return {};
+        }
+
+        return makeAllocation(newBlock, offset.value());
+    }
+
+    std::optional<MemoryAllocation> MemoryAllocator::allocateDedicated(uint32_t memoryType, vk::DeviceSize size)
+    {
+        auto memory = allocateDeviceMemory(memoryType, size);
+        if (!memory.has_value())
+        {
+            return {};
+        }
+
+        auto heapIndex = m_memoryProperties.memoryTypes[memoryType].heapIndex;
+        m_dedicatedBytes[heapIndex] += size;
+        m_dedicatedCounts[heapIndex]++;
+
+        MemoryAllocation allocation;
+        allocation.m_allocator = this;
+        allocation.m_memory = memory.value();
+        allocation.m_size = size;
+        allocation.m_memoryType = memoryType;
+        allocation.m_mappedData = mapIfHostVisible(memoryType, allocation.m_memory);
+
+        return allocation;
+    }
+
+    std::optional<vk::DeviceMemory> MemoryAllocator::allocateDeviceMemory(uint32_t memoryType, vk::DeviceSize size)
+    {
+        if (m_deviceAllocationCount >= m_maxAllocationCount)
+        {
+            spdlog::warn("Reached device memory allocation limit of {}", m_maxAllocationCount);
+            return {};
+        }
+
+        try
+        {
+            auto memory = m_device.allocateMemory({size, memoryType});
+            m_deviceAllocationCount++;
+            return memory;
+        }
+        catch (const vk::OutOfDeviceMemoryError&)
+        {
+            spdlog::warn("Out of device memory allocating {:.1f} MiB from memory type {}", toMebibytes(size), memoryType);
+        }
+        catch (const vk::OutOfHostMemoryError&)
+        {
+            spdlog::warn("Out of host memory allocating {:.1f} MiB from memory type {}", toMebibytes(size), memoryType);
+        }
+
+        return {};
+    }
+
+    void* MemoryAllocator::mapIfHostVisible(uint32_t memoryType, const vk::DeviceMemory& memory)
+    {
+        // Host visible memory stays mapped for its whole lifetime
+        if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+        {
+            return m_device.mapMemory(memory, 0, VK_WHOLE_SIZE);
+        }
+
+        return nullptr;
+    }
+
+    void MemoryAllocator::free(MemoryAllocation& allocation)
+    {
+        std::lock_guard lock(m_mutex);
+
+        // Dedicated allocations just go straight back to the driver
+        if (allocation.m_block == nullptr)
+        {
+            auto heapIndex = m_memoryProperties.memoryTypes[allocation.m_memoryType].heapIndex;
+            m_dedicatedBytes[heapIndex] -= allocation.m_size;
+            m_dedicatedCounts[heapIndex]--;
+
+            m_device.freeMemory(allocation.m_memory);
+            m_deviceAllocationCount--;
+            return;
+        }
+
+        auto& block = *allocation.m_block;
+        block.subAllocator->free(allocation.m_offset);
+
+        // Release empty blocks, but always keep one around per pool so we don't thrash
+        // allocating and freeing blocks
+        if (block.subAllocator->getIsEmpty())
+        {
+            auto& blocks = m_pools[{block.memoryType, block.strategy, block.isOptimalImage}];
+            if (blocks.size() > 1)
+            {
+                m_device.freeMemory(block.memory);
+                m_deviceAllocationCount--;
+
+                blocks.erase(std::find_if(blocks.begin(), blocks.end(), [&](const auto& i) {
+                    return i.get() == &block;
+                }));
+            }
+        }
+    }
+}
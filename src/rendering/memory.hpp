@@ -0,0 +1,180 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "suballocator.hpp"
+
+namespace Rendering
+{
+    class MemoryAllocator;
+    struct MemoryBlock;
+
+    // How ranges are handed out of a memory block
+    enum class AllocationStrategy
+    {
+        // General purpose, good fit for arbitrary sizes
+        Tlsf,
+        // Power of two sizes, fast with little fragmentation
+        Buddy,
+        // Bump allocation for short lived resources that are freed together
+        Linear
+    };
+
+    // A range of device memory owned by a resource
+    // Returns its range to the allocator when destroyed
+    class MemoryAllocation
+    {
+        friend class MemoryAllocator;
+
+        public:
+            MemoryAllocation() = default;
+            MemoryAllocation(MemoryAllocation&& other) noexcept;
+            MemoryAllocation& operator=(MemoryAllocation&& other) noexcept;
+            ~MemoryAllocation();
+
+            MemoryAllocation(const MemoryAllocation&) = delete;
+            MemoryAllocation& operator=(const MemoryAllocation&) = delete;
+
+            explicit operator bool() const {
+                return m_allocator != nullptr;
+            }
+
+            const vk::DeviceMemory& getMemory() const {
+                return m_memory;
+            }
+            auto getOffset() const {
+                return m_offset;
+            }
+            auto getSize() const {
+                return m_size;
+            }
+            auto getMemoryType() const {
+                return m_memoryType;
+            }
+            // Null unless the memory is host visible
+            void* getMappedData() const {
+                return m_mappedData;
+            }
+            bool getIsDedicated() const {
+                return m_block == nullptr;
+            }
+
+        private:
+            void release();
+
+            MemoryAllocator* m_allocator = nullptr;
+            // Null for dedicated allocations
+            MemoryBlock* m_block = nullptr;
+            vk::DeviceMemory m_memory;
+            vk::DeviceSize m_offset = 0;
+            vk::DeviceSize m_size = 0;
+            uint32_t m_memoryType = 0;
+            void* m_mappedData = nullptr;
+    };
+
+    // Large chunk of device memory that allocations are carved out of
+    struct MemoryBlock
+    {
+        vk::DeviceMemory memory;
+        void* mappedData;
+        std::unique_ptr<SubAllocator> subAllocator;
+
+        // Which pool the block belongs to
+        uint32_t memoryType;
+        AllocationStrategy strategy;
+        bool isOptimalImage;
+    };
+
+
+    // Grabs large blocks of device memory per memory type and sub-allocates resources from
+    // them, so we stay well clear of the driver's allocation count limit
+    // Large resources get their own dedicated allocation
+    class MemoryAllocator
+    {
+        friend class MemoryAllocation;
+
+        public:
+            struct AllocationInfo
+            {
+                AllocationInfo(vk::MemoryPropertyFlags requiredFlags = vk::MemoryPropertyFlagBits::eDeviceLocal,
+                    vk::MemoryPropertyFlags preferredFlags = {}) :
+                    requiredFlags(requiredFlags), preferredFlags(preferredFlags)
+                {};
+
+                vk::MemoryPropertyFlags requiredFlags;
+                // Used if there is a memory type with these in addition to the required flags
+                vk::MemoryPropertyFlags preferredFlags;
+                AllocationStrategy strategy = AllocationStrategy::Tlsf;
+                // Always give the resource its own allocation
+                bool dedicated = false;
+            };
+
+            struct HeapStatistics
+            {
+                vk::DeviceSize heapSize = 0;
+                vk::MemoryHeapFlags heapFlags;
+                // Memory allocated from the driver, in blocks and dedicated allocations
+                vk::DeviceSize blockBytes = 0;
+                vk::DeviceSize dedicatedBytes = 0;
+                // Memory actually handed out to resources from blocks
+                vk::DeviceSize usedBytes = 0;
+                uint32_t blockCount = 0;
+                uint32_t dedicatedCount = 0;
+                uint32_t allocationCount = 0;
+            };
+
+            MemoryAllocator(const vk::Device& device, const vk::PhysicalDeviceMemoryProperties& memoryProperties,
+                const vk::PhysicalDeviceLimits& limits);
+            ~MemoryAllocator();
+
+            MemoryAllocator(const MemoryAllocator&) = delete;
+            MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+            // Allocate memory for arbitrary requirements
+            // Optimal tiling images must say so, as they can't share pages with buffers
+            // and linear images on some devices
+            MemoryAllocation allocate(const vk::MemoryRequirements& requirements, const AllocationInfo& info,
+                bool isOptimalImage = false);
+
+            // Allocate and bind memory for a resource
+            MemoryAllocation allocateForBuffer(const vk::Buffer& buffer, const AllocationInfo& info);
+            MemoryAllocation allocateForImage(const vk::Image& image, const AllocationInfo& info,
+                bool isOptimalImage = true);
+
+            // One entry per memory heap
+            std::vector<HeapStatistics> getStatistics() const;
+            void logStatistics() const;
+
+        private:
+            // Blocks are grouped per memory type and strategy, and optimal tiling images are kept
+            // apart from everything else so we never need to worry about bufferImageGranularity
+            using PoolKey = std::tuple<uint32_t, AllocationStrategy, bool>;
+
+            // Memory types we could use, in order of preference
+            std::vector<uint32_t> findMemoryTypes(uint32_t typeBits, const AllocationInfo& info) const;
+            vk::DeviceSize getBlockSize(uint32_t memoryType) const;
+
+            std::optional<MemoryAllocation> allocateFromPool(const PoolKey& key, const vk::MemoryRequirements& requirements);
+            std::optional<MemoryAllocation> allocateDedicated(uint32_t memoryType, vk::DeviceSize size);
+            std::optional<vk::DeviceMemory> allocateDeviceMemory(uint32_t memoryType, vk::DeviceSize size);
+            void* mapIfHostVisible(uint32_t memoryType, const vk::DeviceMemory& memory);
+            void free(MemoryAllocation& allocation);
+
+            vk::Device m_device;
+            vk::PhysicalDeviceMemoryProperties m_memoryProperties;
+            uint32_t m_maxAllocationCount;
+
+            mutable std::mutex m_mutex;
+            std::map<PoolKey, std::vector<std::unique_ptr<MemoryBlock>>> m_pools;
+            std::vector<vk::DeviceSize> m_dedicatedBytes;
+            std::vector<uint32_t> m_dedicatedCounts;
+            uint32_t m_deviceAllocationCount = 0;
+    };
+}
@@ -0,0 +1,28 @@
+#include "mesh.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace Rendering
+{
+    Mesh::Mesh(UploadQueue& uploadQueue, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) :
+        m_indexCount(static_cast<uint32_t>(indices.size()))
+    {
+        spdlog::info("Creating mesh with {} vertices and {} indices", vertices.size(), indices.size());
+
+        m_vertexBuffer.emplace(vertices.size() * sizeof(Vertex),
+            vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+        m_indexBuffer.emplace(indices.size() * sizeof(uint32_t),
+            vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+
+        uploadQueue.uploadBuffer(m_vertexBuffer.value(), vertices,
+            vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eVertexAttributeRead);
+        uploadQueue.uploadBuffer(m_indexBuffer.value(), indices,
+            vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eIndexRead);
+    }
+
+    void Mesh::bind(const vk::CommandBuffer& commandBuffer) const
+    {
+        commandBuffer.bindVertexBuffers(0, {m_vertexBuffer->getBuffer()}, {0});
+        commandBuffer.bindIndexBuffer(m_indexBuffer->getBuffer(), 0, vk::IndexType::eUint32);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "buffer.hpp"
+#include "upload.hpp"
+#include "vertex.hpp"
+
+namespace Rendering
+{
+    // Indexed geometry stored in device local memory
+    class Mesh
+    {
+        public:
+            // Data is sent through the upload queue, so the mesh is usable once the uploads are
+            // flushed and acquired on a graphics command buffer
+            Mesh(UploadQueue& uploadQueue, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+            void bind(const vk::CommandBuffer& commandBuffer) const;
+
+            auto getIndexCount() const {
+                return m_indexCount;
+            }
+
+        private:
+            std::optional<Buffer> m_vertexBuffer;
+            std::optional<Buffer> m_indexBuffer;
+            uint32_t m_indexCount;
+    };
+}
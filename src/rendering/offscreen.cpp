@@ -0,0 +1,65 @@
+#include "offscreen.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "device.hpp"
+
+namespace Rendering
+{
+    OffscreenTarget::OffscreenTarget(vk::Extent2D extents, size_t imageCount) :
+        m_extents(extents)
+    {
+        m_surfaceFormat = Context::get().getDevice().getSurfaceFormat();
+        createImages(imageCount);
+    }
+
+    OffscreenTarget::~OffscreenTarget()
+    {
+        spdlog::info("Destroying offscreen render target");
+    }
+
+
+    void OffscreenTarget::createImages(size_t imageCount)
+    {
+        spdlog::info("Creating {} offscreen images of size {}x{}", imageCount, m_extents.width, m_extents.height);
+
+        auto& device = Context::getVulkanDevice();
+
+        m_images.resize(imageCount);
+        for (auto& i : m_images)
+        {
+            // Color attachment that can also be copied out for readback
+            vk::ImageCreateInfo createInfo;
+            createInfo.imageType = vk::ImageType::e2D;
+            createInfo.format = m_surfaceFormat.format;
+            createInfo.extent = vk::Extent3D{m_extents.width, m_extents.height, 1};
+            createInfo.mipLevels = 1;
+            createInfo.arrayLayers = 1;
+            createInfo.samples = vk::SampleCountFlagBits::e1;
+            createInfo.tiling = vk::ImageTiling::eOptimal;
+            createInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+            createInfo.sharingMode = vk::SharingMode::eExclusive;
+            createInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+            i.image = device.createImageUnique(createInfo);
+
+            // Back the image with device local memory
+            i.memory = Context::getAllocator().allocateForImage(*i.image,
+                {vk::MemoryPropertyFlagBits::eDeviceLocal});
+
+            // Create a view for use as a framebuffer attachment
+            vk::ImageViewCreateInfo viewInfo;
+            viewInfo.image = *i.image;
+            viewInfo.viewType = vk::ImageViewType::e2D;
+            viewInfo.format = m_surfaceFormat.format;
+            viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+            viewInfo.subresourceRange.levelCount = 1;
+
+            i.imageView = device.createImageViewUnique(viewInfo);
+        }
+    }
+}
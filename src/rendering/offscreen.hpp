@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "memory.hpp"
+
+namespace Rendering
+{
+    // Set of device local color images that stand in for swapchain images
+    // when rendering headless
+    class OffscreenTarget
+    {
+        public:
+            struct Image
+            {
+                Image() :
+                    image(nullptr), imageView(nullptr)
+                {};
+
+                // Memory is declared first so it outlives the image bound to it
+                MemoryAllocation memory;
+                vk::UniqueImage image;
+                vk::UniqueImageView imageView;
+            };
+
+            OffscreenTarget(vk::Extent2D extents, size_t imageCount);
+            ~OffscreenTarget();
+
+
+            auto getSurfaceFormat() const {
+                return m_surfaceFormat;
+            }
+            auto getExtents() const {
+                return m_extents;
+            }
+            const auto& getImages() const {
+                return m_images;
+            }
+
+        private:
+            // Initialization steps
+            void createImages(size_t imageCount);
+
+            vk::SurfaceFormatKHR m_surfaceFormat;
+            vk::Extent2D m_extents;
+            std::vector<Image> m_images;
+    };
+}
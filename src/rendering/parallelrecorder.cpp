@@ -0,0 +1,90 @@
+#include "parallelrecorder.hpp"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    ParallelRecorder::ParallelRecorder(Util::JobSystem& jobSystem, size_t frameCount, size_t maxSlices) :
+        m_jobSystem(jobSystem),
+        m_maxSlices(maxSlices == 0 ? jobSystem.getThreadCount() : maxSlices)
+    {
+        spdlog::info("Creating parallel recorder with up to {} slices", m_maxSlices);
+
+        // Pools are reset as a whole each frame, so the buffers don't need to reset individually
+        vk::CommandPoolCreateInfo poolInfo;
+        poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+        poolInfo.queueFamilyIndex = Context::get().getDevice().getProperties().getGraphicsQueue();
+
+        m_threadPools.resize(frameCount);
+        for (auto& i : m_threadPools)
+        {
+            i.resize(m_jobSystem.getThreadCount());
+            for (auto& j : i)
+            {
+                j.commandPool = Context::getVulkanDevice().createCommandPoolUnique(poolInfo);
+            }
+        }
+    }
+
+
+    void ParallelRecorder::beginFrame(size_t frameIndex)
+    {
+        PROFILE_FUNCTION();
+
+        m_currentFrame = frameIndex;
+        for (auto& i : m_threadPools[frameIndex])
+        {
+            Context::getVulkanDevice().resetCommandPool(*i.commandPool, {});
+            i.usedCount = 0;
+        }
+    }
+
+    void ParallelRecorder::record(const vk::CommandBuffer& primaryCommandBuffer,
+        const vk::CommandBufferInheritanceInfo& inheritanceInfo, size_t drawCount, const RecordFunction& recordFunction)
+    {
+        PROFILE_FUNCTION();
+
+        // Only split up as much as the draw count makes worthwhile
+        auto sliceCount = std::clamp<size_t>((drawCount + MinDrawsPerSlice - 1) / MinDrawsPerSlice, 1, m_maxSlices);
+        m_sliceCommandBuffers.assign(sliceCount, vk::CommandBuffer());
+
+        vk::CommandBufferBeginInfo beginInfo;
+        beginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        m_jobSystem.parallelFor(sliceCount, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                PROFILE_SCOPE("record slice");
+
+                auto& commandBuffer = allocateCommandBuffer();
+                commandBuffer.begin(beginInfo);
+                recordFunction(commandBuffer, drawCount * i / sliceCount, drawCount * (i + 1) / sliceCount);
+                commandBuffer.end();
+
+                m_sliceCommandBuffers[i] = commandBuffer;
+            }
+        });
+
+        // Executing in slice order keeps the draws in their original order
+        primaryCommandBuffer.executeCommands(m_sliceCommandBuffers);
+    }
+
+
+    const vk::CommandBuffer& ParallelRecorder::allocateCommandBuffer()
+    {
+        // Only this thread touches its own pool, so no locking is needed
+        auto& threadPool = m_threadPools[m_currentFrame][Util::JobSystem::getThreadIndex()];
+        if (threadPool.usedCount == threadPool.commandBuffers.size())
+        {
+            threadPool.commandBuffers.emplace_back(CommandBuffer::Type::Secondary, *threadPool.commandPool);
+        }
+
+        return threadPool.commandBuffers[threadPool.usedCount++].getCommandBuffer();
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "commandbuffer.hpp"
+#include "util/jobsystem.hpp"
+
+namespace Rendering
+{
+    // Records slices of a draw list into secondary command buffers across the job system's threads,
+    // then executes them in order from a primary command buffer
+    // Every thread gets its own command pool per frame in flight, so recording never needs a lock and
+    // pools can be reset wholesale once the frame has finished on the GPU
+    class ParallelRecorder
+    {
+        public:
+            // Records draws [begin, end) into a secondary command buffer that's already begun
+            // Dynamic state isn't inherited, so the function has to set up everything it uses
+            using RecordFunction = std::function<void(const vk::CommandBuffer& commandBuffer, size_t begin, size_t end)>;
+
+            // Slices smaller than this aren't worth handing to another thread
+            static constexpr size_t MinDrawsPerSlice = 256;
+
+            // Draws are split into at most maxSlices slices, or one per job system thread if 0
+            ParallelRecorder(Util::JobSystem& jobSystem, size_t frameCount, size_t maxSlices = 0);
+
+            // Resets the command pools for a frame, so it must have been waited on
+            void beginFrame(size_t frameIndex);
+
+            // Splits the draws into slices, records them as jobs and executes the results on the primary
+            // command buffer, which must be inside a render pass begun with
+            // vk::SubpassContents::eSecondaryCommandBuffers
+            void record(const vk::CommandBuffer& primaryCommandBuffer, const vk::CommandBufferInheritanceInfo& inheritanceInfo,
+                size_t drawCount, const RecordFunction& recordFunction);
+
+        private:
+            // Command pool owned by one thread for one frame
+            struct ThreadPool
+            {
+                ThreadPool() :
+                    commandPool(nullptr)
+                {};
+
+                vk::UniqueCommandPool commandPool;
+                std::vector<CommandBuffer> commandBuffers;
+                size_t usedCount = 0;
+            };
+
+            // Grabs a secondary command buffer from the calling thread's pool
+            const vk::CommandBuffer& allocateCommandBuffer();
+
+            Util::JobSystem& m_jobSystem;
+            size_t m_maxSlices;
+            size_t m_currentFrame = 0;
+
+            // Indexed by frame, then by job system thread
+            std::vector<std::vector<ThreadPool>> m_threadPools;
+
+            // Secondary command buffer recorded for each slice
+            std::vector<vk::CommandBuffer> m_sliceCommandBuffers;
+    };
+}
@@ -3,40 +3,99 @@
 #include <spdlog/spdlog.h>
 
 #include "context.hpp"
+#include "util/hash.hpp"
 
 namespace Rendering
 {
-    Pass::Pass()
+    size_t PassDesc::hash() const
     {
-        // Right now this is a very simple render pass, just base color
-        vk::AttachmentDescription colorAttachment;
-        colorAttachment.format = Context::get().getDevice().getSurfaceFormat().format;
-        colorAttachment.samples = vk::SampleCountFlagBits::e1;
-        colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
-        colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
-        colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-        colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-        colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-        colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+        size_t seed = 0;
+
+        auto hashAttachment = [&](const AttachmentDesc& attachment) {
+            Util::hashCombine(seed, attachment.format);
+            Util::hashCombine(seed, attachment.loadOp);
+            Util::hashCombine(seed, attachment.storeOp);
+            Util::hashCombine(seed, attachment.initialLayout);
+            Util::hashCombine(seed, attachment.finalLayout);
+        };
+
+        for (auto& i : colorAttachments)
+        {
+            hashAttachment(i);
+        }
+        Util::hashCombine(seed, depthAttachment.has_value());
+        if (depthAttachment.has_value())
+        {
+            hashAttachment(depthAttachment.value());
+        }
+
+        return seed;
+    }
+
+
+    Pass::Pass() :
+        Pass(getDefaultDesc())
+    {}
+
+    Pass::Pass(const PassDesc& desc) :
+        m_desc(desc)
+    {
+        // Color attachments come first, so they line up with the fragment outputs
+        std::vector<vk::AttachmentDescription> attachments;
+        std::vector<vk::AttachmentReference> colorAttachmentReferences;
+        for (auto& i : desc.colorAttachments)
+        {
+            vk::AttachmentDescription attachment;
+            attachment.format = i.format;
+            attachment.samples = vk::SampleCountFlagBits::e1;
+            attachment.loadOp = i.loadOp;
+            attachment.storeOp = i.storeOp;
+            attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+            attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+            attachment.initialLayout = i.initialLayout;
+            attachment.finalLayout = i.finalLayout;
 
-        // Fragment color is layout = 0!
-        vk::AttachmentReference colorAttachmentReference;
-        colorAttachmentReference.layout = vk::ImageLayout::eColorAttachmentOptimal;
-        colorAttachmentReference.attachment = 0;
+            colorAttachmentReferences.emplace_back(static_cast<uint32_t>(attachments.size()),
+                vk::ImageLayout::eColorAttachmentOptimal);
+            attachments.push_back(attachment);
+        }
+
+        // Stencil is treated the same as depth
+        vk::AttachmentReference depthAttachmentReference;
+        if (desc.depthAttachment.has_value())
+        {
+            auto& depth = desc.depthAttachment.value();
+
+            vk::AttachmentDescription attachment;
+            attachment.format = depth.format;
+            attachment.samples = vk::SampleCountFlagBits::e1;
+            attachment.loadOp = depth.loadOp;
+            attachment.storeOp = depth.storeOp;
+            attachment.stencilLoadOp = depth.loadOp;
+            attachment.stencilStoreOp = depth.storeOp;
+            attachment.initialLayout = depth.initialLayout;
+            attachment.finalLayout = depth.finalLayout;
+
+            depthAttachmentReference.attachment = static_cast<uint32_t>(attachments.size());
+            depthAttachmentReference.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+            attachments.push_back(attachment);
+        }
 
         // Single subpass
-        vk::SubpassDescription colorPass;
-        colorPass.colorAttachmentCount = 1;
-        colorPass.pColorAttachments = &colorAttachmentReference;
+        vk::SubpassDescription subpass;
+        subpass.colorAttachmentCount = static_cast<uint32_t>(colorAttachmentReferences.size());
+        subpass.pColorAttachments = colorAttachmentReferences.data();
+        subpass.pDepthStencilAttachment = desc.depthAttachment.has_value() ? &depthAttachmentReference : nullptr;
 
         // Creation info
         vk::RenderPassCreateInfo createInfo;
-        createInfo.attachmentCount = 1;
-        createInfo.pAttachments = &colorAttachment;
+        createInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        createInfo.pAttachments = attachments.data();
         createInfo.subpassCount = 1;
-        createInfo.pSubpasses = &colorPass;
+        createInfo.pSubpasses = &subpass;
 
-        spdlog::info("Creating rendering pass");
+        spdlog::info("Creating render pass with {} color attachments{}", desc.colorAttachments.size(),
+            desc.depthAttachment.has_value() ? " and depth" : "");
         m_renderPass = Context::getVulkanDevice().createRenderPassUnique(createInfo);
     }
 
@@ -44,4 +103,21 @@ namespace Rendering
     {
         spdlog::info("Destroying render pass");
     }
+
+
+    PassDesc Pass::getDefaultDesc()
+    {
+        AttachmentDesc colorAttachment;
+        colorAttachment.format = Context::get().getDevice().getSurfaceFormat().format;
+        colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+        colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+        colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
+        // Offscreen images are left ready to be copied out instead of presented
+        colorAttachment.finalLayout = Context::get().isHeadless() ?
+            vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
+
+        PassDesc desc;
+        desc.colorAttachments.push_back(colorAttachment);
+        return desc;
+    }
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <optional>
 #include <vector>
 
 #include <vulkan/vulkan.hpp>
@@ -8,23 +9,67 @@ namespace Rendering
 {
     class Swapchain;
 
-    // Does nothing right now!
-    class Subpass
+    // How a render pass treats one of its attachments
+    struct AttachmentDesc
     {
+        vk::Format format = vk::Format::eUndefined;
+        vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::eClear;
+        vk::AttachmentStoreOp storeOp = vk::AttachmentStoreOp::eStore;
 
+        // Layouts the attachment is in when the pass begins and is left in when it ends
+        // The subpass itself always uses the optimal attachment layout
+        vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+        vk::ImageLayout finalLayout = vk::ImageLayout::eColorAttachmentOptimal;
+
+        bool operator==(const AttachmentDesc& other) const {
+            return format == other.format && loadOp == other.loadOp && storeOp == other.storeOp &&
+                initialLayout == other.initialLayout && finalLayout == other.finalLayout;
+        }
+    };
+
+    // Everything needed to build a single subpass render pass
+    struct PassDesc
+    {
+        // Indexed by fragment output location
+        std::vector<AttachmentDesc> colorAttachments;
+        std::optional<AttachmentDesc> depthAttachment;
+
+        size_t hash() const;
+        bool operator==(const PassDesc& other) const {
+            return colorAttachments == other.colorAttachments && depthAttachment == other.depthAttachment;
+        }
     };
 
+    struct PassDescHash
+    {
+        size_t operator()(const PassDesc& desc) const {
+            return desc.hash();
+        }
+    };
+
+    // Render pass with a single subpass
+    // Pipelines built against one pass work with any pass whose attachments have the same formats,
+    // whatever their load and store ops or layouts
     class Pass
     {
         public:
+            // One color attachment in the surface format, cleared and then left ready to present,
+            // or to copy out when rendering headless
             Pass();
+            Pass(const PassDesc& desc);
             ~Pass();
 
             const vk::RenderPass& getRenderPass() const {
                 return *m_renderPass;
             }
+            const PassDesc& getDesc() const {
+                return m_desc;
+            }
 
         private:
+            static PassDesc getDefaultDesc();
+
+            PassDesc m_desc;
             vk::UniqueRenderPass m_renderPass;
     };
 }
@@ -1,96 +1,204 @@
 #include "pipeline.hpp"
 
+#include <algorithm>
+#include <stdexcept>
 #include <vector>
 
 #include <spdlog/spdlog.h>
 
 #include "context.hpp"
+#include "util/hash.hpp"
+#include "util/profiler.hpp"
 
 namespace Rendering
 {
-    // TODO: Add a lot configuration here!
-    // Multiple pipelines for different things would be useful
-    // This is all just default state from the tutorial
-    Pipeline::Pipeline(Shader& vertexShader, Shader& fragmentShader, Pass& pass)
+    size_t PipelineDesc::hash() const
+    {
+        size_t seed = 0;
+
+        Util::hashCombine(seed, vertexShader);
+        Util::hashCombine(seed, fragmentShader);
+
+        for (auto& i : vertexBindings)
+        {
+            Util::hashCombine(seed, i.binding);
+            Util::hashCombine(seed, i.stride);
+            Util::hashCombine(seed, i.inputRate);
+        }
+        for (auto& i : vertexAttributes)
+        {
+            Util::hashCombine(seed, i.location);
+            Util::hashCombine(seed, i.binding);
+            Util::hashCombine(seed, i.format);
+            Util::hashCombine(seed, i.offset);
+        }
+        Util::hashCombine(seed, topology);
+
+        Util::hashCombine(seed, polygonMode);
+        Util::hashCombine(seed, static_cast<VkCullModeFlags>(cullMode));
+        Util::hashCombine(seed, frontFace);
+
+        Util::hashCombine(seed, depthTestEnable);
+        Util::hashCombine(seed, depthWriteEnable);
+        Util::hashCombine(seed, depthCompareOp);
+
+        Util::hashCombine(seed, blendEnable);
+        Util::hashCombine(seed, sourceColorBlendFactor);
+        Util::hashCombine(seed, destinationColorBlendFactor);
+        Util::hashCombine(seed, colorBlendOp);
+        Util::hashCombine(seed, sourceAlphaBlendFactor);
+        Util::hashCombine(seed, destinationAlphaBlendFactor);
+        Util::hashCombine(seed, alphaBlendOp);
+        Util::hashCombine(seed, static_cast<VkColorComponentFlags>(colorWriteMask));
+
+        Util::hashCombine(seed, dynamicUniformBuffers);
+
+        Util::hashCombine(seed, pass);
+        Util::hashCombine(seed, subpass);
+
+        return seed;
+    }
+
+    bool PipelineDesc::operator==(const PipelineDesc& other) const
+    {
+        return vertexShader == other.vertexShader &&
+            fragmentShader == other.fragmentShader &&
+            vertexBindings == other.vertexBindings &&
+            vertexAttributes == other.vertexAttributes &&
+            topology == other.topology &&
+            polygonMode == other.polygonMode &&
+            cullMode == other.cullMode &&
+            frontFace == other.frontFace &&
+            depthTestEnable == other.depthTestEnable &&
+            depthWriteEnable == other.depthWriteEnable &&
+            depthCompareOp == other.depthCompareOp &&
+            blendEnable == other.blendEnable &&
+            sourceColorBlendFactor == other.sourceColorBlendFactor &&
+            destinationColorBlendFactor == other.destinationColorBlendFactor &&
+            colorBlendOp == other.colorBlendOp &&
+            sourceAlphaBlendFactor == other.sourceAlphaBlendFactor &&
+            destinationAlphaBlendFactor == other.destinationAlphaBlendFactor &&
+            alphaBlendOp == other.alphaBlendOp &&
+            colorWriteMask == other.colorWriteMask &&
+            dynamicUniformBuffers == other.dynamicUniformBuffers &&
+            pass == other.pass &&
+            subpass == other.subpass;
+    }
+
+
+
+    // Every state block a pipeline create info points to, kept together so several pipelines can be
+    // described before creating them in one call
+    struct Pipeline::CreateState
+    {
+        CreateState(const PipelineDesc& desc, vk::PipelineLayout layout);
+
+        // Not copyable, as the create info points into the object
+        CreateState(const CreateState&) = delete;
+        CreateState& operator=(const CreateState&) = delete;
+
+        std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
+        vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
+        vk::PipelineInputAssemblyStateCreateInfo assemblyInfo;
+        vk::PipelineViewportStateCreateInfo viewportState;
+        vk::PipelineRasterizationStateCreateInfo rasterState;
+        vk::PipelineMultisampleStateCreateInfo multisampleState;
+        vk::PipelineDepthStencilStateCreateInfo depthState;
+        vk::PipelineColorBlendAttachmentState blendAttachment;
+        vk::PipelineColorBlendStateCreateInfo blendState;
+        std::vector<vk::DynamicState> enabledDynamicStates;
+        vk::PipelineDynamicStateCreateInfo dynamicState;
+        vk::GraphicsPipelineCreateInfo createInfo;
+    };
+
+    Pipeline::CreateState::CreateState(const PipelineDesc& desc, vk::PipelineLayout layout)
     {
         // Pipeline info for vertex and fragment shaders
-        std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = {
+        shaderStages = {
             vk::PipelineShaderStageCreateInfo{
                 {},
                 vk::ShaderStageFlagBits::eVertex,
-                vertexShader.getShaderModule(),
+                desc.vertexShader->getShaderModule(),
                 "main"
             },
             vk::PipelineShaderStageCreateInfo{
                 {},
                 vk::ShaderStageFlagBits::eFragment,
-                fragmentShader.getShaderModule(),
+                desc.fragmentShader->getShaderModule(),
                 "main"
             }
         };
 
-        // Vertex input info
-        // Right now nothing is here :(
-        vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
-        vertexInputInfo.vertexBindingDescriptionCount = 0;
-        vertexInputInfo.vertexAttributeDescriptionCount = 0;
+        // Vertex input info, which has to feed every input the vertex shader reads
+        for (auto& i : desc.vertexShader->getReflection().vertexInputs)
+        {
+            auto attribute = std::find_if(desc.vertexAttributes.begin(), desc.vertexAttributes.end(),
+                [&](const auto& other) {
+                    return other.location == i.location;
+                });
+            if (attribute == desc.vertexAttributes.end())
+            {
+                spdlog::warn("Vertex shader input {} has no matching vertex attribute", i.location);
+            }
+        }
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(desc.vertexBindings.size());
+        vertexInputInfo.pVertexBindingDescriptions = desc.vertexBindings.data();
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.vertexAttributes.size());
+        vertexInputInfo.pVertexAttributeDescriptions = desc.vertexAttributes.data();
 
         // Geometry assembly info
-        vk::PipelineInputAssemblyStateCreateInfo assemblyInfo;
-        assemblyInfo.topology = vk::PrimitiveTopology::eTriangleList;
+        assemblyInfo.topology = desc.topology;
         assemblyInfo.primitiveRestartEnable = false;
 
         // Viewport and scissor settings
-        vk::PipelineViewportStateCreateInfo viewportState;
         viewportState.viewportCount = 1;
         viewportState.pViewports = nullptr;
         viewportState.scissorCount = 1;
         viewportState.pScissors = nullptr;
 
         // Rasterizer settings!
-        vk::PipelineRasterizationStateCreateInfo rasterState;
         rasterState.depthClampEnable = false;
         rasterState.rasterizerDiscardEnable = false;
-        rasterState.polygonMode = vk::PolygonMode::eFill;
-        rasterState.cullMode = vk::CullModeFlagBits::eBack;
-        rasterState.frontFace = vk::FrontFace::eClockwise;
+        rasterState.polygonMode = desc.polygonMode;
+        rasterState.cullMode = desc.cullMode;
+        rasterState.frontFace = desc.frontFace;
         rasterState.depthBiasEnable = false;
         rasterState.lineWidth = 1.0f;
 
         // Multisampling settings :o
-        vk::PipelineMultisampleStateCreateInfo multisampleState;
         multisampleState.sampleShadingEnable = false;
         multisampleState.rasterizationSamples = vk::SampleCountFlagBits::e1;
 
+        // Depth settings
+        depthState.depthTestEnable = desc.depthTestEnable;
+        depthState.depthWriteEnable = desc.depthWriteEnable;
+        depthState.depthCompareOp = desc.depthCompareOp;
+        depthState.depthBoundsTestEnable = false;
+        depthState.stencilTestEnable = false;
+
         // Blend settings
-        vk::PipelineColorBlendAttachmentState blendAttachment;
-        blendAttachment.colorWriteMask =
-            vk::ColorComponentFlagBits::eR |
-            vk::ColorComponentFlagBits::eG |
-            vk::ColorComponentFlagBits::eB;
-        blendAttachment.blendEnable = false;
+        blendAttachment.colorWriteMask = desc.colorWriteMask;
+        blendAttachment.blendEnable = desc.blendEnable;
+        blendAttachment.srcColorBlendFactor = desc.sourceColorBlendFactor;
+        blendAttachment.dstColorBlendFactor = desc.destinationColorBlendFactor;
+        blendAttachment.colorBlendOp = desc.colorBlendOp;
+        blendAttachment.srcAlphaBlendFactor = desc.sourceAlphaBlendFactor;
+        blendAttachment.dstAlphaBlendFactor = desc.destinationAlphaBlendFactor;
+        blendAttachment.alphaBlendOp = desc.alphaBlendOp;
 
-        vk::PipelineColorBlendStateCreateInfo blendState;
         blendState.logicOpEnable = false;
         blendState.attachmentCount = 1;
         blendState.pAttachments = &blendAttachment;
 
         // Dynamic settings
-        std::vector<vk::DynamicState> enabledDynamicStates = {
+        enabledDynamicStates = {
             vk::DynamicState::eViewport,
             vk::DynamicState::eScissor
         };
-        vk::PipelineDynamicStateCreateInfo dynamicState;
         dynamicState.dynamicStateCount = static_cast<uint32_t>(enabledDynamicStates.size());
         dynamicState.pDynamicStates = enabledDynamicStates.data();
 
-        // Create the pipeline layout
-        vk::PipelineLayoutCreateInfo layoutInfo;
-        spdlog::info("Creating pipeline layout");
-        m_pipelineLayout = Context::getVulkanDevice().createPipelineLayoutUnique(layoutInfo);
-
-        // Finally create the pipeline!
-        vk::GraphicsPipelineCreateInfo createInfo;
+        // Finally fill out the pipeline info!
         createInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
         createInfo.pStages = shaderStages.data();
         createInfo.pVertexInputState = &vertexInputInfo;
@@ -98,14 +206,61 @@ namespace Rendering
         createInfo.pRasterizationState = &rasterState;
         createInfo.pViewportState = &viewportState;
         createInfo.pMultisampleState = &multisampleState;
+        createInfo.pDepthStencilState = &depthState;
         createInfo.pColorBlendState = &blendState;
-        createInfo.layout = *m_pipelineLayout;
+        createInfo.layout = layout;
         createInfo.pDynamicState = &dynamicState;
-        createInfo.renderPass = pass.getRenderPass();
-        createInfo.subpass = 0;
+        createInfo.renderPass = desc.pass->getRenderPass();
+        createInfo.subpass = desc.subpass;
+    }
+
+
+
+    Pipeline::Pipeline(const PipelineDesc& desc) :
+        m_layout(Context::getLayoutCache().getShaderLayout({desc.vertexShader, desc.fragmentShader},
+            desc.dynamicUniformBuffers)), m_pipeline(nullptr)
+    {
+        PROFILE_FUNCTION();
+
+        CreateState state(desc, m_layout.pipelineLayout);
 
         spdlog::info("Creating graphics pipeline");
-        m_pipeline = Context::getVulkanDevice().createGraphicsPipelineUnique(nullptr, createInfo);
+        m_pipeline = Context::getVulkanDevice().createGraphicsPipelineUnique(
+            Context::getPipelineCache().getThreadCache(), state.createInfo);
+    }
+
+    Pipeline::Pipeline(ShaderLayout layout, vk::UniquePipeline pipeline) :
+        m_layout(std::move(layout)), m_pipeline(std::move(pipeline))
+    {}
+
+    std::vector<std::unique_ptr<Pipeline>> Pipeline::createPipelines(const std::vector<const PipelineDesc*>& descs)
+    {
+        PROFILE_FUNCTION();
+
+        std::vector<ShaderLayout> layouts;
+        std::vector<std::unique_ptr<CreateState>> states;
+        std::vector<vk::GraphicsPipelineCreateInfo> createInfos;
+
+        for (auto i : descs)
+        {
+            layouts.push_back(Context::getLayoutCache().getShaderLayout({i->vertexShader, i->fragmentShader},
+                i->dynamicUniformBuffers));
+            states.push_back(std::make_unique<CreateState>(*i, layouts.back().pipelineLayout));
+            createInfos.push_back(states.back()->createInfo);
+        }
+
+        // One call lets the driver spread the work out and share its setup between pipelines
+        spdlog::info("Creating {} graphics pipelines", descs.size());
+        auto vulkanPipelines = Context::getVulkanDevice().createGraphicsPipelinesUnique(
+            Context::getPipelineCache().getThreadCache(), createInfos);
+
+        std::vector<std::unique_ptr<Pipeline>> pipelines;
+        for (size_t i = 0; i < vulkanPipelines.size(); i++)
+        {
+            pipelines.emplace_back(new Pipeline(std::move(layouts[i]), std::move(vulkanPipelines[i])));
+        }
+
+        return pipelines;
     }
 
     Pipeline::~Pipeline()
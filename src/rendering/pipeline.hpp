@@ -1,24 +1,101 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include <vulkan/vulkan.hpp>
 
 #include "shader.hpp"
 #include "pass.hpp"
+#include "layoutcache.hpp"
+#include "vertex.hpp"
 
 namespace Rendering
 {
+    // Everything needed to build a graphics pipeline
+    // Shaders and passes are referenced by pointer, so they have to outlive any pipeline built from them
+    struct PipelineDesc
+    {
+        // Shaders
+        const Shader* vertexShader = nullptr;
+        const Shader* fragmentShader = nullptr;
+
+        // Vertex layout, defaulting to the basic vertex
+        std::vector<vk::VertexInputBindingDescription> vertexBindings = {Vertex::getBindingDescription()};
+        std::vector<vk::VertexInputAttributeDescription> vertexAttributes = Vertex::getAttributeDescriptions();
+        vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+
+        // Rasterizer state
+        vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+        vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+        vk::FrontFace frontFace = vk::FrontFace::eClockwise;
+
+        // Depth state, which only applies to passes with a depth attachment
+        bool depthTestEnable = false;
+        bool depthWriteEnable = false;
+        vk::CompareOp depthCompareOp = vk::CompareOp::eLess;
+
+        // Blend state for the color attachment, defaulting to regular alpha blending when enabled
+        bool blendEnable = false;
+        vk::BlendFactor sourceColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+        vk::BlendFactor destinationColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+        vk::BlendOp colorBlendOp = vk::BlendOp::eAdd;
+        vk::BlendFactor sourceAlphaBlendFactor = vk::BlendFactor::eOne;
+        vk::BlendFactor destinationAlphaBlendFactor = vk::BlendFactor::eZero;
+        vk::BlendOp alphaBlendOp = vk::BlendOp::eAdd;
+        vk::ColorComponentFlags colorWriteMask =
+            vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB;
+
+        // Uniform buffers the shaders use are bound with dynamic offsets, so per-draw data can come
+        // from a UniformAllocator without writing new descriptor sets
+        bool dynamicUniformBuffers = true;
+
+        // The pipeline can be used with any render pass compatible with this one
+        const Pass* pass = nullptr;
+        uint32_t subpass = 0;
+
+        size_t hash() const;
+        bool operator==(const PipelineDesc& other) const;
+        bool operator!=(const PipelineDesc& other) const {
+            return !(*this == other);
+        }
+    };
+
+    struct PipelineDescHash
+    {
+        size_t operator()(const PipelineDesc& desc) const {
+            return desc.hash();
+        }
+    };
+
+    // Graphics pipeline, with a layout built from what its shaders use
+    // Layouts come from the context's layout cache, so compatible pipelines share the same layout objects
     class Pipeline
     {
         public:
-            Pipeline(Shader& vertexShader, Shader& fragmentShader, Pass& pass);
+            Pipeline(const PipelineDesc& desc);
             ~Pipeline();
 
+            // Creates several pipelines with a single call, which is cheaper than creating them one at a time
+            static std::vector<std::unique_ptr<Pipeline>> createPipelines(const std::vector<const PipelineDesc*>& descs);
+
             const vk::Pipeline& getPipeline() const {
                 return *m_pipeline;
             }
+            const vk::PipelineLayout& getPipelineLayout() const {
+                return m_layout.pipelineLayout;
+            }
+            // Set layouts indexed by set number, with empty layouts filling any gaps
+            const std::vector<vk::DescriptorSetLayout>& getDescriptorSetLayouts() const {
+                return m_layout.setLayouts;
+            }
 
         private:
-            vk::UniquePipelineLayout m_pipelineLayout;
+            struct CreateState;
+
+            Pipeline(ShaderLayout layout, vk::UniquePipeline pipeline);
+
+            ShaderLayout m_layout;
             vk::UniquePipeline m_pipeline;
     };
 }
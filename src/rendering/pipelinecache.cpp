@@ -0,0 +1,178 @@
+#include "pipelinecache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+#include "device.hpp"
+#include "util/jobsystem.hpp"
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    // Size of VkPipelineCacheHeaderVersionOne
+    static const size_t cacheHeaderSize = 16 + VK_UUID_SIZE;
+
+    static uint32_t readUint32(const std::vector<char>& data, size_t offset)
+    {
+        uint32_t value;
+        std::memcpy(&value, data.data() + offset, sizeof(value));
+        return value;
+    }
+
+
+
+    PipelineCache::PipelineCache(Device& device, const std::string_view& filePath) :
+        m_device(device), m_filePath(filePath), m_mainCache(nullptr)
+    {
+        PROFILE_FUNCTION();
+
+        auto data = loadFile();
+        if (!data.empty() && getIsCompatible(data))
+        {
+            spdlog::info("Loaded {} bytes of pipeline cache from \"{}\"", data.size(), m_filePath);
+            m_initialData = std::move(data);
+        }
+
+        vk::PipelineCacheCreateInfo createInfo;
+        createInfo.initialDataSize = m_initialData.size();
+        createInfo.pInitialData = m_initialData.data();
+
+        spdlog::info("Creating pipeline cache");
+        m_mainCache = m_device.getVulkanDevice().createPipelineCacheUnique(createInfo);
+    }
+
+    PipelineCache::~PipelineCache()
+    {
+        // Don't let a failed write take down the rest of shutdown
+        try
+        {
+            save();
+        }
+        catch (const std::exception& exception)
+        {
+            spdlog::error("Failed to save pipeline cache: {}", exception.what());
+        }
+
+        spdlog::info("Destroying pipeline cache");
+    }
+
+
+    vk::PipelineCache PipelineCache::getThreadCache()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto threadIndex = Util::JobSystem::getThreadIndex();
+        auto threadCache = m_threadCaches.find(threadIndex);
+        if (threadCache == m_threadCaches.end())
+        {
+            vk::PipelineCacheCreateInfo createInfo;
+            createInfo.initialDataSize = m_initialData.size();
+            createInfo.pInitialData = m_initialData.data();
+
+            threadCache = m_threadCaches.emplace(threadIndex,
+                m_device.getVulkanDevice().createPipelineCacheUnique(createInfo)).first;
+        }
+
+        return *threadCache->second;
+    }
+
+    void PipelineCache::save()
+    {
+        PROFILE_FUNCTION();
+
+        if (m_filePath.empty())
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Pull everything the threads compiled into the main cache
+        std::vector<vk::PipelineCache> threadCaches;
+        for (auto& i : m_threadCaches)
+        {
+            threadCaches.push_back(*i.second);
+        }
+        if (!threadCaches.empty())
+        {
+            m_device.getVulkanDevice().mergePipelineCaches(*m_mainCache, threadCaches);
+        }
+
+        auto data = m_device.getVulkanDevice().getPipelineCacheData(*m_mainCache);
+
+        // Write to a temporary file first and rename it over the old one, so a crash mid-write
+        // never leaves a truncated cache behind
+        auto temporaryPath = m_filePath + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            file.close();
+
+            if (!file)
+            {
+                spdlog::error("Cannot write pipeline cache file \"{}\"", temporaryPath);
+                throw std::runtime_error("Cannot write pipeline cache file");
+            }
+        }
+        std::filesystem::rename(temporaryPath, m_filePath);
+
+        spdlog::info("Saved {} bytes of pipeline cache to \"{}\"", data.size(), m_filePath);
+    }
+
+
+    bool PipelineCache::getIsCompatible(const std::vector<char>& data) const
+    {
+        if (data.size() < cacheHeaderSize)
+        {
+            spdlog::warn("Ignoring pipeline cache with truncated header");
+            return false;
+        }
+
+        auto headerSize = readUint32(data, 0);
+        auto headerVersion = readUint32(data, 4);
+        auto vendorId = readUint32(data, 8);
+        auto deviceId = readUint32(data, 12);
+
+        auto properties = m_device.getProperties().getDeviceProperties();
+
+        if (headerSize < cacheHeaderSize || headerSize > data.size() ||
+            headerVersion != static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne))
+        {
+            spdlog::warn("Ignoring pipeline cache with unknown header version {}", headerVersion);
+            return false;
+        }
+
+        // Caches from another device or driver version are useless at best
+        if (vendorId != properties.vendorID || deviceId != properties.deviceID ||
+            std::memcmp(data.data() + 16, &properties.pipelineCacheUUID[0], VK_UUID_SIZE) != 0)
+        {
+            spdlog::info("Ignoring pipeline cache from a different device or driver");
+            return false;
+        }
+
+        return true;
+    }
+
+    std::vector<char> PipelineCache::loadFile() const
+    {
+        std::vector<char> data;
+
+        if (m_filePath.empty())
+        {
+            return data;
+        }
+
+        std::ifstream file(m_filePath, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+        {
+            spdlog::info("No pipeline cache found at \"{}\"", m_filePath);
+            return data;
+        }
+
+        data.insert(data.end(), std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return data;
+    }
+}
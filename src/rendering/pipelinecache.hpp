@@ -0,0 +1,50 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Rendering
+{
+    class Device;
+
+    // Device wide pipeline cache that persists between runs
+    // Each job system thread creates pipelines through its own cache so they never contend on the
+    // driver's cache lock - the thread caches are merged into the main one when saving
+    // Caches are kept per job system thread index rather than per thread, so there's a fixed number of
+    // them and threads that come and go don't leave caches behind - threads outside the job system
+    // share the cache at index 0, which is fine as pipeline caches are internally synchronized
+    class PipelineCache
+    {
+        public:
+            // Loads the cache file if it exists and was written by the same device and driver
+            // An empty file path disables saving
+            PipelineCache(Device& device, const std::string_view& filePath);
+            ~PipelineCache();
+
+            // Cache for the calling thread's job system index, created the first time it's asked for
+            vk::PipelineCache getThreadCache();
+
+            // Merges the thread caches and atomically replaces the cache file
+            void save();
+
+        private:
+            // Checks the cache header was written by this device and driver
+            bool getIsCompatible(const std::vector<char>& data) const;
+            std::vector<char> loadFile() const;
+
+            Device& m_device;
+            std::string m_filePath;
+
+            // Data that seeds every new thread cache
+            std::vector<char> m_initialData;
+
+            std::mutex m_mutex;
+            vk::UniquePipelineCache m_mainCache;
+            std::map<size_t, vk::UniquePipelineCache> m_threadCaches;
+    };
+}
@@ -0,0 +1,338 @@
+#include "pipelinelibrary.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    PipelineLibrary::PipelineLibrary(Util::JobSystem& jobSystem) :
+        m_jobSystem(jobSystem)
+    {}
+
+    PipelineLibrary::~PipelineLibrary()
+    {
+        // Compile jobs reference the library, so they have to finish first
+        m_jobSystem.wait(m_compileCounter);
+
+        spdlog::info("Destroying pipeline library with {} pipelines", getPipelineCount());
+    }
+
+
+    const Pipeline& PipelineLibrary::get(const PipelineDesc& desc)
+    {
+        PipelineFuture future;
+        auto request = claim(desc, future);
+
+        if (request.has_value())
+        {
+            // Nobody else has it, so build it right here
+            std::vector<Request> batch = {std::move(request.value())};
+            compileBatch(batch);
+        }
+        else if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            // Queued or being compiled elsewhere - run compile jobs until it's done rather than
+            // blocking, as there may be no workers to pick it up
+            PROFILE_SCOPE("wait for pipeline");
+            waitForCompiles();
+        }
+
+        return *future.get();
+    }
+
+    const Pipeline* PipelineLibrary::tryGet(const PipelineDesc& desc)
+    {
+        auto& shard = getShard(desc);
+
+        // Fast path - the pipeline already exists or is being built
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            auto pipeline = shard.pipelines.find(desc);
+            if (pipeline != shard.pipelines.end())
+            {
+                auto future = pipeline->second;
+                lock.unlock();
+
+                // A failed build stays in the library, so it isn't compiled again every frame
+                if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                {
+                    return nullptr;
+                }
+                try
+                {
+                    return future.get().get();
+                }
+                catch (...)
+                {
+                    return nullptr;
+                }
+            }
+        }
+
+        // Queue it up for the next flush
+        PipelineFuture future;
+        auto request = claim(desc, future);
+        if (request.has_value())
+        {
+            std::lock_guard<std::mutex> lock(m_requestMutex);
+            m_requests.push_back(std::move(request.value()));
+        }
+
+        return nullptr;
+    }
+
+    void PipelineLibrary::request(const std::vector<PipelineDesc>& descs)
+    {
+        std::vector<Request> requests;
+        for (auto& i : descs)
+        {
+            PipelineFuture future;
+            auto request = claim(i, future);
+            if (request.has_value())
+            {
+                requests.push_back(std::move(request.value()));
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_requests.insert(m_requests.end(), std::make_move_iterator(requests.begin()),
+            std::make_move_iterator(requests.end()));
+    }
+
+    void PipelineLibrary::flush()
+    {
+        std::vector<Request> requests;
+        {
+            std::lock_guard<std::mutex> lock(m_requestMutex);
+            std::swap(requests, m_requests);
+        }
+
+        if (requests.empty())
+        {
+            return;
+        }
+
+        // Spread the batches out so every thread gets some, but keep them big enough that
+        // the driver can share work between pipelines
+        auto batchCount = std::max<size_t>((requests.size() + MaxBatchSize - 1) / MaxBatchSize,
+            std::min(requests.size(), m_jobSystem.getThreadCount()));
+        spdlog::debug("Compiling {} pipelines in {} batches", requests.size(), batchCount);
+
+        for (size_t i = 0; i < batchCount; i++)
+        {
+            std::vector<Request> batch(
+                std::make_move_iterator(requests.begin() + requests.size() * i / batchCount),
+                std::make_move_iterator(requests.begin() + requests.size() * (i + 1) / batchCount));
+
+            m_jobSystem.run([this, batch = std::move(batch)]() mutable {
+                compileBatch(batch);
+            }, &m_compileCounter);
+        }
+    }
+
+    void PipelineLibrary::waitForCompiles()
+    {
+        flush();
+        m_jobSystem.wait(m_compileCounter);
+    }
+
+    bool PipelineLibrary::rebuild(const Shader& shader)
+    {
+        PROFILE_FUNCTION();
+
+        // Make sure nothing is still compiling against the shader
+        waitForCompiles();
+
+        // Find the finished pipelines that use the shader
+        std::vector<PipelineDesc> descs;
+        for (auto& i : m_shards)
+        {
+            std::shared_lock<std::shared_mutex> lock(i.mutex);
+            for (auto& j : i.pipelines)
+            {
+                if (j.first.vertexShader == &shader || j.first.fragmentShader == &shader)
+                {
+                    descs.push_back(j.first);
+                }
+            }
+        }
+
+        if (descs.empty())
+        {
+            return true;
+        }
+
+        spdlog::info("Rebuilding {} pipelines", descs.size());
+
+        // Build them all in parallel batches before swapping anything, so a broken shader
+        // leaves everything as it was
+        std::vector<std::unique_ptr<Pipeline>> pipelines(descs.size());
+        try
+        {
+            m_jobSystem.parallelFor(descs.size(), MaxBatchSize, [&](size_t begin, size_t end) {
+                std::vector<const PipelineDesc*> batch;
+                for (size_t i = begin; i < end; i++)
+                {
+                    batch.push_back(&descs[i]);
+                }
+
+                auto batchPipelines = Pipeline::createPipelines(batch);
+                std::move(batchPipelines.begin(), batchPipelines.end(), pipelines.begin() + begin);
+            });
+        }
+        catch (const std::exception& exception)
+        {
+            spdlog::error("Failed to rebuild pipelines: {}", exception.what());
+            return false;
+        }
+
+        for (size_t i = 0; i < descs.size(); i++)
+        {
+            PipelinePromise promise;
+            promise.set_value(std::move(pipelines[i]));
+
+            auto& shard = getShard(descs[i]);
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            auto& entry = shard.pipelines[descs[i]];
+
+            // Frames already recorded may still be using the old pipeline
+            // Entries that failed to build have nothing to retire
+            std::shared_ptr<const Pipeline> oldPipeline;
+            try
+            {
+                oldPipeline = entry.get();
+            }
+            catch (...)
+            {
+            }
+            if (oldPipeline)
+            {
+                Context::getDeletionQueue().retire(std::move(oldPipeline));
+            }
+            entry = promise.get_future().share();
+        }
+
+        return true;
+    }
+
+    size_t PipelineLibrary::getPipelineCount() const
+    {
+        size_t count = 0;
+        for (auto& i : m_shards)
+        {
+            std::shared_lock<std::shared_mutex> lock(i.mutex);
+            count += i.pipelines.size();
+        }
+
+        return count;
+    }
+
+
+    PipelineLibrary::Shard& PipelineLibrary::getShard(const PipelineDesc& desc)
+    {
+        return m_shards[desc.hash() % ShardCount];
+    }
+
+    std::optional<PipelineLibrary::Request> PipelineLibrary::claim(const PipelineDesc& desc, PipelineFuture& future)
+    {
+        auto& shard = getShard(desc);
+
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            auto pipeline = shard.pipelines.find(desc);
+            if (pipeline != shard.pipelines.end())
+            {
+                future = pipeline->second;
+                return {};
+            }
+        }
+
+        // Check again under the exclusive lock, as another thread may have claimed it in between
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto pipeline = shard.pipelines.find(desc);
+        if (pipeline != shard.pipelines.end())
+        {
+            future = pipeline->second;
+            return {};
+        }
+
+        auto promise = std::make_shared<PipelinePromise>();
+        future = promise->get_future().share();
+        shard.pipelines.emplace(desc, future);
+
+        return Request{desc, promise};
+    }
+
+    void PipelineLibrary::compileBatch(std::vector<Request>& batch)
+    {
+        PROFILE_FUNCTION();
+
+        std::vector<const PipelineDesc*> descs;
+        for (auto& i : batch)
+        {
+            descs.push_back(&i.desc);
+        }
+
+        // Build without holding any locks, so the rest of the library stays available
+        std::vector<std::unique_ptr<Pipeline>> pipelines;
+        std::exception_ptr exception;
+        try
+        {
+            pipelines = Pipeline::createPipelines(descs);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        if (exception)
+        {
+            if (batch.size() > 1)
+            {
+                // One bad pipeline fails the whole batch, so build them one at a time to find out which
+                spdlog::warn("Failed to compile a batch of {} pipelines, retrying them one at a time", batch.size());
+                for (auto& i : batch)
+                {
+                    std::vector<Request> single = {std::move(i)};
+                    compileBatch(single);
+                }
+            }
+            else
+            {
+                fail(batch.front(), exception);
+            }
+            return;
+        }
+
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            batch[i].promise->set_value(std::move(pipelines[i]));
+        }
+    }
+
+    void PipelineLibrary::fail(Request& request, std::exception_ptr exception)
+    {
+        try
+        {
+            std::rethrow_exception(exception);
+        }
+        catch (const std::exception& error)
+        {
+            spdlog::error("Failed to compile pipeline: {}", error.what());
+        }
+        catch (...)
+        {
+            spdlog::error("Failed to compile pipeline");
+        }
+
+        // Hand the error to anyone waiting
+        // The entry stays in the library holding the error, so it's only tried again when one of its
+        // shaders is rebuilt
+        request.promise->set_exception(exception);
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "pipeline.hpp"
+#include "util/jobsystem.hpp"
+
+namespace Rendering
+{
+    // Thread safe cache of pipelines keyed by their description
+    // Lookups only take a shared lock on one of several shards, so threads requesting pipelines in the
+    // hot path don't contend with each other, and a pipeline requested by several threads at once is
+    // only compiled once - the others wait for the first one to finish
+    // Pipelines can also be compiled in the background on the job system, in batches
+    class PipelineLibrary
+    {
+        public:
+            static constexpr size_t ShardCount = 16;
+
+            // Most pipelines handed to the driver in one create call
+            static constexpr size_t MaxBatchSize = 8;
+
+            PipelineLibrary(Util::JobSystem& jobSystem);
+            ~PipelineLibrary();
+
+            // Returns the pipeline for the description, blocking until it's built
+            // Throws if it failed to build
+            // Pipelines live as long as the library
+            const Pipeline& get(const PipelineDesc& desc);
+
+            // Returns the pipeline if it's ready, otherwise queues it up to compile in the background
+            // and returns null, so the caller can skip the draw or use a fallback
+            // Pipelines that failed to build keep returning null until one of their shaders is rebuilt
+            const Pipeline* tryGet(const PipelineDesc& desc);
+
+            // Queues pipelines to compile in the background
+            void request(const std::vector<PipelineDesc>& descs);
+
+            // Hands queued pipelines to the job system in batches - called once a frame
+            void flush();
+
+            // Compiles everything queued so far, helping out on the calling thread
+            void waitForCompiles();
+
+            // Rebuilds every pipeline that uses the shader, swapping them in once they're all built
+            // Old pipelines go to the deletion queue, so they stay alive until every frame submitted so far
+            // has finished
+            // If anything fails to build, the old pipelines are kept and false is returned
+            bool rebuild(const Shader& shader);
+
+            size_t getPipelineCount() const;
+
+        private:
+            using PipelineFuture = std::shared_future<std::shared_ptr<const Pipeline>>;
+            using PipelinePromise = std::promise<std::shared_ptr<const Pipeline>>;
+
+            struct Shard
+            {
+                mutable std::shared_mutex mutex;
+                std::unordered_map<PipelineDesc, PipelineFuture, PipelineDescHash> pipelines;
+            };
+
+            // Pipeline waiting to be compiled by whoever claimed it
+            struct Request
+            {
+                PipelineDesc desc;
+                std::shared_ptr<PipelinePromise> promise;
+            };
+
+            Shard& getShard(const PipelineDesc& desc);
+
+            // Adds an entry for a pipeline that doesn't exist yet, leaving the caller responsible for
+            // building it, or returns the existing entry
+            std::optional<Request> claim(const PipelineDesc& desc, PipelineFuture& future);
+
+            // If the batch fails its pipelines are built one at a time, so only the broken ones fail
+            void compileBatch(std::vector<Request>& batch);
+            void fail(Request& request, std::exception_ptr exception);
+
+            Util::JobSystem& m_jobSystem;
+            std::array<Shard, ShardCount> m_shards;
+
+            std::mutex m_requestMutex;
+            std::vector<Request> m_requests;
+            Util::JobSystem::Counter m_compileCounter;
+    };
+}
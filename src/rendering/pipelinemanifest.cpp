@@ -0,0 +1,146 @@
+#include "pipelinemanifest.hpp"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+namespace Rendering
+{
+    template <typename T>
+    static T lookupSetting(const std::map<std::string, T>& values, const std::string& key, const std::string& value)
+    {
+        auto found = values.find(value);
+        if (found == values.end())
+        {
+            throw std::runtime_error(fmt::format("Unknown {} value {}", key, value));
+        }
+
+        return found->second;
+    }
+
+    // Applies a single key=value override to a description
+    static void applyOverride(PipelineDesc& desc, const std::string& key, const std::string& value)
+    {
+        static const std::map<std::string, vk::CullModeFlags> cullModes = {
+            {"none", vk::CullModeFlagBits::eNone},
+            {"front", vk::CullModeFlagBits::eFront},
+            {"back", vk::CullModeFlagBits::eBack}
+        };
+        static const std::map<std::string, vk::PrimitiveTopology> topologies = {
+            {"triangles", vk::PrimitiveTopology::eTriangleList},
+            {"lines", vk::PrimitiveTopology::eLineList},
+            {"points", vk::PrimitiveTopology::ePointList}
+        };
+        // Source and destination color factors
+        static const std::map<std::string, std::pair<vk::BlendFactor, vk::BlendFactor>> blendModes = {
+            {"none", {vk::BlendFactor::eOne, vk::BlendFactor::eZero}},
+            {"alpha", {vk::BlendFactor::eSrcAlpha, vk::BlendFactor::eOneMinusSrcAlpha}},
+            {"additive", {vk::BlendFactor::eOne, vk::BlendFactor::eOne}}
+        };
+
+        if (key == "cull")
+        {
+            desc.cullMode = lookupSetting(cullModes, key, value);
+        }
+        else if (key == "topology")
+        {
+            desc.topology = lookupSetting(topologies, key, value);
+        }
+        else if (key == "blend")
+        {
+            auto factors = lookupSetting(blendModes, key, value);
+            desc.blendEnable = value != "none";
+            desc.sourceColorBlendFactor = factors.first;
+            desc.destinationColorBlendFactor = factors.second;
+        }
+        else
+        {
+            throw std::runtime_error(fmt::format("Unknown pipeline setting {}", key));
+        }
+    }
+
+    std::vector<PipelineDesc> loadPipelineManifest(const std::string_view& filePath, ShaderLibrary& shaders,
+        const Pass& pass)
+    {
+        std::vector<PipelineDesc> descs;
+
+        std::ifstream file{std::string(filePath)};
+        if (!file.is_open())
+        {
+            spdlog::warn("No pipeline manifest found at \"{}\"", filePath);
+            return descs;
+        }
+
+        std::string line;
+        size_t lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            lineNumber++;
+
+            std::istringstream tokens(line);
+            std::string vertexShader, fragmentShader;
+            if (!(tokens >> vertexShader) || vertexShader.front() == '#')
+            {
+                continue;
+            }
+            if (!(tokens >> fragmentShader))
+            {
+                spdlog::error("Pipeline manifest \"{}\" line {} is missing a fragment shader", filePath, lineNumber);
+                throw std::runtime_error("Invalid pipeline manifest");
+            }
+
+            PipelineDesc desc;
+            desc.pass = &pass;
+            ShaderCompiler::Defines defines;
+
+            std::string setting;
+            while (tokens >> setting)
+            {
+                auto separator = setting.find('=');
+                try
+                {
+                    if (separator == std::string::npos)
+                    {
+                        throw std::runtime_error("Expected key=value but found " + setting);
+                    }
+
+                    auto key = setting.substr(0, separator);
+                    auto value = setting.substr(separator + 1);
+                    if (key == "define")
+                    {
+                        // Defines are NAME or NAME=VALUE, and select a permutation of both shaders
+                        auto valueSeparator = value.find('=');
+                        if (valueSeparator == std::string::npos)
+                        {
+                            defines.emplace_back(value, "");
+                        }
+                        else
+                        {
+                            defines.emplace_back(value.substr(0, valueSeparator), value.substr(valueSeparator + 1));
+                        }
+                    }
+                    else
+                    {
+                        applyOverride(desc, key, value);
+                    }
+                }
+                catch (const std::runtime_error& exception)
+                {
+                    spdlog::error("Pipeline manifest \"{}\" line {}: {}", filePath, lineNumber, exception.what());
+                    throw std::runtime_error("Invalid pipeline manifest");
+                }
+            }
+
+            desc.vertexShader = &shaders.get(vertexShader, defines);
+            desc.fragmentShader = &shaders.get(fragmentShader, defines);
+            descs.push_back(desc);
+        }
+
+        spdlog::info("Loaded {} pipelines from manifest \"{}\"", descs.size(), filePath);
+        return descs;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "pipeline.hpp"
+#include "shaderlibrary.hpp"
+
+namespace Rendering
+{
+    // Reads a list of pipelines to compile ahead of time
+    // Each line names a vertex and fragment shader followed by optional state overrides:
+    //     rc/shaders/test.vert rc/shaders/test.frag cull=none blend=alpha define=TINT=0.5
+    // Supported overrides are cull (none, front, back), topology (triangles, lines, points),
+    // blend (none, alpha, additive) and define (NAME or NAME=VALUE, passed to both shaders and
+    // repeatable). Blank lines and lines starting with # are skipped
+    // A missing manifest just means there's nothing to precompile
+    std::vector<PipelineDesc> loadPipelineManifest(const std::string_view& filePath, ShaderLibrary& shaders,
+        const Pass& pass);
+}
@@ -0,0 +1,803 @@
+#include "rendergraph.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "gpuprofiler.hpp"
+#include "util/hash.hpp"
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    static bool isDepthFormat(vk::Format format)
+    {
+        switch (format)
+        {
+            case vk::Format::eD16Unorm:
+            case vk::Format::eX8D24UnormPack32:
+            case vk::Format::eD32Sfloat:
+            case vk::Format::eD16UnormS8Uint:
+            case vk::Format::eD24UnormS8Uint:
+            case vk::Format::eD32SfloatS8Uint:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static vk::ImageAspectFlags getAspectMask(vk::Format format)
+    {
+        switch (format)
+        {
+            case vk::Format::eD16UnormS8Uint:
+            case vk::Format::eD24UnormS8Uint:
+            case vk::Format::eD32SfloatS8Uint:
+                return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+            default:
+                return isDepthFormat(format) ? vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor;
+        }
+    }
+
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::addColorAttachment(ImageHandle image,
+        std::optional<vk::ClearColorValue> clearValue)
+    {
+        // Loading what was there before makes the attachment a read as well
+        Access access;
+        access.resource = image.index;
+        access.isImage = true;
+        access.isRead = !clearValue.has_value();
+        access.isWrite = true;
+        access.stages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        access.access = vk::AccessFlagBits::eColorAttachmentWrite;
+        if (access.isRead)
+        {
+            access.access |= vk::AccessFlagBits::eColorAttachmentRead;
+        }
+        access.layout = vk::ImageLayout::eColorAttachmentOptimal;
+        access.usage = vk::ImageUsageFlagBits::eColorAttachment;
+        addAccess(access);
+
+        Attachment attachment{image.index, {}};
+        if (clearValue.has_value())
+        {
+            attachment.clearValue = vk::ClearValue(clearValue.value());
+        }
+        m_colorAttachments.push_back(attachment);
+        return *this;
+    }
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::setDepthAttachment(ImageHandle image,
+        std::optional<vk::ClearDepthStencilValue> clearValue)
+    {
+        // Depth is always read for testing, so it only counts as reading the old contents if they're kept
+        Access access;
+        access.resource = image.index;
+        access.isImage = true;
+        access.isRead = !clearValue.has_value();
+        access.isWrite = true;
+        access.stages = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+        access.access = vk::AccessFlagBits::eDepthStencilAttachmentRead |
+            vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        access.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+        access.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+        addAccess(access);
+
+        Attachment attachment{image.index, {}};
+        if (clearValue.has_value())
+        {
+            attachment.clearValue = vk::ClearValue(clearValue.value());
+        }
+        m_depthAttachment = attachment;
+        return *this;
+    }
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::readImage(ImageHandle image, vk::PipelineStageFlags stages)
+    {
+        Access access;
+        access.resource = image.index;
+        access.isImage = true;
+        access.isRead = true;
+        access.isWrite = false;
+        access.stages = stages;
+        access.access = vk::AccessFlagBits::eShaderRead;
+        access.layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        access.usage = vk::ImageUsageFlagBits::eSampled;
+        addAccess(access);
+        return *this;
+    }
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::readBuffer(BufferHandle buffer, vk::PipelineStageFlags stages,
+        vk::AccessFlags access)
+    {
+        addAccess({buffer.index, false, true, false, stages, access, vk::ImageLayout::eUndefined, {}});
+        return *this;
+    }
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::writeBuffer(BufferHandle buffer, vk::PipelineStageFlags stages,
+        vk::AccessFlags access)
+    {
+        addAccess({buffer.index, false, false, true, stages, access, vk::ImageLayout::eUndefined, {}});
+        return *this;
+    }
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::setSecondaryCommandBuffers()
+    {
+        m_secondaryCommandBuffers = true;
+        return *this;
+    }
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::setSideEffects()
+    {
+        m_sideEffects = true;
+        return *this;
+    }
+
+    RenderGraph::PassBuilder& RenderGraph::PassBuilder::setExecute(ExecuteFunction execute)
+    {
+        m_execute = std::move(execute);
+        return *this;
+    }
+
+    void RenderGraph::PassBuilder::addAccess(const Access& access)
+    {
+        auto resourceCount = access.isImage ? m_graph.m_images.size() : m_graph.m_buffers.size();
+        if (access.resource >= resourceCount)
+        {
+            spdlog::error("Render graph pass \"{}\" uses an invalid resource handle", m_name);
+            throw std::runtime_error("Invalid render graph resource handle");
+        }
+
+        // A pass touching a resource several ways needs a single barrier covering all of them
+        auto existing = std::find_if(m_accesses.begin(), m_accesses.end(), [&](const auto& other) {
+            return other.resource == access.resource && other.isImage == access.isImage;
+        });
+        if (existing == m_accesses.end())
+        {
+            m_accesses.push_back(access);
+            return;
+        }
+
+        if (existing->layout != access.layout)
+        {
+            spdlog::error("Render graph pass \"{}\" uses an image in two different layouts", m_name);
+            throw std::runtime_error("Conflicting render graph image layouts");
+        }
+        existing->isRead |= access.isRead;
+        existing->isWrite |= access.isWrite;
+        existing->stages |= access.stages;
+        existing->access |= access.access;
+        existing->usage |= access.usage;
+    }
+
+
+    RenderGraph::~RenderGraph()
+    {
+        spdlog::info("Destroying render graph");
+    }
+
+    RenderGraph::ImageHandle RenderGraph::importImage(const std::string& name, const ImportedImage& image)
+    {
+        auto& resource = m_images.emplace_back();
+        resource.name = name;
+        resource.isImported = true;
+        resource.imported = image;
+        resource.state.layout = image.initialLayout;
+        resource.state.writeStages = image.initialStages;
+
+        return {static_cast<uint32_t>(m_images.size() - 1)};
+    }
+
+    RenderGraph::ImageHandle RenderGraph::createImage(const std::string& name, const TransientImageDesc& desc)
+    {
+        auto& resource = m_images.emplace_back();
+        resource.name = name;
+        resource.isImported = false;
+        resource.transientDesc = desc;
+
+        return {static_cast<uint32_t>(m_images.size() - 1)};
+    }
+
+    RenderGraph::BufferHandle RenderGraph::importBuffer(const std::string& name, vk::Buffer buffer)
+    {
+        auto& resource = m_buffers.emplace_back();
+        resource.name = name;
+        resource.buffer = buffer;
+
+        return {static_cast<uint32_t>(m_buffers.size() - 1)};
+    }
+
+    RenderGraph::PassBuilder& RenderGraph::addPass(const std::string& name)
+    {
+        m_passes.emplace_back(new PassBuilder(*this, name));
+        return *m_passes.back();
+    }
+
+    void RenderGraph::execute(const vk::CommandBuffer& commandBuffer, GpuProfiler* profiler)
+    {
+        PROFILE_FUNCTION();
+
+        auto passes = cullPasses();
+        allocateTransients(passes);
+
+        m_barrierCount = 0;
+        for (auto i : passes)
+        {
+            recordPass(commandBuffer, *i, profiler);
+        }
+        recordFinalTransitions(commandBuffer);
+
+        // Everything described this frame is recorded, so start afresh for the next
+        m_passes.clear();
+        m_images.clear();
+        m_buffers.clear();
+    }
+
+    void RenderGraph::retireFramebuffers()
+    {
+        auto& deletionQueue = Context::getDeletionQueue();
+        for (auto& i : m_framebuffers)
+        {
+            deletionQueue.retire(std::move(i.second));
+        }
+        m_framebuffers.clear();
+    }
+
+    vk::DeviceSize RenderGraph::getTransientMemorySize() const
+    {
+        vk::DeviceSize size = 0;
+        for (auto& i : m_transients.slots)
+        {
+            size += i.memory.getSize();
+        }
+        return size;
+    }
+
+
+    std::vector<RenderGraph::PassBuilder*> RenderGraph::cullPasses()
+    {
+        // Walk backwards from whatever leaves the frame, keeping each pass that writes something a kept
+        // pass reads, or that writes an imported resource
+        std::vector<bool> isImageNeeded(m_images.size());
+        std::vector<bool> isBufferNeeded(m_buffers.size(), true);
+        for (size_t i = 0; i < m_images.size(); i++)
+        {
+            isImageNeeded[i] = m_images[i].isImported;
+        }
+
+        std::vector<PassBuilder*> passes;
+        for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); pass++)
+        {
+            bool isNeeded = (*pass)->m_sideEffects;
+            for (auto& i : (*pass)->m_accesses)
+            {
+                if (i.isWrite && (i.isImage ? isImageNeeded[i.resource] : isBufferNeeded[i.resource]))
+                {
+                    isNeeded = true;
+                }
+            }
+
+            if (!isNeeded)
+            {
+                continue;
+            }
+
+            for (auto& i : (*pass)->m_accesses)
+            {
+                if (i.isRead && i.isImage)
+                {
+                    isImageNeeded[i.resource] = true;
+                }
+            }
+            passes.push_back(pass->get());
+        }
+
+        m_culledPassCount = m_passes.size() - passes.size();
+        std::reverse(passes.begin(), passes.end());
+
+        // Passes run in the order they were added, which already puts every writer ahead of its readers
+        for (uint32_t i = 0; i < passes.size(); i++)
+        {
+            passes[i]->m_order = i;
+        }
+
+        return passes;
+    }
+
+    void RenderGraph::allocateTransients(const std::vector<PassBuilder*>& passes)
+    {
+        PROFILE_FUNCTION();
+
+        // Lifetimes and usage only count passes that survived culling
+        for (auto pass : passes)
+        {
+            for (auto& i : pass->m_accesses)
+            {
+                if (!i.isImage)
+                {
+                    continue;
+                }
+
+                auto& image = m_images[i.resource];
+                if (!image.firstPass.has_value())
+                {
+                    image.firstPass = pass->m_order;
+                    if (!image.isImported && !i.isWrite)
+                    {
+                        spdlog::error("Render graph pass \"{}\" reads transient image \"{}\" before it's written",
+                            pass->m_name, image.name);
+                        throw std::runtime_error("Transient image read before it's written");
+                    }
+                }
+                image.lastPass = pass->m_order;
+                image.usage |= i.usage;
+            }
+        }
+
+        std::vector<TransientImageKey> keys;
+        for (auto& i : m_images)
+        {
+            if (!i.isImported && i.firstPass.has_value())
+            {
+                i.transientIndex = static_cast<uint32_t>(keys.size());
+                keys.push_back({i.transientDesc, i.usage, i.firstPass.value(), i.lastPass});
+            }
+        }
+
+        // Same images used the same way as last frame, so the same memory layout still works
+        if (keys == m_transients.keys)
+        {
+            return;
+        }
+
+        // Earlier frames may still be using the old images
+        // Cached framebuffers hold on to the old views, and are keyed by handles that can be reused
+        if (!m_transients.keys.empty())
+        {
+            spdlog::info("Retiring transient images");
+            Context::getDeletionQueue().retire(std::move(m_transients));
+            retireFramebuffers();
+        }
+        m_transients = TransientSet();
+        m_transients.keys = keys;
+
+        auto& device = Context::getVulkanDevice();
+        std::vector<vk::MemoryRequirements> requirements;
+        for (auto& i : keys)
+        {
+            vk::ImageCreateInfo createInfo;
+            createInfo.imageType = vk::ImageType::e2D;
+            createInfo.format = i.desc.format;
+            createInfo.extent = vk::Extent3D{i.desc.extent.width, i.desc.extent.height, 1};
+            createInfo.mipLevels = 1;
+            createInfo.arrayLayers = 1;
+            createInfo.samples = vk::SampleCountFlagBits::e1;
+            createInfo.tiling = vk::ImageTiling::eOptimal;
+            createInfo.usage = i.usage;
+            createInfo.sharingMode = vk::SharingMode::eExclusive;
+            createInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+            m_transients.images.push_back(device.createImageUnique(createInfo));
+            requirements.push_back(device.getImageMemoryRequirements(*m_transients.images.back()));
+        }
+
+        // Place images in order of first use, reusing any slot whose last image is done by then
+        // Slots only grow to fit, so a big image late in the frame can reuse a small one's memory
+        struct SlotInfo
+        {
+            vk::MemoryRequirements requirements;
+            uint32_t lastPass;
+        };
+        std::vector<SlotInfo> slotInfos;
+
+        std::vector<uint32_t> order(keys.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+            return keys[a].firstPass < keys[b].firstPass;
+        });
+
+        m_transients.imageSlots.resize(keys.size());
+        for (auto i : order)
+        {
+            std::optional<uint32_t> bestSlot;
+            for (uint32_t slot = 0; slot < slotInfos.size(); slot++)
+            {
+                auto& info = slotInfos[slot];
+                if (info.lastPass >= keys[i].firstPass ||
+                    (info.requirements.memoryTypeBits & requirements[i].memoryTypeBits) == 0)
+                {
+                    continue;
+                }
+
+                // Prefer the slot that needs to grow the least
+                auto growth = [&](uint32_t index) {
+                    auto size = slotInfos[index].requirements.size;
+                    return requirements[i].size > size ? requirements[i].size - size : 0;
+                };
+                if (!bestSlot.has_value() || growth(slot) < growth(bestSlot.value()))
+                {
+                    bestSlot = slot;
+                }
+            }
+
+            if (!bestSlot.has_value())
+            {
+                bestSlot = static_cast<uint32_t>(slotInfos.size());
+                slotInfos.push_back({requirements[i], 0});
+            }
+
+            auto& info = slotInfos[bestSlot.value()];
+            info.requirements.size = std::max(info.requirements.size, requirements[i].size);
+            info.requirements.alignment = std::max(info.requirements.alignment, requirements[i].alignment);
+            info.requirements.memoryTypeBits &= requirements[i].memoryTypeBits;
+            info.lastPass = keys[i].lastPass;
+            m_transients.imageSlots[i] = bestSlot.value();
+        }
+
+        for (auto& i : slotInfos)
+        {
+            auto& slot = m_transients.slots.emplace_back();
+            slot.memory = Context::getAllocator().allocate(i.requirements,
+                {vk::MemoryPropertyFlagBits::eDeviceLocal}, true);
+        }
+
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            auto& memory = m_transients.slots[m_transients.imageSlots[i]].memory;
+            device.bindImageMemory(*m_transients.images[i], memory.getMemory(), memory.getOffset());
+
+            vk::ImageViewCreateInfo viewInfo;
+            viewInfo.image = *m_transients.images[i];
+            viewInfo.viewType = vk::ImageViewType::e2D;
+            viewInfo.format = keys[i].desc.format;
+            viewInfo.subresourceRange.aspectMask = getAspectMask(keys[i].desc.format);
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+            viewInfo.subresourceRange.levelCount = 1;
+
+            m_transients.imageViews.push_back(device.createImageViewUnique(viewInfo));
+        }
+
+        spdlog::info("Created {} transient images sharing {} memory slots ({} bytes)", keys.size(),
+            m_transients.slots.size(), getTransientMemorySize());
+    }
+
+
+    void RenderGraph::recordBarriers(const vk::CommandBuffer& commandBuffer, const PassBuilder& pass)
+    {
+        vk::PipelineStageFlags sourceStages;
+        vk::PipelineStageFlags destinationStages;
+        std::vector<vk::ImageMemoryBarrier> imageBarriers;
+        std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+
+        for (auto& i : pass.m_accesses)
+        {
+            ImageResource* image = i.isImage ? &m_images[i.resource] : nullptr;
+            auto& state = image != nullptr ? image->state : m_buffers[i.resource].state;
+
+            // The first image in a memory slot each frame has to wait for the last one to finish with it,
+            // including its writes to the memory, and whatever it held before is gone
+            if (image != nullptr && !image->isImported)
+            {
+                auto& slot = m_transients.slots[m_transients.imageSlots[image->transientIndex]];
+                if (image->firstPass == pass.m_order)
+                {
+                    state = ResourceState();
+                    state.writeStages = slot.stages;
+                    state.writeAccess = slot.writeAccess;
+                    slot.stages = {};
+                    slot.writeAccess = {};
+                }
+                slot.stages |= i.stages;
+                if (i.isWrite)
+                {
+                    slot.writeAccess |= i.access;
+                }
+            }
+
+            bool isLayoutChange = image != nullptr && state.layout != i.layout;
+            std::optional<vk::PipelineStageFlags> waitStages;
+            vk::AccessFlags waitAccess;
+
+            if (isLayoutChange || i.isWrite)
+            {
+                // Writes and transitions wait for every access since the last write to finish
+                auto stages = state.writeStages | state.readStages;
+                if (stages || isLayoutChange)
+                {
+                    waitStages = stages;
+                    waitAccess = state.writeAccess;
+                }
+
+                // A transition counts as a write that later readers have to wait on
+                state.writeStages = i.stages;
+                state.writeAccess = i.isWrite ? i.access : vk::AccessFlags();
+                state.readStages = i.isWrite ? vk::PipelineStageFlags() : i.stages;
+                state.visibleStages = i.stages;
+                state.visibleAccess = i.access;
+            }
+            else
+            {
+                // Reads only wait on the last write, and only once per stage and access
+                bool isVisible = (i.stages & ~state.visibleStages) == vk::PipelineStageFlags() &&
+                    (i.access & ~state.visibleAccess) == vk::AccessFlags();
+                if (state.writeStages && !isVisible)
+                {
+                    waitStages = state.writeStages;
+                    waitAccess = state.writeAccess;
+                    state.visibleStages |= i.stages;
+                    state.visibleAccess |= i.access;
+                }
+                state.readStages |= i.stages;
+            }
+
+            if (!waitStages.has_value())
+            {
+                continue;
+            }
+
+            sourceStages |= waitStages.value();
+            destinationStages |= i.stages;
+
+            if (image != nullptr)
+            {
+                vk::ImageMemoryBarrier barrier;
+                barrier.srcAccessMask = waitAccess;
+                barrier.dstAccessMask = i.access;
+                barrier.oldLayout = isLayoutChange ? state.layout : i.layout;
+                barrier.newLayout = i.layout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = getImage(*image);
+                barrier.subresourceRange = vk::ImageSubresourceRange{getAspectMask(getFormat(*image)), 0, 1, 0, 1};
+                imageBarriers.push_back(barrier);
+
+                state.layout = i.layout;
+            }
+            else
+            {
+                vk::BufferMemoryBarrier barrier;
+                barrier.srcAccessMask = waitAccess;
+                barrier.dstAccessMask = i.access;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.buffer = m_buffers[i.resource].buffer;
+                barrier.offset = 0;
+                barrier.size = VK_WHOLE_SIZE;
+                bufferBarriers.push_back(barrier);
+            }
+        }
+
+        if (imageBarriers.empty() && bufferBarriers.empty())
+        {
+            return;
+        }
+
+        // Everything the pass needs goes in a single barrier
+        if (!sourceStages)
+        {
+            sourceStages = vk::PipelineStageFlagBits::eTopOfPipe;
+        }
+        commandBuffer.pipelineBarrier(sourceStages, destinationStages, {}, {}, bufferBarriers, imageBarriers);
+        m_barrierCount += imageBarriers.size() + bufferBarriers.size();
+    }
+
+    AttachmentDesc RenderGraph::getAttachmentDesc(const PassBuilder& pass, uint32_t image, bool isCleared,
+        vk::ImageLayout layout) const
+    {
+        auto& resource = m_images[image];
+
+        // Contents only need loading if the pass keeps them, and storing if anything later could see them
+        bool hasContents = resource.isImported ? resource.state.layout != vk::ImageLayout::eUndefined :
+            resource.firstPass != pass.m_order;
+        bool isUsedLater = resource.isImported || resource.lastPass > pass.m_order;
+
+        AttachmentDesc desc;
+        desc.format = getFormat(resource);
+        desc.loadOp = isCleared ? vk::AttachmentLoadOp::eClear :
+            (hasContents ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eDontCare);
+        desc.storeOp = isUsedLater ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+
+        // Barriers take care of every transition, so the pass itself never changes layouts
+        desc.initialLayout = layout;
+        desc.finalLayout = layout;
+        return desc;
+    }
+
+    void RenderGraph::recordPass(const vk::CommandBuffer& commandBuffer, PassBuilder& pass, GpuProfiler* profiler)
+    {
+        // Pass names don't live long enough to go in the CPU trace
+        PROFILE_FUNCTION();
+
+        // Load ops depend on the state before the pass's barriers
+        PassDesc passDesc;
+        for (auto& i : pass.m_colorAttachments)
+        {
+            passDesc.colorAttachments.push_back(getAttachmentDesc(pass, i.image, i.clearValue.has_value(),
+                vk::ImageLayout::eColorAttachmentOptimal));
+        }
+        if (pass.m_depthAttachment.has_value())
+        {
+            auto& depth = pass.m_depthAttachment.value();
+            passDesc.depthAttachment = getAttachmentDesc(pass, depth.image, depth.clearValue.has_value(),
+                vk::ImageLayout::eDepthStencilAttachmentOptimal);
+        }
+
+        recordBarriers(commandBuffer, pass);
+
+        std::optional<GpuProfiler::Scope> scope;
+        if (profiler != nullptr)
+        {
+            scope.emplace(*profiler, commandBuffer, pass.m_name);
+        }
+
+        if (passDesc.colorAttachments.empty() && !passDesc.depthAttachment.has_value())
+        {
+            if (pass.m_execute)
+            {
+                pass.m_execute(commandBuffer, PassContext());
+            }
+            return;
+        }
+
+        // Attachments are in the same order as the render pass describes them
+        std::vector<const PassBuilder::Attachment*> attachments;
+        for (auto& i : pass.m_colorAttachments)
+        {
+            attachments.push_back(&i);
+        }
+        if (pass.m_depthAttachment.has_value())
+        {
+            attachments.push_back(&pass.m_depthAttachment.value());
+        }
+
+        FramebufferKey framebufferKey;
+        framebufferKey.renderPass = getPass(passDesc).getRenderPass();
+        framebufferKey.extent = getExtent(m_images[attachments.front()->image]);
+
+        std::vector<vk::ClearValue> clearValues;
+        for (auto i : attachments)
+        {
+            auto& image = m_images[i->image];
+            if (getExtent(image) != framebufferKey.extent)
+            {
+                spdlog::error("Render graph pass \"{}\" has attachments of different sizes", pass.m_name);
+                throw std::runtime_error("Mismatched render graph attachment sizes");
+            }
+
+            framebufferKey.attachments.push_back(getImageView(image));
+            clearValues.push_back(i->clearValue.value_or(vk::ClearValue()));
+        }
+
+        PassContext context;
+        context.renderPass = framebufferKey.renderPass;
+        context.framebuffer = getFramebuffer(framebufferKey);
+        context.extent = framebufferKey.extent;
+
+        vk::RenderPassBeginInfo beginInfo;
+        beginInfo.renderPass = context.renderPass;
+        beginInfo.framebuffer = context.framebuffer;
+        beginInfo.renderArea.offset = vk::Offset2D({0, 0});
+        beginInfo.renderArea.extent = context.extent;
+        beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        beginInfo.pClearValues = clearValues.data();
+
+        commandBuffer.beginRenderPass(beginInfo, pass.m_secondaryCommandBuffers ?
+            vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline);
+        if (pass.m_execute)
+        {
+            pass.m_execute(commandBuffer, context);
+        }
+        commandBuffer.endRenderPass();
+    }
+
+    void RenderGraph::recordFinalTransitions(const vk::CommandBuffer& commandBuffer)
+    {
+        vk::PipelineStageFlags sourceStages;
+        std::vector<vk::ImageMemoryBarrier> barriers;
+
+        for (auto& i : m_images)
+        {
+            if (!i.isImported || i.imported.finalLayout == vk::ImageLayout::eUndefined ||
+                i.imported.finalLayout == i.state.layout)
+            {
+                continue;
+            }
+
+            sourceStages |= i.state.writeStages | i.state.readStages;
+
+            vk::ImageMemoryBarrier barrier;
+            barrier.srcAccessMask = i.state.writeAccess;
+            barrier.oldLayout = i.state.layout;
+            barrier.newLayout = i.imported.finalLayout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = i.imported.image;
+            barrier.subresourceRange = vk::ImageSubresourceRange{getAspectMask(i.imported.format), 0, 1, 0, 1};
+            barriers.push_back(barrier);
+        }
+
+        if (barriers.empty())
+        {
+            return;
+        }
+
+        // Whatever uses the images next waits on its own semaphore or timeline value, so nothing here waits
+        if (!sourceStages)
+        {
+            sourceStages = vk::PipelineStageFlagBits::eTopOfPipe;
+        }
+        commandBuffer.pipelineBarrier(sourceStages, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, barriers);
+        m_barrierCount += barriers.size();
+    }
+
+
+    vk::Image RenderGraph::getImage(const ImageResource& image) const
+    {
+        return image.isImported ? image.imported.image : *m_transients.images[image.transientIndex];
+    }
+
+    vk::ImageView RenderGraph::getImageView(const ImageResource& image) const
+    {
+        return image.isImported ? image.imported.imageView : *m_transients.imageViews[image.transientIndex];
+    }
+
+    vk::Extent2D RenderGraph::getExtent(const ImageResource& image) const
+    {
+        return image.isImported ? image.imported.extent : image.transientDesc.extent;
+    }
+
+    vk::Format RenderGraph::getFormat(const ImageResource& image) const
+    {
+        return image.isImported ? image.imported.format : image.transientDesc.format;
+    }
+
+    const Pass& RenderGraph::getPass(const PassDesc& desc)
+    {
+        auto pass = m_renderPasses.find(desc);
+        if (pass == m_renderPasses.end())
+        {
+            pass = m_renderPasses.emplace(desc, std::make_unique<Pass>(desc)).first;
+        }
+        return *pass->second;
+    }
+
+    vk::Framebuffer RenderGraph::getFramebuffer(const FramebufferKey& key)
+    {
+        auto framebuffer = m_framebuffers.find(key);
+        if (framebuffer == m_framebuffers.end())
+        {
+            vk::FramebufferCreateInfo createInfo;
+            createInfo.renderPass = key.renderPass;
+            createInfo.attachmentCount = static_cast<uint32_t>(key.attachments.size());
+            createInfo.pAttachments = key.attachments.data();
+            createInfo.width = key.extent.width;
+            createInfo.height = key.extent.height;
+            createInfo.layers = 1;
+
+            framebuffer = m_framebuffers.emplace(key,
+                Context::getVulkanDevice().createFramebufferUnique(createInfo)).first;
+        }
+        return *framebuffer->second;
+    }
+
+    size_t RenderGraph::FramebufferKeyHash::operator()(const FramebufferKey& key) const
+    {
+        size_t seed = 0;
+
+        Util::hashCombine(seed, static_cast<VkRenderPass>(key.renderPass));
+        for (auto& i : key.attachments)
+        {
+            Util::hashCombine(seed, static_cast<VkImageView>(i));
+        }
+        Util::hashCombine(seed, key.extent.width);
+        Util::hashCombine(seed, key.extent.height);
+
+        return seed;
+    }
+}
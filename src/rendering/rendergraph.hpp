@@ -0,0 +1,306 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "memory.hpp"
+#include "pass.hpp"
+
+namespace Rendering
+{
+    class GpuProfiler;
+
+    // Frame graph that's described again every frame, where each pass declares the resources it reads
+    // and writes rather than managing barriers and render passes by hand
+    // On execute the graph culls passes whose results are never used, inserts the barriers and layout
+    // transitions between passes that actually need them, and records the survivors in the order
+    // they were added
+    // Transient images only live within a frame, and ones whose lifetimes don't overlap share memory
+    // Render passes, framebuffers and transient images are kept between frames, so describing the same
+    // frame again costs no Vulkan objects
+    class RenderGraph
+    {
+        public:
+            // Handles are only valid until the next execute
+            struct ImageHandle
+            {
+                uint32_t index = UINT32_MAX;
+            };
+            struct BufferHandle
+            {
+                uint32_t index = UINT32_MAX;
+            };
+
+            // Image owned outside the graph, like a swapchain image
+            struct ImportedImage
+            {
+                vk::Image image;
+                vk::ImageView imageView;
+                vk::Format format = vk::Format::eUndefined;
+                vk::Extent2D extent;
+
+                // State the image is in when the frame starts - the stages are what the first
+                // barrier waits on, like the stage a swapchain acquire semaphore is waited at
+                vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+                vk::PipelineStageFlags initialStages = vk::PipelineStageFlagBits::eTopOfPipe;
+
+                // Layout to leave the image in after the last pass, or undefined to leave it as is
+                vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+            };
+
+            // Image created by the graph that only lives for the frame
+            // Usage is worked out from how the passes use it
+            struct TransientImageDesc
+            {
+                vk::Format format = vk::Format::eUndefined;
+                vk::Extent2D extent;
+
+                bool operator==(const TransientImageDesc& other) const {
+                    return format == other.format && extent == other.extent;
+                }
+            };
+
+            // Render pass state a pass executes in, with null handles for passes without attachments
+            struct PassContext
+            {
+                vk::RenderPass renderPass;
+                vk::Framebuffer framebuffer;
+                vk::Extent2D extent;
+            };
+
+            using ExecuteFunction = std::function<void(const vk::CommandBuffer& commandBuffer,
+                const PassContext& context)>;
+
+            // Declares what a pass uses, and how to record it
+            class PassBuilder
+            {
+                friend class RenderGraph;
+
+                public:
+                    // Attachments are bound in the order they're added, matching fragment output locations
+                    // Attachments that aren't cleared keep what was there before the pass
+                    PassBuilder& addColorAttachment(ImageHandle image,
+                        std::optional<vk::ClearColorValue> clearValue = {});
+                    PassBuilder& setDepthAttachment(ImageHandle image,
+                        std::optional<vk::ClearDepthStencilValue> clearValue = {});
+
+                    // Sampled in shaders at the given stages
+                    PassBuilder& readImage(ImageHandle image, vk::PipelineStageFlags stages);
+
+                    PassBuilder& readBuffer(BufferHandle buffer, vk::PipelineStageFlags stages, vk::AccessFlags access);
+                    PassBuilder& writeBuffer(BufferHandle buffer, vk::PipelineStageFlags stages, vk::AccessFlags access);
+
+                    // The render pass is begun for secondary command buffers instead of inline commands
+                    PassBuilder& setSecondaryCommandBuffers();
+
+                    // Keeps the pass even if nothing reads what it writes
+                    PassBuilder& setSideEffects();
+
+                    PassBuilder& setExecute(ExecuteFunction execute);
+
+                private:
+                    struct Access
+                    {
+                        uint32_t resource;
+                        bool isImage;
+                        bool isRead;
+                        bool isWrite;
+                        vk::PipelineStageFlags stages;
+                        vk::AccessFlags access;
+                        vk::ImageLayout layout;
+                        vk::ImageUsageFlags usage;
+                    };
+
+                    struct Attachment
+                    {
+                        uint32_t image;
+                        std::optional<vk::ClearValue> clearValue;
+                    };
+
+                    PassBuilder(RenderGraph& graph, const std::string& name) :
+                        m_graph(graph), m_name(name)
+                    {};
+
+                    void addAccess(const Access& access);
+
+                    RenderGraph& m_graph;
+                    std::string m_name;
+                    std::vector<Access> m_accesses;
+                    std::vector<Attachment> m_colorAttachments;
+                    std::optional<Attachment> m_depthAttachment;
+                    bool m_secondaryCommandBuffers = false;
+                    bool m_sideEffects = false;
+                    ExecuteFunction m_execute;
+
+                    // Position in execution order, filled out when the graph is compiled
+                    uint32_t m_order = 0;
+            };
+
+            RenderGraph() = default;
+            ~RenderGraph();
+
+            RenderGraph(const RenderGraph&) = delete;
+            RenderGraph& operator=(const RenderGraph&) = delete;
+
+            // Imported resources are always treated as used after the frame, so passes writing them are kept
+            ImageHandle importImage(const std::string& name, const ImportedImage& image);
+            ImageHandle createImage(const std::string& name, const TransientImageDesc& desc);
+
+            // Anything an earlier submission did to the buffer must already be synchronized, like by
+            // waiting on the frame or a semaphore
+            BufferHandle importBuffer(const std::string& name, vk::Buffer buffer);
+
+            PassBuilder& addPass(const std::string& name);
+
+            // Compiles and records every pass added since the last execute, then clears the graph
+            // Passes are wrapped in GPU profiler scopes named after them when given a profiler
+            void execute(const vk::CommandBuffer& commandBuffer, GpuProfiler* profiler = nullptr);
+
+            // Framebuffers hold on to the views of imported images, so they have to be retired whenever
+            // those images are destroyed, like when a swapchain is recreated
+            // Retired objects go to the deletion queue until the frames using them are done
+            void retireFramebuffers();
+
+            // Statistics from the last execute
+            auto getCulledPassCount() const {
+                return m_culledPassCount;
+            }
+            auto getBarrierCount() const {
+                return m_barrierCount;
+            }
+            // Memory backing transient images, after aliasing
+            vk::DeviceSize getTransientMemorySize() const;
+
+        private:
+            // Accesses since the last write, tracked per resource as passes are recorded
+            struct ResourceState
+            {
+                vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+                vk::PipelineStageFlags writeStages;
+                vk::AccessFlags writeAccess;
+                vk::PipelineStageFlags readStages;
+
+                // Stages and accesses the last write has already been made visible to
+                vk::PipelineStageFlags visibleStages;
+                vk::AccessFlags visibleAccess;
+            };
+
+            struct ImageResource
+            {
+                std::string name;
+                bool isImported;
+                ImportedImage imported;
+                TransientImageDesc transientDesc;
+                vk::ImageUsageFlags usage;
+                ResourceState state;
+
+                // Execution order indices of the first and last surviving passes using the image
+                std::optional<uint32_t> firstPass;
+                uint32_t lastPass = 0;
+
+                // Index into the transient set for transient images
+                uint32_t transientIndex = 0;
+            };
+
+            struct BufferResource
+            {
+                std::string name;
+                vk::Buffer buffer;
+                ResourceState state;
+            };
+
+            // Transient image along with where it lives in the shared memory
+            struct TransientImageKey
+            {
+                TransientImageDesc desc;
+                vk::ImageUsageFlags usage;
+                uint32_t firstPass;
+                uint32_t lastPass;
+
+                bool operator==(const TransientImageKey& other) const {
+                    return desc == other.desc && usage == other.usage && firstPass == other.firstPass &&
+                        lastPass == other.lastPass;
+                }
+            };
+
+            // Memory shared by transient images with separate lifetimes
+            struct MemorySlot
+            {
+                MemoryAllocation memory;
+                // Every stage the images in the slot were used in since the slot last changed hands, and
+                // the writes they made, which the next image has to wait on before reusing the memory
+                vk::PipelineStageFlags stages;
+                vk::AccessFlags writeAccess;
+            };
+
+            struct TransientSet
+            {
+                TransientSet() = default;
+                TransientSet(TransientSet&&) = default;
+                TransientSet& operator=(TransientSet&&) = default;
+
+                // Declared first so the memory outlives the images bound to it
+                std::vector<MemorySlot> slots;
+                std::vector<vk::UniqueImage> images;
+                std::vector<vk::UniqueImageView> imageViews;
+                std::vector<uint32_t> imageSlots;
+                std::vector<TransientImageKey> keys;
+            };
+
+            struct FramebufferKey
+            {
+                vk::RenderPass renderPass;
+                std::vector<vk::ImageView> attachments;
+                vk::Extent2D extent;
+
+                bool operator==(const FramebufferKey& other) const {
+                    return renderPass == other.renderPass && attachments == other.attachments &&
+                        extent == other.extent;
+                }
+            };
+
+            struct FramebufferKeyHash
+            {
+                size_t operator()(const FramebufferKey& key) const;
+            };
+
+            // Compile steps
+            std::vector<PassBuilder*> cullPasses();
+            void allocateTransients(const std::vector<PassBuilder*>& passes);
+
+            // Recording steps
+            void recordBarriers(const vk::CommandBuffer& commandBuffer, const PassBuilder& pass);
+            AttachmentDesc getAttachmentDesc(const PassBuilder& pass, uint32_t image, bool isCleared,
+                vk::ImageLayout layout) const;
+            void recordPass(const vk::CommandBuffer& commandBuffer, PassBuilder& pass, GpuProfiler* profiler);
+            void recordFinalTransitions(const vk::CommandBuffer& commandBuffer);
+
+            vk::Image getImage(const ImageResource& image) const;
+            vk::ImageView getImageView(const ImageResource& image) const;
+            vk::Extent2D getExtent(const ImageResource& image) const;
+            vk::Format getFormat(const ImageResource& image) const;
+
+            const Pass& getPass(const PassDesc& desc);
+            vk::Framebuffer getFramebuffer(const FramebufferKey& key);
+
+            // Described this frame
+            std::vector<ImageResource> m_images;
+            std::vector<BufferResource> m_buffers;
+            std::vector<std::unique_ptr<PassBuilder>> m_passes;
+
+            // Kept between frames
+            TransientSet m_transients;
+            std::unordered_map<PassDesc, std::unique_ptr<Pass>, PassDescHash> m_renderPasses;
+            std::unordered_map<FramebufferKey, vk::UniqueFramebuffer, FramebufferKeyHash> m_framebuffers;
+
+            size_t m_culledPassCount = 0;
+            size_t m_barrierCount = 0;
+    };
+}
@@ -1,11 +1,40 @@
 #pragma once
 
+#include "settings.hpp"
 #include "instance.hpp"
+#include "memory.hpp"
+#include "timeline.hpp"
+#include "submissiontimer.hpp"
+#include "deletionqueue.hpp"
+#include "buffer.hpp"
+#include "upload.hpp"
+#include "texturefile.hpp"
+#include "texturestreamer.hpp"
+#include "uniformallocator.hpp"
+#include "vertex.hpp"
+#include "mesh.hpp"
 #include "device.hpp"
 #include "context.hpp"
 #include "window.hpp"
 #include "swapchain.hpp"
+#include "offscreen.hpp"
+#include "shaderreflection.hpp"
 #include "shader.hpp"
+#include "shadercompiler.hpp"
+#include "shaderlibrary.hpp"
+#include "shaderwatcher.hpp"
 #include "pass.hpp"
+#include "rendergraph.hpp"
+#include "pipelinecache.hpp"
+#include "layoutcache.hpp"
+#include "bindlesstable.hpp"
+#include "descriptorallocator.hpp"
 #include "pipeline.hpp"
+#include "computepipeline.hpp"
+#include "pipelinelibrary.hpp"
+#include "pipelinemanifest.hpp"
 #include "commandbuffer.hpp"
+#include "parallelrecorder.hpp"
+#include "gpuprofiler.hpp"
+#include "gpuscene.hpp"
+#include "asynccompute.hpp"
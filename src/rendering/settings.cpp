@@ -0,0 +1,6 @@
+#include "settings.hpp"
+
+namespace Rendering
+{
+    Settings settings;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Rendering
+{
+    // Global rendering settings
+    // These are read when the Instance and Context singletons are first created,
+    // so they must be filled out before anything calls Instance::get() or Context::get()
+    struct Settings
+    {
+        // Render into offscreen images instead of a window and swapchain
+        // No SDL video initialization or presentation support is required
+        bool headless = false;
+
+        // Size of the window, or of the offscreen images in headless mode
+        uint32_t width = 800;
+        uint32_t height = 600;
+
+        // Requested presentation mode, which falls back to FIFO if the surface doesn't support it
+        vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo;
+
+        // Number of frames the CPU can record ahead of the GPU
+        uint32_t framesInFlight = 2;
+
+        // Pipeline cache kept between runs, or empty to not save one
+        std::string pipelineCachePath = "pipeline_cache.bin";
+
+        // Bind resources through one big descriptor table indexed from shaders, when the device
+        // supports descriptor indexing
+        bool bindless = true;
+
+        // Directory compiled SPIR-V is cached in, keyed by the hash of everything that went into it
+        std::string shaderCacheDirectory = "shader_cache";
+    };
+
+    extern Settings settings;
+}
@@ -4,24 +4,52 @@
 
 #include "context.hpp"
 #include "util/simplefile.hpp"
+#include "util/profiler.hpp"
 
 namespace Rendering
 {
     Shader::Shader(const std::string_view& sourcePath)
     {
-        Util::SimpleFile sourceFile(sourcePath);
-        const uint32_t* shaderCode = sourceFile.getContentsRaw<uint32_t>();
-
-        vk::ShaderModuleCreateInfo createInfo;
-        createInfo.codeSize = sourceFile.getContents().size();
-        createInfo.pCode = shaderCode;
+        reload(sourcePath);
+    }
 
-        spdlog::info("Creating shader module \"{}\"", sourcePath);
-        m_shaderModule = Context::getVulkanDevice().createShaderModuleUnique(createInfo);
+    Shader::Shader(const std::vector<uint32_t>& code)
+    {
+        reload(code);
     }
 
     Shader::~Shader()
     {
         spdlog::info("Destroying shader module");
     }
+
+
+    void Shader::reload(const std::string_view& sourcePath)
+    {
+        Util::SimpleFile sourceFile(sourcePath);
+
+        spdlog::info("Creating shader module \"{}\"", sourcePath);
+        load(sourceFile.getContentsRaw<uint32_t>(), sourceFile.getContents().size());
+    }
+
+    void Shader::reload(const std::vector<uint32_t>& code)
+    {
+        load(code.data(), code.size() * sizeof(uint32_t));
+    }
+
+    void Shader::load(const uint32_t* code, size_t codeSize)
+    {
+        PROFILE_FUNCTION();
+
+        // Reflect and create the new module first, so bad code leaves the old one in place
+        auto reflection = reflectShader(code, codeSize);
+
+        vk::ShaderModuleCreateInfo createInfo;
+        createInfo.codeSize = codeSize;
+        createInfo.pCode = code;
+        auto shaderModule = Context::getVulkanDevice().createShaderModuleUnique(createInfo);
+
+        m_shaderModule = std::move(shaderModule);
+        m_reflection = std::move(reflection);
+    }
 }
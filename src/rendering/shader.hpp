@@ -1,22 +1,43 @@
 #pragma once
 
+#include <cstdint>
 #include <string_view>
+#include <vector>
 
 #include <vulkan/vulkan.hpp>
 
+#include "shaderreflection.hpp"
+
 namespace Rendering
 {
     class Shader
     {
         public:
+            // Shaders are reflected when they're loaded, so pipelines can build their layouts from them
             Shader(const std::string_view& sourcePath);
+            Shader(const std::vector<uint32_t>& code);
             ~Shader();
 
+            // Replaces the shader module with a fresh one from the file
+            // Pipelines don't need their modules once created, but nothing can be building a pipeline
+            // with this shader while it's reloaded
+            void reload(const std::string_view& sourcePath);
+            void reload(const std::vector<uint32_t>& code);
+
             vk::ShaderModule& getShaderModule() {
                 return m_shaderModule.get();
             }
+            const vk::ShaderModule& getShaderModule() const {
+                return m_shaderModule.get();
+            }
+            const ShaderReflection& getReflection() const {
+                return m_reflection;
+            }
 
         private:
+            void load(const uint32_t* code, size_t codeSize);
+
             vk::UniqueShaderModule m_shaderModule;
+            ShaderReflection m_reflection;
     };
 } 
@@ -0,0 +1,331 @@
+#include "shadercompiler.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#ifdef SIMPLE_RENDER_SHADERC
+#include <shaderc/shaderc.hpp>
+#endif
+
+#include "util/hash.hpp"
+#include "util/profiler.hpp"
+#include "util/simplefile.hpp"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace Rendering
+{
+    // Deep enough for any sane include tree, but stops include cycles from recursing forever
+    static constexpr size_t maxIncludeDepth = 32;
+
+    // Temporary files get unique names, as several threads may be compiling or caching at once
+    static std::atomic<uint64_t> nextTemporaryFile = 0;
+
+    static std::string getTemporaryPath(const std::string& path)
+    {
+        return fmt::format("{}.{}.tmp", path, nextTemporaryFile++);
+    }
+
+    // Finds the file named by an #include "..." line, or returns an empty string if it isn't one
+    static std::string parseInclude(const std::string& line)
+    {
+        auto directive = line.find_first_not_of(" \t");
+        if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+        {
+            return {};
+        }
+
+        auto begin = line.find('"', directive + 8);
+        auto end = begin == std::string::npos ? std::string::npos : line.find('"', begin + 1);
+        if (end == std::string::npos)
+        {
+            return {};
+        }
+
+        return line.substr(begin + 1, end - begin - 1);
+    }
+
+#ifdef SIMPLE_RENDER_SHADERC
+    // Resolves #include "..." relative to the file doing the including
+    class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface
+    {
+        public:
+            shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type,
+                const char* requestingSource, size_t) override
+            {
+                auto include = std::make_unique<Include>();
+                include->path = (std::filesystem::path(requestingSource).parent_path() / requestedSource).string();
+
+                std::ifstream file(include->path, std::ios::in | std::ios::binary);
+                if (file.is_open())
+                {
+                    include->contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                    include->result.source_name = include->path.c_str();
+                    include->result.source_name_length = include->path.size();
+                }
+                else
+                {
+                    // An empty source name tells shaderc the include failed, with the contents as the error
+                    include->contents = "Cannot open include file " + include->path;
+                }
+
+                include->result.content = include->contents.c_str();
+                include->result.content_length = include->contents.size();
+                include->result.user_data = include.get();
+                return &include.release()->result;
+            }
+
+            void ReleaseInclude(shaderc_include_result* result) override
+            {
+                delete static_cast<Include*>(result->user_data);
+            }
+
+        private:
+            struct Include
+            {
+                std::string path;
+                std::string contents;
+                shaderc_include_result result = {};
+            };
+    };
+#endif
+
+
+    ShaderCompiler::ShaderCompiler(const std::string& cacheDirectory) :
+        m_cacheDirectory(cacheDirectory)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(m_cacheDirectory, error);
+        if (error)
+        {
+            spdlog::warn("Cannot create shader cache directory \"{}\": {}", m_cacheDirectory, error.message());
+        }
+
+#ifdef SIMPLE_RENDER_SHADERC
+        // shaderc is linked in, so the SPIR-V version it targets is the best version we can get at
+        unsigned int version = 0, revision = 0;
+        shaderc_get_spv_version(&version, &revision);
+        m_compilerVersion = fmt::format("shaderc spv {}.{}", version, revision);
+#else
+        // glslc prints the versions of itself, shaderc and glslang on its first lines
+        if (auto pipe = popen("glslc --version", "r"))
+        {
+            char buffer[256];
+            while (std::fgets(buffer, sizeof(buffer), pipe) != nullptr)
+            {
+                m_compilerVersion += buffer;
+            }
+            pclose(pipe);
+        }
+
+        if (m_compilerVersion.empty())
+        {
+            spdlog::warn("Cannot find glslc - runtime shader compilation will fail on cache misses");
+        }
+#endif
+
+        spdlog::info("Using shader cache \"{}\"", m_cacheDirectory);
+    }
+
+
+    std::vector<uint32_t> ShaderCompiler::compile(const std::string& sourcePath, const Defines& defines)
+    {
+        PROFILE_FUNCTION();
+
+        // The stage is part of the key, as the same source compiles differently for each stage
+        auto extension = std::filesystem::path(sourcePath).extension().string();
+        uint64_t hash = Util::hashBytes(extension.data(), extension.size());
+        hash = Util::hashBytes(m_compilerVersion.data(), m_compilerVersion.size(), hash);
+        for (auto& i : defines)
+        {
+            // Include the terminators so NAME=AB,C and NAME=A,BC hash differently
+            hash = Util::hashBytes(i.first.c_str(), i.first.size() + 1, hash);
+            hash = Util::hashBytes(i.second.c_str(), i.second.size() + 1, hash);
+        }
+        hash = hashSource(sourcePath, hash, 0);
+
+        auto cachePath = (std::filesystem::path(m_cacheDirectory) / fmt::format("{:016x}.spv", hash)).string();
+
+        auto code = loadCached(cachePath);
+        if (!code.empty())
+        {
+            m_cacheHits++;
+            spdlog::info("Loaded \"{}\" from shader cache", sourcePath);
+            return code;
+        }
+
+        m_cacheMisses++;
+        code = compileSource(sourcePath, defines);
+        storeCached(cachePath, code);
+        return code;
+    }
+
+
+    uint64_t ShaderCompiler::hashSource(const std::string& sourcePath, uint64_t hash, size_t depth) const
+    {
+        if (depth > maxIncludeDepth)
+        {
+            spdlog::error("Shader includes nested too deeply at \"{}\"", sourcePath);
+            throw std::runtime_error("Shader includes nested too deeply");
+        }
+
+        Util::SimpleFile sourceFile(sourcePath);
+        auto& contents = sourceFile.getContents();
+        hash = Util::hashBytes(contents.data(), contents.size(), hash);
+
+        // Fold in the includes in the order they appear, so moving one changes the key as well
+        std::istringstream lines(std::string(contents.begin(), contents.end()));
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            auto include = parseInclude(line);
+            if (!include.empty())
+            {
+                auto includePath = std::filesystem::path(sourcePath).parent_path() / include;
+                hash = hashSource(includePath.string(), hash, depth + 1);
+            }
+        }
+
+        return hash;
+    }
+
+    std::vector<uint32_t> ShaderCompiler::compileSource(const std::string& sourcePath, const Defines& defines) const
+    {
+        PROFILE_FUNCTION();
+
+        spdlog::info("Compiling \"{}\"", sourcePath);
+
+#ifdef SIMPLE_RENDER_SHADERC
+        Util::SimpleFile sourceFile(sourcePath);
+        auto& contents = sourceFile.getContents();
+
+        shaderc::CompileOptions options;
+        options.SetIncluder(std::make_unique<ShaderIncluder>());
+        for (auto& i : defines)
+        {
+            options.AddMacroDefinition(i.first, i.second);
+        }
+
+        // Pick the stage from the extension like glslc does
+        auto extension = std::filesystem::path(sourcePath).extension();
+        auto kind = shaderc_glsl_infer_from_source;
+        if (extension == ".vert")
+        {
+            kind = shaderc_glsl_vertex_shader;
+        }
+        else if (extension == ".frag")
+        {
+            kind = shaderc_glsl_fragment_shader;
+        }
+        else if (extension == ".comp")
+        {
+            kind = shaderc_glsl_compute_shader;
+        }
+
+        shaderc::Compiler compiler;
+        auto result = compiler.CompileGlslToSpv(contents.data(), contents.size(), kind, sourcePath.c_str(), options);
+        if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+        {
+            spdlog::error("Failed to compile shader \"{}\":\n{}", sourcePath, result.GetErrorMessage());
+            throw std::runtime_error("Failed to compile shader");
+        }
+
+        return std::vector<uint32_t>(result.cbegin(), result.cend());
+#else
+        auto outputPath = getTemporaryPath((std::filesystem::path(m_cacheDirectory) / "compile").string());
+
+        auto command = "glslc \"" + sourcePath + "\" -o \"" + outputPath + "\"";
+        for (auto& i : defines)
+        {
+            command += " \"-D" + i.first + (i.second.empty() ? "" : "=" + i.second) + "\"";
+        }
+
+        if (std::system(command.c_str()) != 0)
+        {
+            spdlog::error("Failed to compile shader \"{}\"", sourcePath);
+            std::remove(outputPath.c_str());
+            throw std::runtime_error("Failed to compile shader");
+        }
+
+        auto code = loadCached(outputPath);
+        std::remove(outputPath.c_str());
+        if (code.empty())
+        {
+            throw std::runtime_error("Failed to compile shader");
+        }
+        return code;
+#endif
+    }
+
+    std::vector<uint32_t> ShaderCompiler::loadCached(const std::string& cachePath) const
+    {
+        std::ifstream file(cachePath, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            return {};
+        }
+
+        // Anything that isn't a whole number of words can't be SPIR-V, so treat it as a miss
+        auto size = static_cast<size_t>(file.tellg());
+        if (size == 0 || size % sizeof(uint32_t) != 0)
+        {
+            spdlog::warn("Ignoring invalid cached shader \"{}\"", cachePath);
+            return {};
+        }
+
+        std::vector<uint32_t> code(size / sizeof(uint32_t));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(size));
+        if (!file)
+        {
+            return {};
+        }
+
+        return code;
+    }
+
+    void ShaderCompiler::storeCached(const std::string& cachePath, const std::vector<uint32_t>& code) const
+    {
+        // Write to a temporary file and rename it into place, so a crash or another thread
+        // loading the same key never sees half a binary
+        auto temporaryPath = getTemporaryPath(cachePath);
+        {
+            std::ofstream file(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                spdlog::warn("Cannot write to shader cache \"{}\"", cachePath);
+                return;
+            }
+
+            file.write(reinterpret_cast<const char*>(code.data()),
+                static_cast<std::streamsize>(code.size() * sizeof(uint32_t)));
+            file.close();
+
+            // A short write, like on a full disk, would otherwise be renamed into place for good
+            if (!file)
+            {
+                spdlog::warn("Failed to write cached shader \"{}\"", cachePath);
+                std::remove(temporaryPath.c_str());
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, cachePath, error);
+        if (error)
+        {
+            spdlog::warn("Failed to store cached shader \"{}\": {}", cachePath, error.message());
+            std::remove(temporaryPath.c_str());
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Rendering
+{
+    // Compiles GLSL to SPIR-V at runtime, caching the results on disk by content
+    // The cache key covers the source, everything it includes, the defines and the compiler version,
+    // so a cached binary is only ever reused when compiling again would produce the same thing
+    // Uses shaderc in process when it was found at build time, and falls back to running glslc otherwise
+    class ShaderCompiler
+    {
+        public:
+            // Preprocessor defines used to build permutations of a shader
+            using Defines = std::vector<std::pair<std::string, std::string>>;
+
+            ShaderCompiler(const std::string& cacheDirectory = "shader_cache");
+
+            // Returns SPIR-V for the source, only compiling it if it isn't in the cache
+            // The stage comes from the extension (.vert, .frag or .comp)
+            std::vector<uint32_t> compile(const std::string& sourcePath, const Defines& defines = {});
+
+            size_t getCacheHits() const {
+                return m_cacheHits;
+            }
+            size_t getCacheMisses() const {
+                return m_cacheMisses;
+            }
+
+        private:
+            // Hashes the file and, recursively, every file it includes with #include "..."
+            uint64_t hashSource(const std::string& sourcePath, uint64_t hash, size_t depth) const;
+
+            std::vector<uint32_t> compileSource(const std::string& sourcePath, const Defines& defines) const;
+            std::vector<uint32_t> loadCached(const std::string& cachePath) const;
+            void storeCached(const std::string& cachePath, const std::vector<uint32_t>& code) const;
+
+            std::string m_cacheDirectory;
+            std::string m_compilerVersion;
+
+            std::atomic<size_t> m_cacheHits = 0;
+            std::atomic<size_t> m_cacheMisses = 0;
+    };
+}
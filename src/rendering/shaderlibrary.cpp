@@ -0,0 +1,82 @@
+#include "shaderlibrary.hpp"
+
+#include <filesystem>
+
+namespace Rendering
+{
+    // Sources with a stage extension are GLSL, everything else is assumed to be SPIR-V
+    static bool isGlslSource(const std::string& path)
+    {
+        auto extension = std::filesystem::path(path).extension();
+        return extension == ".vert" || extension == ".frag" || extension == ".comp";
+    }
+
+
+    ShaderLibrary::ShaderLibrary(ShaderCompiler& compiler) :
+        m_compiler(compiler)
+    {}
+
+
+    const Shader& ShaderLibrary::get(const std::string_view& path, const ShaderCompiler::Defines& defines)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        Key key(path, defines);
+        auto shader = m_shaders.find(key);
+        if (shader == m_shaders.end())
+        {
+            // GLSL goes through the compiler and its cache, SPIR-V is loaded as is
+            std::unique_ptr<Shader> newShader;
+            if (isGlslSource(key.first))
+            {
+                newShader = std::make_unique<Shader>(m_compiler.compile(key.first, key.second));
+            }
+            else
+            {
+                newShader = std::make_unique<Shader>(key.first);
+            }
+            shader = m_shaders.emplace(std::move(key), std::move(newShader)).first;
+        }
+
+        return *shader->second;
+    }
+
+    std::vector<const Shader*> ShaderLibrary::reload(const std::string_view& path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Permutations of the same path sort next to each other, starting with no defines
+        auto begin = m_shaders.lower_bound(Key(std::string(path), ShaderCompiler::Defines{}));
+        auto end = begin;
+        while (end != m_shaders.end() && end->first.first == path)
+        {
+            end++;
+        }
+
+        // Compile every permutation before replacing any, so one bad permutation leaves them all as they were
+        std::vector<std::vector<uint32_t>> permutationCode;
+        if (isGlslSource(std::string(path)))
+        {
+            for (auto shader = begin; shader != end; shader++)
+            {
+                permutationCode.push_back(m_compiler.compile(shader->first.first, shader->first.second));
+            }
+        }
+
+        std::vector<const Shader*> shaders;
+        for (auto shader = begin; shader != end; shader++)
+        {
+            if (permutationCode.empty())
+            {
+                shader->second->reload(shader->first.first);
+            }
+            else
+            {
+                shader->second->reload(permutationCode[shaders.size()]);
+            }
+            shaders.push_back(shader->second.get());
+        }
+
+        return shaders;
+    }
+}
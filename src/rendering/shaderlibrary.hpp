@@ -0,0 +1,43 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "shader.hpp"
+#include "shadercompiler.hpp"
+
+namespace Rendering
+{
+    // Loads each shader permutation once and shares it between every pipeline that uses it
+    // GLSL sources (.vert, .frag and .comp) are compiled at runtime through the shader compiler,
+    // and anything else is loaded as SPIR-V
+    class ShaderLibrary
+    {
+        public:
+            ShaderLibrary(ShaderCompiler& compiler);
+
+            // Loads the shader the first time it's asked for
+            // Shaders live as long as the library
+            const Shader& get(const std::string_view& path, const ShaderCompiler::Defines& defines = {});
+
+            // Reloads every permutation of a shader that's already been loaded, returning them all
+            std::vector<const Shader*> reload(const std::string_view& path);
+
+            ShaderCompiler& getCompiler() {
+                return m_compiler;
+            }
+
+        private:
+            using Key = std::pair<std::string, ShaderCompiler::Defines>;
+
+            ShaderCompiler& m_compiler;
+
+            std::mutex m_mutex;
+            std::map<Key, std::unique_ptr<Shader>> m_shaders;
+    };
+}
@@ -0,0 +1,521 @@
+#include "shaderreflection.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    // The handful of SPIR-V enums we need, from the SPIR-V specification
+    namespace Spirv
+    {
+        constexpr uint32_t MagicNumber = 0x07230203;
+        constexpr size_t HeaderWords = 5;
+
+        enum Op : uint32_t
+        {
+            OpEntryPoint = 15,
+            OpTypeBool = 20,
+            OpTypeInt = 21,
+            OpTypeFloat = 22,
+            OpTypeVector = 23,
+            OpTypeMatrix = 24,
+            OpTypeImage = 25,
+            OpTypeSampler = 26,
+            OpTypeSampledImage = 27,
+            OpTypeArray = 28,
+            OpTypeRuntimeArray = 29,
+            OpTypeStruct = 30,
+            OpTypePointer = 32,
+            OpConstant = 43,
+            OpSpecConstantTrue = 48,
+            OpSpecConstantFalse = 49,
+            OpSpecConstant = 50,
+            OpVariable = 59,
+            OpDecorate = 71,
+            OpMemberDecorate = 72
+        };
+
+        enum Decoration : uint32_t
+        {
+            SpecId = 1,
+            BufferBlock = 3,
+            ArrayStride = 6,
+            MatrixStride = 7,
+            BuiltIn = 11,
+            Location = 30,
+            Binding = 33,
+            DescriptorSet = 34,
+            Offset = 35
+        };
+
+        enum StorageClass : uint32_t
+        {
+            UniformConstant = 0,
+            Input = 1,
+            Uniform = 2,
+            PushConstant = 9,
+            StorageBuffer = 12
+        };
+
+        enum ExecutionModel : uint32_t
+        {
+            Vertex = 0,
+            TessellationControl = 1,
+            TessellationEvaluation = 2,
+            Geometry = 3,
+            Fragment = 4,
+            GLCompute = 5
+        };
+
+        enum Dim : uint32_t
+        {
+            DimBuffer = 5,
+            DimSubpassData = 6
+        };
+    }
+
+
+    namespace
+    {
+        // Everything we track about a single result id
+        struct Id
+        {
+            uint32_t opcode = 0;
+
+            // Type operands, meaning depends on the opcode
+            std::vector<uint32_t> operands;
+
+            // Decorations on the id, and on each member for structs
+            std::map<uint32_t, uint32_t> decorations;
+            std::map<uint32_t, std::map<uint32_t, uint32_t>> memberDecorations;
+
+            // Value of 32-bit constants, used for array lengths
+            uint32_t constant = 0;
+        };
+
+        class Parser
+        {
+            public:
+                Parser(const uint32_t* code, size_t wordCount);
+
+                ShaderReflection reflect() const;
+
+            private:
+                const Id& getId(uint32_t id) const;
+
+                // Strips arrays off a type, multiplying their lengths into count
+                uint32_t getElementType(uint32_t type, uint32_t& count) const;
+
+                vk::DescriptorType getDescriptorType(uint32_t type, uint32_t storageClass) const;
+                vk::Format getVertexFormat(uint32_t type) const;
+
+                // Size of a type inside a block, using the strides decorated on it
+                uint32_t getSize(uint32_t type, uint32_t matrixStride) const;
+
+                std::vector<Id> m_ids;
+                uint32_t m_executionModel = Spirv::Vertex;
+                std::vector<uint32_t> m_variables;
+                std::vector<uint32_t> m_specializationConstants;
+        };
+
+        Parser::Parser(const uint32_t* code, size_t wordCount)
+        {
+            if (wordCount < Spirv::HeaderWords || code[0] != Spirv::MagicNumber)
+            {
+                throw std::runtime_error("Shader code isn't SPIR-V");
+            }
+
+            // The id bound in the header covers every result id
+            m_ids.resize(code[3]);
+            bool foundEntryPoint = false;
+
+            for (size_t offset = Spirv::HeaderWords; offset < wordCount; )
+            {
+                // Each instruction starts with its word count in the high half and opcode in the low half
+                uint32_t instructionWords = code[offset] >> 16;
+                uint32_t opcode = code[offset] & 0xffff;
+                if (instructionWords == 0 || offset + instructionWords > wordCount)
+                {
+                    throw std::runtime_error("Malformed SPIR-V instruction");
+                }
+
+                const uint32_t* operands = code + offset + 1;
+                size_t operandCount = instructionWords - 1;
+                offset += instructionWords;
+
+                // Operands every instruction we read must have
+                auto requireOperands = [&](size_t count) {
+                    if (operandCount < count)
+                    {
+                        throw std::runtime_error("Malformed SPIR-V instruction");
+                    }
+                };
+
+                switch (opcode)
+                {
+                    case Spirv::OpEntryPoint:
+                        requireOperands(1);
+                        if (!foundEntryPoint)
+                        {
+                            m_executionModel = operands[0];
+                            foundEntryPoint = true;
+                        }
+                        break;
+
+                    case Spirv::OpDecorate:
+                        if (operandCount >= 2)
+                        {
+                            m_ids.at(operands[0]).decorations[operands[1]] = operandCount >= 3 ? operands[2] : 0;
+                        }
+                        break;
+
+                    case Spirv::OpMemberDecorate:
+                        if (operandCount >= 3)
+                        {
+                            m_ids.at(operands[0]).memberDecorations[operands[1]][operands[2]] =
+                                operandCount >= 4 ? operands[3] : 0;
+                        }
+                        break;
+
+                    case Spirv::OpTypeBool:
+                    case Spirv::OpTypeInt:
+                    case Spirv::OpTypeFloat:
+                    case Spirv::OpTypeVector:
+                    case Spirv::OpTypeMatrix:
+                    case Spirv::OpTypeImage:
+                    case Spirv::OpTypeSampler:
+                    case Spirv::OpTypeSampledImage:
+                    case Spirv::OpTypeArray:
+                    case Spirv::OpTypeRuntimeArray:
+                    case Spirv::OpTypeStruct:
+                    case Spirv::OpTypePointer:
+                    {
+                        // Types put their result id first
+                        requireOperands(1);
+                        auto& id = m_ids.at(operands[0]);
+                        id.opcode = opcode;
+                        id.operands.assign(operands + 1, operands + operandCount);
+                        break;
+                    }
+
+                    case Spirv::OpConstant:
+                    case Spirv::OpSpecConstant:
+                    case Spirv::OpSpecConstantTrue:
+                    case Spirv::OpSpecConstantFalse:
+                    {
+                        // Constants put their type first, then the result id
+                        requireOperands(2);
+                        auto& id = m_ids.at(operands[1]);
+                        id.opcode = opcode;
+                        id.operands = {operands[0]};
+                        id.constant = operandCount >= 3 ? operands[2] : 0;
+                        if (opcode != Spirv::OpConstant)
+                        {
+                            m_specializationConstants.push_back(operands[1]);
+                        }
+                        break;
+                    }
+
+                    case Spirv::OpVariable:
+                    {
+                        // Result type, result id then storage class
+                        requireOperands(3);
+                        auto& id = m_ids.at(operands[1]);
+                        id.opcode = opcode;
+                        id.operands = {operands[0], operands[2]};
+                        m_variables.push_back(operands[1]);
+                        break;
+                    }
+
+                    default:
+                        break;
+                }
+            }
+
+            if (!foundEntryPoint)
+            {
+                throw std::runtime_error("SPIR-V has no entry point");
+            }
+        }
+
+        ShaderReflection Parser::reflect() const
+        {
+            ShaderReflection reflection;
+
+            static const std::map<uint32_t, vk::ShaderStageFlagBits> stages = {
+                {Spirv::Vertex, vk::ShaderStageFlagBits::eVertex},
+                {Spirv::TessellationControl, vk::ShaderStageFlagBits::eTessellationControl},
+                {Spirv::TessellationEvaluation, vk::ShaderStageFlagBits::eTessellationEvaluation},
+                {Spirv::Geometry, vk::ShaderStageFlagBits::eGeometry},
+                {Spirv::Fragment, vk::ShaderStageFlagBits::eFragment},
+                {Spirv::GLCompute, vk::ShaderStageFlagBits::eCompute}
+            };
+            auto stage = stages.find(m_executionModel);
+            if (stage == stages.end())
+            {
+                throw std::runtime_error("Unsupported shader stage");
+            }
+            reflection.stage = stage->second;
+
+            for (auto i : m_variables)
+            {
+                auto& variable = getId(i);
+                auto& pointer = getId(variable.operands[0]);
+                uint32_t storageClass = variable.operands[1];
+                uint32_t pointeeType = pointer.operands.at(1);
+
+                if (storageClass == Spirv::UniformConstant || storageClass == Spirv::Uniform ||
+                    storageClass == Spirv::StorageBuffer)
+                {
+                    ShaderReflection::DescriptorBinding binding;
+                    auto set = variable.decorations.find(Spirv::DescriptorSet);
+                    auto bindingIndex = variable.decorations.find(Spirv::Binding);
+                    if (set == variable.decorations.end() || bindingIndex == variable.decorations.end())
+                    {
+                        continue;
+                    }
+
+                    binding.set = set->second;
+                    binding.binding = bindingIndex->second;
+                    binding.type = getDescriptorType(getElementType(pointeeType, binding.count), storageClass);
+                    reflection.descriptorBindings.push_back(binding);
+                }
+                else if (storageClass == Spirv::PushConstant)
+                {
+                    // Push constants are always a single block, so the range runs from its first member to its end
+                    auto& block = getId(pointeeType);
+                    uint32_t begin = UINT32_MAX;
+                    for (auto& member : block.memberDecorations)
+                    {
+                        auto offset = member.second.find(Spirv::Offset);
+                        if (offset != member.second.end())
+                        {
+                            begin = std::min(begin, offset->second);
+                        }
+                    }
+                    uint32_t end = getSize(pointeeType, 0);
+
+                    if (end > begin)
+                    {
+                        reflection.pushConstantRanges.emplace_back(reflection.stage, begin, end - begin);
+                    }
+                }
+                else if (storageClass == Spirv::Input && m_executionModel == Spirv::Vertex)
+                {
+                    auto location = variable.decorations.find(Spirv::Location);
+                    if (location == variable.decorations.end() || variable.decorations.count(Spirv::BuiltIn) != 0)
+                    {
+                        continue;
+                    }
+
+                    reflection.vertexInputs.push_back({location->second, getVertexFormat(pointeeType)});
+                }
+            }
+
+            for (auto i : m_specializationConstants)
+            {
+                auto& constant = getId(i);
+                auto specId = constant.decorations.find(Spirv::SpecId);
+                if (specId == constant.decorations.end())
+                {
+                    continue;
+                }
+
+                // Booleans are specialized through a VkBool32
+                auto& type = getId(constant.operands[0]);
+                uint32_t size = type.opcode == Spirv::OpTypeBool ? 4 : type.operands.at(0) / 8;
+                reflection.specializationConstants.push_back({specId->second, size});
+            }
+
+            // Sorted so the same resources always reflect the same way
+            std::sort(reflection.descriptorBindings.begin(), reflection.descriptorBindings.end(),
+                [](const auto& a, const auto& b) {
+                    return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+                });
+            std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(),
+                [](const auto& a, const auto& b) {
+                    return a.location < b.location;
+                });
+
+            return reflection;
+        }
+
+        const Id& Parser::getId(uint32_t id) const
+        {
+            auto& result = m_ids.at(id);
+            if (result.opcode == 0)
+            {
+                throw std::runtime_error("SPIR-V references an undefined id");
+            }
+
+            return result;
+        }
+
+        uint32_t Parser::getElementType(uint32_t type, uint32_t& count) const
+        {
+            while (true)
+            {
+                auto& id = getId(type);
+                if (id.opcode == Spirv::OpTypeArray)
+                {
+                    count *= getId(id.operands.at(1)).constant;
+                }
+                else if (id.opcode == Spirv::OpTypeRuntimeArray)
+                {
+                    count = 0;
+                }
+                else
+                {
+                    return type;
+                }
+
+                type = id.operands.at(0);
+            }
+        }
+
+        vk::DescriptorType Parser::getDescriptorType(uint32_t type, uint32_t storageClass) const
+        {
+            auto& id = getId(type);
+
+            if (storageClass == Spirv::StorageBuffer)
+            {
+                return vk::DescriptorType::eStorageBuffer;
+            }
+            if (storageClass == Spirv::Uniform)
+            {
+                // Older SPIR-V marks storage buffers as uniform blocks with a BufferBlock decoration
+                return id.decorations.count(Spirv::BufferBlock) != 0 ? vk::DescriptorType::eStorageBuffer :
+                    vk::DescriptorType::eUniformBuffer;
+            }
+
+            switch (id.opcode)
+            {
+                case Spirv::OpTypeSampler:
+                    return vk::DescriptorType::eSampler;
+                case Spirv::OpTypeSampledImage:
+                    return vk::DescriptorType::eCombinedImageSampler;
+                case Spirv::OpTypeImage:
+                {
+                    // Operands are sampled type, dim, depth, arrayed, multisampled then sampled,
+                    // where 2 means the image is only used for storage
+                    uint32_t dim = id.operands.at(1);
+                    bool isStorage = id.operands.at(5) == 2;
+                    if (dim == Spirv::DimBuffer)
+                    {
+                        return isStorage ? vk::DescriptorType::eStorageTexelBuffer :
+                            vk::DescriptorType::eUniformTexelBuffer;
+                    }
+                    if (dim == Spirv::DimSubpassData)
+                    {
+                        return vk::DescriptorType::eInputAttachment;
+                    }
+                    return isStorage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+                }
+                default:
+                    throw std::runtime_error("Unsupported SPIR-V descriptor type");
+            }
+        }
+
+        vk::Format Parser::getVertexFormat(uint32_t type) const
+        {
+            auto* id = &getId(type);
+            uint32_t components = 1;
+            if (id->opcode == Spirv::OpTypeVector)
+            {
+                components = id->operands.at(1);
+                id = &getId(id->operands.at(0));
+            }
+
+            if (id->operands.empty() || id->operands[0] != 32 || components < 1 || components > 4)
+            {
+                return vk::Format::eUndefined;
+            }
+
+            static const vk::Format floatFormats[] = {vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat,
+                vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat};
+            static const vk::Format signedFormats[] = {vk::Format::eR32Sint, vk::Format::eR32G32Sint,
+                vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint};
+            static const vk::Format unsignedFormats[] = {vk::Format::eR32Uint, vk::Format::eR32G32Uint,
+                vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint};
+
+            if (id->opcode == Spirv::OpTypeFloat)
+            {
+                return floatFormats[components - 1];
+            }
+            if (id->opcode == Spirv::OpTypeInt)
+            {
+                // Int operands are width then signedness
+                return id->operands.at(1) != 0 ? signedFormats[components - 1] : unsignedFormats[components - 1];
+            }
+            return vk::Format::eUndefined;
+        }
+
+        uint32_t Parser::getSize(uint32_t type, uint32_t matrixStride) const
+        {
+            auto& id = getId(type);
+
+            switch (id.opcode)
+            {
+                case Spirv::OpTypeBool:
+                    return 4;
+                case Spirv::OpTypeInt:
+                case Spirv::OpTypeFloat:
+                    return id.operands.at(0) / 8;
+                case Spirv::OpTypeVector:
+                    return getSize(id.operands.at(0), 0) * id.operands.at(1);
+                case Spirv::OpTypeMatrix:
+                    // Columns are laid out matrix stride apart
+                    return matrixStride * id.operands.at(1);
+                case Spirv::OpTypeArray:
+                {
+                    auto stride = id.decorations.find(Spirv::ArrayStride);
+                    uint32_t length = getId(id.operands.at(1)).constant;
+                    return stride == id.decorations.end() ? 0 : stride->second * length;
+                }
+                case Spirv::OpTypeStruct:
+                {
+                    uint32_t size = 0;
+                    for (uint32_t member = 0; member < id.operands.size(); member++)
+                    {
+                        auto decorations = id.memberDecorations.find(member);
+                        if (decorations == id.memberDecorations.end())
+                        {
+                            continue;
+                        }
+
+                        auto offset = decorations->second.find(Spirv::Offset);
+                        auto stride = decorations->second.find(Spirv::MatrixStride);
+                        if (offset != decorations->second.end())
+                        {
+                            size = std::max(size, offset->second + getSize(id.operands[member],
+                                stride == decorations->second.end() ? 0 : stride->second));
+                        }
+                    }
+                    return size;
+                }
+                default:
+                    return 0;
+            }
+        }
+    }
+
+
+    ShaderReflection reflectShader(const uint32_t* code, size_t codeSize)
+    {
+        PROFILE_FUNCTION();
+
+        Parser parser(code, codeSize / sizeof(uint32_t));
+        auto reflection = parser.reflect();
+
+        spdlog::debug("Reflected {} descriptor bindings, {} push constant ranges and {} vertex inputs",
+            reflection.descriptorBindings.size(), reflection.pushConstantRanges.size(),
+            reflection.vertexInputs.size());
+        return reflection;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Rendering
+{
+    // Resources a shader uses, read straight out of its SPIR-V
+    struct ShaderReflection
+    {
+        struct DescriptorBinding
+        {
+            uint32_t set = 0;
+            uint32_t binding = 0;
+            vk::DescriptorType type = vk::DescriptorType::eUniformBuffer;
+
+            // Number of array elements, or 0 for a runtime sized array
+            uint32_t count = 1;
+        };
+
+        struct VertexInput
+        {
+            uint32_t location = 0;
+
+            // Undefined if the input isn't a 32-bit scalar or vector
+            vk::Format format = vk::Format::eUndefined;
+        };
+
+        struct SpecializationConstant
+        {
+            uint32_t id = 0;
+            uint32_t size = 0;
+        };
+
+        vk::ShaderStageFlagBits stage = vk::ShaderStageFlagBits::eVertex;
+        std::vector<DescriptorBinding> descriptorBindings;
+        std::vector<vk::PushConstantRange> pushConstantRanges;
+
+        // Only filled out for vertex shaders, ignoring built-ins
+        std::vector<VertexInput> vertexInputs;
+
+        std::vector<SpecializationConstant> specializationConstants;
+    };
+
+    // Parses the SPIR-V for the first entry point's stage and every resource variable it declares
+    // Throws if the code isn't valid SPIR-V
+    ShaderReflection reflectShader(const uint32_t* code, size_t codeSize);
+}
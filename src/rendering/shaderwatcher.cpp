@@ -0,0 +1,152 @@
+#include "shaderwatcher.hpp"
+
+#include <filesystem>
+#include <set>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    ShaderWatcher::ShaderWatcher(Util::JobSystem& jobSystem, ShaderCompiler& compiler,
+        const std::string& sourceDirectory, const std::string& outputDirectory) :
+        m_jobSystem(jobSystem), m_compiler(compiler), m_sourceDirectory(sourceDirectory),
+        m_outputDirectory(outputDirectory)
+    {
+#ifdef __linux__
+        spdlog::info("Watching \"{}\" for shader changes", m_sourceDirectory);
+
+        m_inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_inotifyDescriptor < 0)
+        {
+            spdlog::error("Failed to initialize inotify");
+            throw std::runtime_error("Failed to initialize inotify");
+        }
+
+        // Editors often save by writing a new file and renaming it over the old one
+        m_watchDescriptor = inotify_add_watch(m_inotifyDescriptor, m_sourceDirectory.c_str(),
+            IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (m_watchDescriptor < 0)
+        {
+            spdlog::error("Failed to watch shader directory \"{}\"", m_sourceDirectory);
+            close(m_inotifyDescriptor);
+            throw std::runtime_error("Failed to watch shader directory");
+        }
+#else
+        spdlog::warn("Shader hot reloading is only supported on Linux");
+#endif
+    }
+
+    ShaderWatcher::~ShaderWatcher()
+    {
+        // Compile jobs reference the watcher
+        m_jobSystem.wait(m_compileCounter);
+
+#ifdef __linux__
+        spdlog::info("Stopping shader watcher");
+        close(m_inotifyDescriptor);
+#endif
+    }
+
+
+    void ShaderWatcher::poll()
+    {
+#ifdef __linux__
+        // A single save can fire several events, so only compile each file once per poll
+        std::set<std::string> changedFiles;
+
+        alignas(inotify_event) char buffer[4096];
+        while (true)
+        {
+            auto length = read(m_inotifyDescriptor, buffer, sizeof(buffer));
+            if (length <= 0)
+            {
+                break;
+            }
+
+            for (ssize_t offset = 0; offset < length; )
+            {
+                auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0)
+                {
+                    changedFiles.emplace(event->name);
+                }
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+
+        for (auto& i : changedFiles)
+        {
+            // Only GLSL sources, not editor swap files and the like
+            auto extension = std::filesystem::path(i).extension();
+            if (extension != ".vert" && extension != ".frag" && extension != ".comp")
+            {
+                continue;
+            }
+
+            spdlog::info("Shader source \"{}\" changed", i);
+            m_jobSystem.run([this, i]() {
+                compile(i);
+            }, &m_compileCounter);
+        }
+#endif
+    }
+
+    std::vector<std::string> ShaderWatcher::takeCompiledShaders()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::vector<std::string> compiledShaders;
+        std::swap(compiledShaders, m_compiledShaders);
+        return compiledShaders;
+    }
+
+
+    void ShaderWatcher::compile(const std::string& fileName)
+    {
+        PROFILE_FUNCTION();
+
+        std::filesystem::path sourcePath = std::filesystem::path(m_sourceDirectory) / fileName;
+        auto outputPath = (std::filesystem::path(m_outputDirectory) / fileName).string();
+
+        // Compiling here leaves the result in the cache for when the shader is reloaded, and
+        // stops a broken source from ever replacing the working copy
+        try
+        {
+            m_compiler.compile(sourcePath.string());
+        }
+        catch (const std::exception& exception)
+        {
+            spdlog::error("Failed to compile shader \"{}\": {}", sourcePath.string(), exception.what());
+            return;
+        }
+
+        // Copy to a temporary file and rename it into place, so a reload mid-copy never sees half a source
+        auto temporaryPath = outputPath + ".tmp";
+        std::error_code error;
+        std::filesystem::copy_file(sourcePath, temporaryPath, std::filesystem::copy_options::overwrite_existing,
+            error);
+        if (error)
+        {
+            spdlog::error("Failed to copy shader \"{}\": {}", sourcePath.string(), error.message());
+            return;
+        }
+
+        std::filesystem::rename(temporaryPath, outputPath, error);
+        if (error)
+        {
+            spdlog::error("Failed to replace shader \"{}\": {}", outputPath, error.message());
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_compiledShaders.push_back(outputPath);
+    }
+}
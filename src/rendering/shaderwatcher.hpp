@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "shadercompiler.hpp"
+#include "util/jobsystem.hpp"
+
+namespace Rendering
+{
+    // Watches a directory of GLSL sources and recompiles them whenever they change
+    // Compiles run on the job system and fill the shader cache, then the source is copied over the
+    // one the app loads. Those are picked up at the start of a frame so shaders and pipelines are
+    // only ever swapped between frames, and reloading them there only costs a cache lookup
+    // Only supported on Linux (through inotify) - elsewhere the watcher does nothing
+    class ShaderWatcher
+    {
+        public:
+            // Compiled sources are copied to the same name in the output directory, matching the build
+            ShaderWatcher(Util::JobSystem& jobSystem, ShaderCompiler& compiler, const std::string& sourceDirectory,
+                const std::string& outputDirectory);
+            ~ShaderWatcher();
+
+            ShaderWatcher(const ShaderWatcher&) = delete;
+            ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+            // Checks for changed sources without blocking and starts compiling them
+            void poll();
+
+            // Output paths of the shaders compiled since the last call
+            std::vector<std::string> takeCompiledShaders();
+
+        private:
+            void compile(const std::string& fileName);
+
+            Util::JobSystem& m_jobSystem;
+            ShaderCompiler& m_compiler;
+            std::string m_sourceDirectory;
+            std::string m_outputDirectory;
+
+            int m_inotifyDescriptor = -1;
+            int m_watchDescriptor = -1;
+
+            std::mutex m_mutex;
+            std::vector<std::string> m_compiledShaders;
+            Util::JobSystem::Counter m_compileCounter;
+    };
+}
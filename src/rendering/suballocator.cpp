@@ -0,0 +1,394 @@
+#include "suballocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Rendering
+{
+    // Index of the highest set bit (value must be non-zero)
+    static uint32_t findLastSet(uint64_t value)
+    {
+        uint32_t result = 0;
+        while (value >>= 1)
+        {
+            result++;
+        }
+        return result;
+    }
+
+    // Index of the lowest set bit (value must be non-zero)
+    static uint32_t findFirstSet(uint64_t value)
+    {
+        uint32_t result = 0;
+        while ((value & 1) == 0)
+        {
+            value >>= 1;
+            result++;
+        }
+        return result;
+    }
+
+    static uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+
+
+    LinearSubAllocator::LinearSubAllocator(uint64_t size) :
+        SubAllocator(size)
+    {}
+
+    std::optional<uint64_t> LinearSubAllocator::allocate(uint64_t size, uint64_t alignment)
+    {
+        auto offset = alignUp(m_head, std::max<uint64_t>(alignment, 1));
+        if (offset + size > m_size)
+        {
+            return {};
+        }
+
+        m_head = offset + size;
+        m_allocationSizes[offset] = size;
+        m_usedBytes += size;
+        m_allocationCount++;
+
+        return offset;
+    }
+
+    void LinearSubAllocator::free(uint64_t offset)
+    {
+        auto allocation = m_allocationSizes.find(offset);
+        assert(allocation != m_allocationSizes.end());
+
+        m_usedBytes -= allocation->second;
+        m_allocationCount--;
+        m_allocationSizes.erase(allocation);
+
+        // Space is only reclaimed once the whole block is free
+        if (m_allocationCount == 0)
+        {
+            m_head = 0;
+        }
+    }
+
+
+
+    BuddySubAllocator::BuddySubAllocator(uint64_t size, uint64_t minimumBlockSize) :
+        SubAllocator(uint64_t(1) << findLastSet(size)), m_minimumBlockSize(minimumBlockSize)
+    {
+        // One free list per power of two between the minimum size and the full block
+        auto orderCount = findLastSet(m_size / m_minimumBlockSize) + 1;
+        m_freeBlocks.resize(orderCount);
+        m_freeBlocks.back().insert(0);
+    }
+
+    std::optional<uint64_t> BuddySubAllocator::allocate(uint64_t size, uint64_t alignment)
+    {
+        // Blocks are always aligned to their own size, so alignment is just a minimum size
+        auto requiredSize = std::max({size, alignment, m_minimumBlockSize});
+        auto order = findLastSet((requiredSize - 1) / m_minimumBlockSize) + 1;
+        if (requiredSize <= m_minimumBlockSize)
+        {
+            order = 0;
+        }
+
+        // Find the smallest free block that fits
+        auto freeOrder = order;
+        while (freeOrder < m_freeBlocks.size() && m_freeBlocks[freeOrder].empty())
+        {
+            freeOrder++;
+        }
+
+        if (freeOrder >= m_freeBlocks.size())
+        {
+            return {};
+        }
+
+        auto offset = *m_freeBlocks[freeOrder].begin();
+        m_freeBlocks[freeOrder].erase(m_freeBlocks[freeOrder].begin());
+
+        // Split it in half until it's the size we want, freeing the upper halves
+        while (freeOrder > order)
+        {
+            freeOrder--;
+            m_freeBlocks[freeOrder].insert(offset + getOrderSize(freeOrder));
+        }
+
+        m_allocationOrders[offset] = order;
+        m_usedBytes += getOrderSize(order);
+        m_allocationCount++;
+
+        return offset;
+    }
+
+    void BuddySubAllocator::free(uint64_t offset)
+    {
+        auto allocation = m_allocationOrders.find(offset);
+        assert(allocation != m_allocationOrders.end());
+
+        auto order = allocation->second;
+        m_usedBytes -= getOrderSize(order);
+        m_allocationCount--;
+        m_allocationOrders.erase(allocation);
+
+        // Merge with our buddy for as long as it's free
+        while (order + 1 < m_freeBlocks.size())
+        {
+            auto buddy = offset ^ getOrderSize(order);
+            auto buddyEntry = m_freeBlocks[order].find(buddy);
+
+            if (buddyEntry == m_freeBlocks[order].end())
+            {
+                break;
+            }
+
+            m_freeBlocks[order].erase(buddyEntry);
+            offset = std::min(offset, buddy);
+            order++;
+        }
+
+        m_freeBlocks[order].insert(offset);
+    }
+
+
+
+    TlsfSubAllocator::TlsfSubAllocator(uint64_t size) :
+        SubAllocator(size), m_secondLevelBitmaps(FirstLevelCount, 0),
+        m_freeLists(FirstLevelCount * SecondLevelCount, NullNode)
+    {
+        // Start with the whole block free
+        insertFreeNode(createNode(0, size));
+    }
+
+    std::optional<uint64_t> TlsfSubAllocator::allocate(uint64_t size, uint64_t alignment)
+    {
+        size = std::max<uint64_t>(size, 1);
+        alignment = std::max<uint64_t>(alignment, 1);
+
+        // Try a block of just the right size first, and fall back to one that is guaranteed
+        // to fit after padding for alignment
+        auto node = findFreeNode(size);
+        if (node.has_value() &&
+            alignUp(m_nodes[node.value()].offset, alignment) + size > m_nodes[node.value()].offset + m_nodes[node.value()].size)
+        {
+            node = findFreeNode(size + alignment - 1);
+        }
+
+        if (!node.has_value())
+        {
+            return {};
+        }
+
+        auto index = node.value();
+        removeFreeNode(index);
+
+        // Split off the alignment padding in front as its own free block
+        // Free blocks are always merged with their neighbours, so the block in front of us
+        // can't be free
+        auto alignedOffset = alignUp(m_nodes[index].offset, alignment);
+        auto padding = alignedOffset - m_nodes[index].offset;
+        if (padding > 0)
+        {
+            auto paddingNode = createNode(m_nodes[index].offset, padding);
+            m_nodes[paddingNode].previousPhysical = m_nodes[index].previousPhysical;
+            m_nodes[paddingNode].nextPhysical = index;
+            if (m_nodes[index].previousPhysical != NullNode)
+            {
+                m_nodes[m_nodes[index].previousPhysical].nextPhysical = paddingNode;
+            }
+
+            m_nodes[index].previousPhysical = paddingNode;
+            m_nodes[index].offset = alignedOffset;
+            m_nodes[index].size -= padding;
+            insertFreeNode(paddingNode);
+        }
+
+        // Split off whatever is left over behind us
+        auto remaining = m_nodes[index].size - size;
+        if (remaining > 0)
+        {
+            auto remainingNode = createNode(alignedOffset + size, remaining);
+            m_nodes[remainingNode].previousPhysical = index;
+            m_nodes[remainingNode].nextPhysical = m_nodes[index].nextPhysical;
+            if (m_nodes[index].nextPhysical != NullNode)
+            {
+                m_nodes[m_nodes[index].nextPhysical].previousPhysical = remainingNode;
+            }
+
+            m_nodes[index].nextPhysical = remainingNode;
+            m_nodes[index].size = size;
+            insertFreeNode(remainingNode);
+        }
+
+        m_nodes[index].isFree = false;
+        m_allocatedNodes[alignedOffset] = index;
+        m_usedBytes += size;
+        m_allocationCount++;
+
+        return alignedOffset;
+    }
+
+    void TlsfSubAllocator::free(uint64_t offset)
+    {
+        auto allocation = m_allocatedNodes.find(offset);
+        assert(allocation != m_allocatedNodes.end());
+
+        auto index = allocation->second;
+        m_allocatedNodes.erase(allocation);
+        m_usedBytes -= m_nodes[index].size;
+        m_allocationCount--;
+        m_nodes[index].isFree = true;
+
+        // Merge with the previous block if it's free
+        auto previous = m_nodes[index].previousPhysical;
+        if (previous != NullNode && m_nodes[previous].isFree)
+        {
+            removeFreeNode(previous);
+            m_nodes[previous].size += m_nodes[index].size;
+            m_nodes[previous].nextPhysical = m_nodes[index].nextPhysical;
+            if (m_nodes[index].nextPhysical != NullNode)
+            {
+                m_nodes[m_nodes[index].nextPhysical].previousPhysical = previous;
+            }
+
+            destroyNode(index);
+            index = previous;
+        }
+
+        // Merge with the next block if it's free
+        auto next = m_nodes[index].nextPhysical;
+        if (next != NullNode && m_nodes[next].isFree)
+        {
+            removeFreeNode(next);
+            m_nodes[index].size += m_nodes[next].size;
+            m_nodes[index].nextPhysical = m_nodes[next].nextPhysical;
+            if (m_nodes[next].nextPhysical != NullNode)
+            {
+                m_nodes[m_nodes[next].nextPhysical].previousPhysical = index;
+            }
+
+            destroyNode(next);
+        }
+
+        insertFreeNode(index);
+    }
+
+
+    TlsfSubAllocator::ListIndex TlsfSubAllocator::getListIndex(uint64_t size)
+    {
+        // Small sizes get a linear list each
+        if (size < SecondLevelCount)
+        {
+            return {0, static_cast<uint32_t>(size)};
+        }
+
+        auto log = findLastSet(size);
+        return {
+            log - SecondLevelBits + 1,
+            static_cast<uint32_t>(size >> (log - SecondLevelBits)) - SecondLevelCount
+        };
+    }
+
+    uint32_t TlsfSubAllocator::createNode(uint64_t offset, uint64_t size)
+    {
+        Node node{offset, size, true, NullNode, NullNode, NullNode, NullNode};
+
+        // Reuse an old node slot if we have one
+        if (!m_unusedNodes.empty())
+        {
+            auto index = m_unusedNodes.back();
+            m_unusedNodes.pop_back();
+            m_nodes[index] = node;
+            return index;
+        }
+
+        m_nodes.push_back(node);
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+
+    void TlsfSubAllocator::destroyNode(uint32_t node)
+    {
+        m_unusedNodes.push_back(node);
+    }
+
+    void TlsfSubAllocator::insertFreeNode(uint32_t node)
+    {
+        auto listIndex = getListIndex(m_nodes[node].size);
+        auto& head = m_freeLists[listIndex.firstLevel * SecondLevelCount + listIndex.secondLevel];
+
+        m_nodes[node].isFree = true;
+        m_nodes[node].previousFree = NullNode;
+        m_nodes[node].nextFree = head;
+        if (head != NullNode)
+        {
+            m_nodes[head].previousFree = node;
+        }
+        head = node;
+
+        m_firstLevelBitmap |= uint64_t(1) << listIndex.firstLevel;
+        m_secondLevelBitmaps[listIndex.firstLevel] |= uint32_t(1) << listIndex.secondLevel;
+    }
+
+    void TlsfSubAllocator::removeFreeNode(uint32_t node)
+    {
+        auto listIndex = getListIndex(m_nodes[node].size);
+        auto& head = m_freeLists[listIndex.firstLevel * SecondLevelCount + listIndex.secondLevel];
+
+        auto previous = m_nodes[node].previousFree;
+        auto next = m_nodes[node].nextFree;
+        if (previous != NullNode)
+        {
+            m_nodes[previous].nextFree = next;
+        }
+        if (next != NullNode)
+        {
+            m_nodes[next].previousFree = previous;
+        }
+        if (head == node)
+        {
+            head = next;
+        }
+
+        // Clear the bitmaps once the list is empty
+        if (head == NullNode)
+        {
+            m_secondLevelBitmaps[listIndex.firstLevel] &= ~(uint32_t(1) << listIndex.secondLevel);
+            if (m_secondLevelBitmaps[listIndex.firstLevel] == 0)
+            {
+                m_firstLevelBitmap &= ~(uint64_t(1) << listIndex.firstLevel);
+            }
+        }
+    }
+
+    std::optional<uint32_t> TlsfSubAllocator::findFreeNode(uint64_t size) const
+    {
+        // Round up to the next list so any block we find is big enough
+        if (size >= SecondLevelCount)
+        {
+            size += (uint64_t(1) << (findLastSet(size) - SecondLevelBits)) - 1;
+        }
+        auto listIndex = getListIndex(size);
+        if (listIndex.firstLevel >= FirstLevelCount)
+        {
+            return {};
+        }
+
+        // Look for a larger list in the same power of two, then in the larger powers of two
+        auto secondLevelMap = m_secondLevelBitmaps[listIndex.firstLevel] & (~uint32_t(0) << listIndex.secondLevel);
+        if (secondLevelMap == 0)
+        {
+            auto firstLevelMap = (listIndex.firstLevel + 1 < 64) ?
+                m_firstLevelBitmap & (~uint64_t(0) << (listIndex.firstLevel + 1)) : 0;
+            if (firstLevelMap == 0)
+            {
+                return {};
+            }
+
+            listIndex.firstLevel = findFirstSet(firstLevelMap);
+            secondLevelMap = m_secondLevelBitmaps[listIndex.firstLevel];
+        }
+
+        listIndex.secondLevel = findFirstSet(secondLevelMap);
+        return m_freeLists[listIndex.firstLevel * SecondLevelCount + listIndex.secondLevel];
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace Rendering
+{
+    // Hands out ranges of a fixed size block of memory
+    // These only do the bookkeeping, and never touch any actual memory
+    class SubAllocator
+    {
+        public:
+            SubAllocator(uint64_t size) :
+                m_size(size)
+            {};
+            virtual ~SubAllocator() = default;
+
+            // Returns the offset of the new range, or nothing if it doesn't fit
+            virtual std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment) = 0;
+            virtual void free(uint64_t offset) = 0;
+
+            auto getSize() const {
+                return m_size;
+            }
+            auto getUsedBytes() const {
+                return m_usedBytes;
+            }
+            auto getAllocationCount() const {
+                return m_allocationCount;
+            }
+            bool getIsEmpty() const {
+                return m_allocationCount == 0;
+            }
+
+        protected:
+            uint64_t m_size;
+            uint64_t m_usedBytes = 0;
+            uint32_t m_allocationCount = 0;
+    };
+
+
+    // Bump allocator - ranges are only reclaimed once everything in the block has been freed
+    // Best for short lived allocations that are all released together, like staging data
+    class LinearSubAllocator : public SubAllocator
+    {
+        public:
+            LinearSubAllocator(uint64_t size);
+
+            std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment) override;
+            void free(uint64_t offset) override;
+
+        private:
+            uint64_t m_head = 0;
+            std::unordered_map<uint64_t, uint64_t> m_allocationSizes;
+    };
+
+
+    // Power of two buddy allocator - fast and fragmentation resistant, but rounds every
+    // allocation up to a power of two
+    class BuddySubAllocator : public SubAllocator
+    {
+        public:
+            // Size is rounded down to a power of two
+            BuddySubAllocator(uint64_t size, uint64_t minimumBlockSize = 256);
+
+            std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment) override;
+            void free(uint64_t offset) override;
+
+        private:
+            uint64_t getOrderSize(uint32_t order) const {
+                return m_minimumBlockSize << order;
+            }
+
+            uint64_t m_minimumBlockSize;
+            std::vector<std::set<uint64_t>> m_freeBlocks;
+            std::unordered_map<uint64_t, uint32_t> m_allocationOrders;
+    };
+
+
+    // Two level segregated fit allocator - constant time good fit allocation for
+    // arbitrarily sized ranges, with immediate coalescing of free neighbours
+    class TlsfSubAllocator : public SubAllocator
+    {
+        public:
+            TlsfSubAllocator(uint64_t size);
+
+            std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment) override;
+            void free(uint64_t offset) override;
+
+        private:
+            // Each power of two size class is split into 2^SecondLevelBits linear subdivisions
+            static constexpr uint32_t SecondLevelBits = 5;
+            static constexpr uint32_t SecondLevelCount = 1 << SecondLevelBits;
+            static constexpr uint32_t FirstLevelCount = 64 - SecondLevelBits + 1;
+            static constexpr uint32_t NullNode = UINT32_MAX;
+
+            // Physical range of the block, either free or allocated
+            struct Node
+            {
+                uint64_t offset;
+                uint64_t size;
+                bool isFree;
+                uint32_t previousPhysical;
+                uint32_t nextPhysical;
+                uint32_t previousFree;
+                uint32_t nextFree;
+            };
+
+            struct ListIndex
+            {
+                uint32_t firstLevel;
+                uint32_t secondLevel;
+            };
+
+            static ListIndex getListIndex(uint64_t size);
+
+            uint32_t createNode(uint64_t offset, uint64_t size);
+            void destroyNode(uint32_t node);
+            void insertFreeNode(uint32_t node);
+            void removeFreeNode(uint32_t node);
+            std::optional<uint32_t> findFreeNode(uint64_t size) const;
+
+            std::vector<Node> m_nodes;
+            std::vector<uint32_t> m_unusedNodes;
+            std::unordered_map<uint64_t, uint32_t> m_allocatedNodes;
+
+            uint64_t m_firstLevelBitmap = 0;
+            std::vector<uint32_t> m_secondLevelBitmaps;
+            std::vector<uint32_t> m_freeLists;
+    };
+}
@@ -0,0 +1,96 @@
+#include "submissiontimer.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    SubmissionTimer::SubmissionTimer(Timeline& timeline) :
+        m_timeline(timeline)
+    {
+        m_thread = std::thread(&SubmissionTimer::threadMain, this);
+    }
+
+    SubmissionTimer::~SubmissionTimer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopping = true;
+        }
+        m_condition.notify_all();
+
+        m_thread.join();
+    }
+
+
+    void SubmissionTimer::track(uint64_t value, uint64_t tag)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_hasFailed)
+            {
+                return;
+            }
+            m_pending.push_back({value, tag, std::chrono::steady_clock::now()});
+        }
+        m_condition.notify_all();
+    }
+
+    void SubmissionTimer::finish()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_pending.empty(); });
+    }
+
+    std::vector<SubmissionTimer::Result> SubmissionTimer::takeResults()
+    {
+        std::vector<Result> results;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::swap(results, m_results);
+        return results;
+    }
+
+
+    void SubmissionTimer::threadMain()
+    {
+        Util::Profiler::get().setThreadName("submission timer");
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            // Only stop once everything tracked has finished, as it was submitted and will be signalled
+            m_condition.wait(lock, [this]() { return m_isStopping || !m_pending.empty(); });
+            if (m_pending.empty())
+            {
+                return;
+            }
+
+            auto submission = m_pending.front();
+            lock.unlock();
+
+            try
+            {
+                m_timeline.wait(submission.value);
+            }
+            catch (const std::exception& exception)
+            {
+                // Like a lost device - nothing else tracked will finish either, so stop timing
+                spdlog::error("Failed to wait for a timed submission: {}", exception.what());
+
+                lock.lock();
+                m_hasFailed = true;
+                m_pending.clear();
+                m_condition.notify_all();
+                return;
+            }
+            std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - submission.submitTime;
+
+            lock.lock();
+            m_results.push_back({submission.tag, time.count()});
+            m_pending.pop_front();
+            m_condition.notify_all();
+        }
+    }
+}
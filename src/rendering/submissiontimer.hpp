@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "timeline.hpp"
+
+namespace Rendering
+{
+    // Times submissions from when they're handed to the queue until the GPU finishes them
+    // A thread waits on each tracked timeline value in turn and notes when it was signalled, so the
+    // time doesn't depend on when the app next gets around to waiting on that submission itself
+    class SubmissionTimer
+    {
+        public:
+            struct Result
+            {
+                // Whatever the submission was tracked with, like a frame number
+                uint64_t tag;
+                double milliseconds;
+            };
+
+            SubmissionTimer(Timeline& timeline);
+            // Waits for every tracked submission to finish
+            ~SubmissionTimer();
+
+            SubmissionTimer(const SubmissionTimer&) = delete;
+            SubmissionTimer& operator=(const SubmissionTimer&) = delete;
+
+            // Starts timing the submission that signals the value, which should have just been submitted
+            // Values have to be tracked in the order they're signalled
+            void track(uint64_t value, uint64_t tag);
+
+            // Blocks until every tracked submission has been timed
+            void finish();
+
+            // Submissions timed since the last call, in submission order
+            std::vector<Result> takeResults();
+
+        private:
+            struct Submission
+            {
+                uint64_t value;
+                uint64_t tag;
+                std::chrono::steady_clock::time_point submitTime;
+            };
+
+            void threadMain();
+
+            Timeline& m_timeline;
+
+            std::mutex m_mutex;
+            std::condition_variable m_condition;
+            // Includes the submission the thread is waiting on, until it's been timed
+            std::deque<Submission> m_pending;
+            std::vector<Result> m_results;
+            bool m_isStopping = false;
+            // Set when waiting fails, after which nothing more is timed
+            bool m_hasFailed = false;
+
+            std::thread m_thread;
+    };
+}
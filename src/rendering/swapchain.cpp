@@ -4,23 +4,21 @@
 #include <limits>
 
 #include <spdlog/spdlog.h>
-#include <SDL2/SDL_vulkan.h>
 
 #include "context.hpp"
 #include "device.hpp"
 #include "window.hpp"
-#include "pass.hpp"
+#include "settings.hpp"
+#include "util/profiler.hpp"
 
 namespace Rendering
 {
-    vk::PresentModeKHR defaultPresentMode = vk::PresentModeKHR::eFifo;
-
-    Swapchain::Swapchain(Window& window, Pass& pass) :
-        m_renderPass(pass)
+    Swapchain::Swapchain(Window& window)
     {
+        PROFILE_FUNCTION();
+
         createVulkanSwapchain(window);
         aquireSwapchainImages();
-        createFramebuffers();
     }
 
     Swapchain::~Swapchain()
@@ -29,25 +27,66 @@ namespace Rendering
     }
 
 
-    void Swapchain::createVulkanSwapchain(Window& window)
+    void Swapchain::recreate(Window& window)
+    {
+        PROFILE_FUNCTION();
+
+        spdlog::info("Recreating swapchain");
+
+        // Hold on to the current swapchain until the frames using it are done
+        RetiredSwapchain retired;
+        retired.swapchain = std::move(m_swapchain);
+        retired.images = std::move(m_swapchainImages);
+        m_swapchainImages.clear();
+
+        createVulkanSwapchain(window, *retired.swapchain);
+        aquireSwapchainImages();
+
+        Context::getDeletionQueue().retire(std::move(retired));
+    }
+
+
+    vk::PresentModeKHR Swapchain::selectPresentMode() const
+    {
+        // The device hands out a copy of its properties, so keep it alive while we look through it
+        auto properties = Context::get().getDevice().getProperties();
+        auto& presentModes = properties.getPresentModes();
+
+        if (std::find(presentModes.begin(), presentModes.end(), settings.presentMode) != presentModes.end())
+        {
+            return settings.presentMode;
+        }
+
+        // FIFO is the only mode every surface has to support
+        spdlog::warn("Present mode {} is not supported, falling back to FIFO", vk::to_string(settings.presentMode));
+        return vk::PresentModeKHR::eFifo;
+    }
+
+    void Swapchain::createVulkanSwapchain(Window& window, vk::SwapchainKHR oldSwapchain)
     {
         // Grab the first surface format
         m_surfaceFormat = Context::get().getDevice().getSurfaceFormat();
-        auto presentMode = defaultPresentMode;
+        m_presentMode = selectPresentMode();
 
         // Find surface exent limits
         auto surfaceCapabilties =
             Context::get().getDevice().getProperties().getPhysicalDevice().getSurfaceCapabilitiesKHR(window.getSurface());
 
-        // Query the actual resolution of the Vulkan window
-        int swapchainWidth, swapchainHeight;
-        SDL_Vulkan_GetDrawableSize(window.getSdlWindow(), &swapchainWidth, &swapchainHeight);
+        // Use the surface size if it has one, otherwise query the actual resolution of the Vulkan window
+        if (surfaceCapabilties.currentExtent.width != std::numeric_limits<uint32_t>::max())
+        {
+            m_swapchainExtents = surfaceCapabilties.currentExtent;
+        }
+        else
+        {
+            auto drawableExtents = window.getDrawableExtents();
 
-        // Limit extents by surface capabilities
-        m_swapchainExtents.width = std::clamp(static_cast<uint32_t>(swapchainWidth),
-            surfaceCapabilties.maxImageExtent.width, surfaceCapabilties.minImageExtent.width);
-        m_swapchainExtents.height = std::clamp(static_cast<uint32_t>(swapchainHeight),
-            surfaceCapabilties.maxImageExtent.height, surfaceCapabilties.minImageExtent.height);
+            // Limit extents by surface capabilities
+            m_swapchainExtents.width = std::clamp(drawableExtents.width,
+                surfaceCapabilties.minImageExtent.width, surfaceCapabilties.maxImageExtent.width);
+            m_swapchainExtents.height = std::clamp(drawableExtents.height,
+                surfaceCapabilties.minImageExtent.height, surfaceCapabilties.maxImageExtent.height);
+        }
 
         // Set image count to the minimum required plus one, unless limited
         uint32_t imageCount = surfaceCapabilties.minImageCount + 1;
@@ -92,11 +131,12 @@ namespace Rendering
         createInfo.preTransform = surfaceCapabilties.currentTransform;
         createInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
         createInfo.clipped = true;
-        createInfo.presentMode = presentMode;
-        createInfo.oldSwapchain = nullptr;
+        createInfo.presentMode = m_presentMode;
+        createInfo.oldSwapchain = oldSwapchain;
 
         // Create the Vulkan handle and log additional information on error
-        spdlog::info("Creating Vulkan swapchain");
+        spdlog::info("Creating Vulkan swapchain of size {}x{} with present mode {}", m_swapchainExtents.width,
+            m_swapchainExtents.height, vk::to_string(m_presentMode));
         try
         {
             m_swapchain = Context::getVulkanDevice().createSwapchainKHRUnique(createInfo);
@@ -132,21 +172,4 @@ namespace Rendering
         }
         spdlog::info("Aquired {} swapchain images", m_swapchainImages.size());
     }
-
-    void Swapchain::createFramebuffers()
-    {
-        spdlog::info("Creating {} framebuffers", m_swapchainImages.size());
-        for (auto& i : m_swapchainImages)
-        {
-            vk::FramebufferCreateInfo createInfo;
-            createInfo.attachmentCount = 1;
-            createInfo.pAttachments = &i.imageView.get();
-            createInfo.width = m_swapchainExtents.width;
-            createInfo.height = m_swapchainExtents.height;
-            createInfo.layers = 1;
-            createInfo.renderPass = m_renderPass.getRenderPass();
-
-            i.framebuffer = Context::getVulkanDevice().createFramebufferUnique(createInfo);
-        }
-    }
 }
@@ -9,35 +9,40 @@
 
 namespace Rendering
 {
-    extern vk::PresentModeKHR defaultPresentMode;
-
     class Device;
     class Window;
-    class Pass;
 
+    // Framebuffers are built by the render graph from the image views, so the swapchain doesn't
+    // need to know about render passes
     class Swapchain
     {
-        friend class Pass;
-
         public:
             struct Image
             {
                 Image(vk::Image image) :
-                    image(image), imageView(nullptr), framebuffer(nullptr)
+                    image(image), imageView(nullptr)
                 {};
 
                 vk::Image image;
                 vk::UniqueImageView imageView;
-                vk::UniqueFramebuffer framebuffer;
             };
 
-            Swapchain(Window& window, Pass& pass);
+            Swapchain(Window& window);
             ~Swapchain();
 
+            // Creates a new swapchain for the current window size, handing the current one over as the
+            // old swapchain so presentation can carry on smoothly
+            // The old swapchain and its images go to the deletion queue until every frame submitted so far
+            // has finished
+            void recreate(Window& window);
+
 
             auto getSurfaceFormat() const {
                 return m_surfaceFormat;
             }
+            auto getPresentMode() const {
+                return m_presentMode;
+            }
             auto getSwapchainExtents() const {
                 return m_swapchainExtents;
             }
@@ -51,19 +56,28 @@ namespace Rendering
         protected:
 
         private:
+            // Swapchain waiting for its last frames to finish before being destroyed
+            struct RetiredSwapchain
+            {
+                RetiredSwapchain() :
+                    swapchain(nullptr)
+                {};
+
+                // Declared first so the image views go before the swapchain
+                vk::UniqueSwapchainKHR swapchain;
+                std::vector<Image> images;
+            };
+
+            vk::PresentModeKHR selectPresentMode() const;
+
             // Initialization steps
-            void createVulkanSwapchain(Window& window);
+            void createVulkanSwapchain(Window& window, vk::SwapchainKHR oldSwapchain = nullptr);
             void aquireSwapchainImages();
-            void createFramebuffers();
 
             vk::SurfaceFormatKHR m_surfaceFormat;
+            vk::PresentModeKHR m_presentMode;
             vk::Extent2D m_swapchainExtents;
             vk::UniqueSwapchainKHR m_swapchain;
             std::vector<Image> m_swapchainImages;
-            
-
-            // Store reference to render pass in case we need to
-            // recreate the swapchain
-            Pass& m_renderPass; 
     };
 }
@@ -0,0 +1,415 @@
+#include "texturefile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    // Headers of the two containers, from the KTX 2.0 specification and the DirectX documentation
+    namespace Ktx2
+    {
+        constexpr std::array<uint8_t, 12> Identifier = {
+            0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+        };
+
+        struct Header
+        {
+            uint32_t vkFormat;
+            uint32_t typeSize;
+            uint32_t pixelWidth;
+            uint32_t pixelHeight;
+            uint32_t pixelDepth;
+            uint32_t layerCount;
+            uint32_t faceCount;
+            uint32_t levelCount;
+            uint32_t supercompressionScheme;
+        };
+
+        // Kept apart from the header, so the 64-bit fields line up with the file
+        struct Index
+        {
+            uint32_t dfdByteOffset;
+            uint32_t dfdByteLength;
+            uint32_t kvdByteOffset;
+            uint32_t kvdByteLength;
+            uint64_t sgdByteOffset;
+            uint64_t sgdByteLength;
+        };
+
+        struct LevelIndex
+        {
+            uint64_t byteOffset;
+            uint64_t byteLength;
+            uint64_t uncompressedByteLength;
+        };
+    }
+
+    namespace Dds
+    {
+        constexpr uint32_t Magic = 0x20534444;
+
+        constexpr uint32_t FlagMipMapCount = 0x20000;
+        constexpr uint32_t PixelFormatFourCC = 0x4;
+        constexpr uint32_t PixelFormatRgb = 0x40;
+        constexpr uint32_t Caps2CubeMap = 0x200;
+        constexpr uint32_t Caps2Volume = 0x200000;
+        constexpr uint32_t MiscTextureCube = 0x4;
+        constexpr uint32_t DimensionTexture2D = 3;
+
+        struct PixelFormat
+        {
+            uint32_t size;
+            uint32_t flags;
+            uint32_t fourCC;
+            uint32_t rgbBitCount;
+            uint32_t rBitMask;
+            uint32_t gBitMask;
+            uint32_t bBitMask;
+            uint32_t aBitMask;
+        };
+
+        struct Header
+        {
+            uint32_t size;
+            uint32_t flags;
+            uint32_t height;
+            uint32_t width;
+            uint32_t pitchOrLinearSize;
+            uint32_t depth;
+            uint32_t mipMapCount;
+            uint32_t reserved1[11];
+            PixelFormat pixelFormat;
+            uint32_t caps;
+            uint32_t caps2;
+            uint32_t caps3;
+            uint32_t caps4;
+            uint32_t reserved2;
+        };
+
+        struct HeaderDx10
+        {
+            uint32_t dxgiFormat;
+            uint32_t resourceDimension;
+            uint32_t miscFlag;
+            uint32_t arraySize;
+            uint32_t miscFlags2;
+        };
+
+        constexpr uint32_t makeFourCC(const char (&code)[5])
+        {
+            return static_cast<uint32_t>(code[0]) | static_cast<uint32_t>(code[1]) << 8 |
+                static_cast<uint32_t>(code[2]) << 16 | static_cast<uint32_t>(code[3]) << 24;
+        }
+
+        static vk::Format getFourCCFormat(uint32_t fourCC)
+        {
+            switch (fourCC)
+            {
+                case makeFourCC("DXT1"): return vk::Format::eBc1RgbaUnormBlock;
+                case makeFourCC("DXT3"): return vk::Format::eBc2UnormBlock;
+                case makeFourCC("DXT5"): return vk::Format::eBc3UnormBlock;
+                case makeFourCC("ATI1"): return vk::Format::eBc4UnormBlock;
+                case makeFourCC("BC4U"): return vk::Format::eBc4UnormBlock;
+                case makeFourCC("ATI2"): return vk::Format::eBc5UnormBlock;
+                case makeFourCC("BC5U"): return vk::Format::eBc5UnormBlock;
+                default: return vk::Format::eUndefined;
+            }
+        }
+
+        static vk::Format getDxgiFormat(uint32_t dxgiFormat)
+        {
+            switch (dxgiFormat)
+            {
+                case 28: return vk::Format::eR8G8B8A8Unorm;
+                case 29: return vk::Format::eR8G8B8A8Srgb;
+                case 71: return vk::Format::eBc1RgbaUnormBlock;
+                case 72: return vk::Format::eBc1RgbaSrgbBlock;
+                case 74: return vk::Format::eBc2UnormBlock;
+                case 75: return vk::Format::eBc2SrgbBlock;
+                case 77: return vk::Format::eBc3UnormBlock;
+                case 78: return vk::Format::eBc3SrgbBlock;
+                case 80: return vk::Format::eBc4UnormBlock;
+                case 81: return vk::Format::eBc4SnormBlock;
+                case 83: return vk::Format::eBc5UnormBlock;
+                case 84: return vk::Format::eBc5SnormBlock;
+                case 87: return vk::Format::eB8G8R8A8Unorm;
+                case 91: return vk::Format::eB8G8R8A8Srgb;
+                case 95: return vk::Format::eBc6HUfloatBlock;
+                case 96: return vk::Format::eBc6HSfloatBlock;
+                case 98: return vk::Format::eBc7UnormBlock;
+                case 99: return vk::Format::eBc7SrgbBlock;
+                default: return vk::Format::eUndefined;
+            }
+        }
+    }
+
+    // Texel block size of the formats we load, which all have block sizes dividing the upload queue's
+    // staging alignment so levels can be packed back to back
+    struct FormatBlock
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t bytes;
+    };
+
+    static std::optional<FormatBlock> getFormatBlock(vk::Format format)
+    {
+        switch (format)
+        {
+            case vk::Format::eR8Unorm:
+            case vk::Format::eR8Srgb:
+                return FormatBlock{1, 1, 1};
+            case vk::Format::eR8G8Unorm:
+            case vk::Format::eR8G8Srgb:
+                return FormatBlock{1, 1, 2};
+            case vk::Format::eR8G8B8A8Unorm:
+            case vk::Format::eR8G8B8A8Srgb:
+            case vk::Format::eB8G8R8A8Unorm:
+            case vk::Format::eB8G8R8A8Srgb:
+                return FormatBlock{1, 1, 4};
+            case vk::Format::eR16G16B16A16Sfloat:
+                return FormatBlock{1, 1, 8};
+            case vk::Format::eR32G32B32A32Sfloat:
+                return FormatBlock{1, 1, 16};
+            case vk::Format::eBc1RgbUnormBlock:
+            case vk::Format::eBc1RgbSrgbBlock:
+            case vk::Format::eBc1RgbaUnormBlock:
+            case vk::Format::eBc1RgbaSrgbBlock:
+            case vk::Format::eBc4UnormBlock:
+            case vk::Format::eBc4SnormBlock:
+                return FormatBlock{4, 4, 8};
+            case vk::Format::eBc2UnormBlock:
+            case vk::Format::eBc2SrgbBlock:
+            case vk::Format::eBc3UnormBlock:
+            case vk::Format::eBc3SrgbBlock:
+            case vk::Format::eBc5UnormBlock:
+            case vk::Format::eBc5SnormBlock:
+            case vk::Format::eBc6HUfloatBlock:
+            case vk::Format::eBc6HSfloatBlock:
+            case vk::Format::eBc7UnormBlock:
+            case vk::Format::eBc7SrgbBlock:
+                return FormatBlock{4, 4, 16};
+            default:
+                return {};
+        }
+    }
+
+    template <typename T>
+    static void readStruct(std::ifstream& file, T& value)
+    {
+        if (!file.read(reinterpret_cast<char*>(&value), sizeof(T)))
+        {
+            throw std::runtime_error("Texture file is truncated");
+        }
+    }
+
+
+    TextureFile::TextureFile(const std::string& path) :
+        m_path(path)
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+        {
+            spdlog::error("Cannot open file \"{}\"", path);
+            throw std::runtime_error("Cannot open file");
+        }
+
+        std::array<uint8_t, 12> identifier = {};
+        file.read(reinterpret_cast<char*>(identifier.data()), identifier.size());
+
+        try
+        {
+            if (identifier == Ktx2::Identifier)
+            {
+                readKtx2(file);
+            }
+            else
+            {
+                uint32_t magic;
+                std::memcpy(&magic, identifier.data(), sizeof(magic));
+                if (magic != Dds::Magic)
+                {
+                    throw std::runtime_error("Texture file is neither KTX2 nor DDS");
+                }
+
+                file.seekg(sizeof(magic));
+                readDds(file);
+            }
+        }
+        catch (const std::runtime_error& exception)
+        {
+            spdlog::error("Cannot load texture \"{}\": {}", path, exception.what());
+            throw;
+        }
+
+        spdlog::info("Loaded texture header for \"{}\": {}x{} {} with {} levels", path, m_levels[0].extent.width,
+            m_levels[0].extent.height, vk::to_string(m_format), m_levels.size());
+    }
+
+
+    std::vector<std::vector<char>> TextureFile::readLevels(uint32_t firstLevel) const
+    {
+        PROFILE_FUNCTION();
+
+        // Every call gets its own stream, so nothing is shared between threads
+        std::ifstream file(m_path, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+        {
+            spdlog::error("Cannot open file \"{}\"", m_path);
+            throw std::runtime_error("Cannot open file");
+        }
+
+        std::vector<std::vector<char>> levels;
+        for (uint32_t i = firstLevel; i < m_levels.size(); i++)
+        {
+            auto& level = m_levels[i];
+            auto& data = levels.emplace_back(static_cast<size_t>(level.size));
+
+            file.seekg(static_cast<std::streamoff>(level.offset));
+            if (!file.read(data.data(), static_cast<std::streamsize>(data.size())))
+            {
+                spdlog::error("Texture \"{}\" is truncated at level {}", m_path, i);
+                throw std::runtime_error("Texture file is truncated");
+            }
+        }
+
+        return levels;
+    }
+
+
+    void TextureFile::readKtx2(std::ifstream& file)
+    {
+        Ktx2::Header header;
+        readStruct(file, header);
+        Ktx2::Index index;
+        readStruct(file, index);
+
+        m_format = static_cast<vk::Format>(header.vkFormat);
+
+        if (header.supercompressionScheme != 0)
+        {
+            throw std::runtime_error("Supercompressed KTX2 files aren't supported");
+        }
+        if (header.pixelHeight == 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+        {
+            throw std::runtime_error("Only single layer 2D textures are supported");
+        }
+
+        // A level count of 0 asks for mips to be generated, which we leave to the file's author
+        auto levelCount = std::max(header.levelCount, 1u);
+        setLevels(vk::Extent2D{header.pixelWidth, header.pixelHeight}, levelCount);
+
+        // The level index lists level 0 first, even though the data is stored smallest level first
+        for (auto& i : m_levels)
+        {
+            Ktx2::LevelIndex levelIndex;
+            readStruct(file, levelIndex);
+
+            if (levelIndex.byteLength != i.size)
+            {
+                throw std::runtime_error("KTX2 level size doesn't match its format and extent");
+            }
+            i.offset = levelIndex.byteOffset;
+        }
+    }
+
+    void TextureFile::readDds(std::ifstream& file)
+    {
+        Dds::Header header;
+        readStruct(file, header);
+
+        if ((header.caps2 & (Dds::Caps2CubeMap | Dds::Caps2Volume)) != 0)
+        {
+            throw std::runtime_error("Only single layer 2D textures are supported");
+        }
+
+        auto& pixelFormat = header.pixelFormat;
+        if ((pixelFormat.flags & Dds::PixelFormatFourCC) != 0 && pixelFormat.fourCC == Dds::makeFourCC("DX10"))
+        {
+            Dds::HeaderDx10 headerDx10;
+            readStruct(file, headerDx10);
+
+            if (headerDx10.resourceDimension != Dds::DimensionTexture2D || headerDx10.arraySize > 1 ||
+                (headerDx10.miscFlag & Dds::MiscTextureCube) != 0)
+            {
+                throw std::runtime_error("Only single layer 2D textures are supported");
+            }
+            m_format = Dds::getDxgiFormat(headerDx10.dxgiFormat);
+        }
+        else if ((pixelFormat.flags & Dds::PixelFormatFourCC) != 0)
+        {
+            m_format = Dds::getFourCCFormat(pixelFormat.fourCC);
+        }
+        else if ((pixelFormat.flags & Dds::PixelFormatRgb) != 0 && pixelFormat.rgbBitCount == 32 &&
+            pixelFormat.gBitMask == 0x0000ff00)
+        {
+            if (pixelFormat.rBitMask == 0x000000ff && pixelFormat.bBitMask == 0x00ff0000)
+            {
+                m_format = vk::Format::eR8G8B8A8Unorm;
+            }
+            else if (pixelFormat.rBitMask == 0x00ff0000 && pixelFormat.bBitMask == 0x000000ff)
+            {
+                m_format = vk::Format::eB8G8R8A8Unorm;
+            }
+        }
+
+        auto levelCount = (header.flags & Dds::FlagMipMapCount) != 0 ? std::max(header.mipMapCount, 1u) : 1u;
+        setLevels(vk::Extent2D{header.width, header.height}, levelCount);
+
+        // Levels follow the headers back to back, largest first
+        uint64_t offset = static_cast<uint64_t>(file.tellg());
+        for (auto& i : m_levels)
+        {
+            i.offset = offset;
+            offset += i.size;
+        }
+    }
+
+    void TextureFile::setLevels(vk::Extent2D extent, uint32_t levelCount)
+    {
+        auto block = getFormatBlock(m_format);
+        if (!block.has_value())
+        {
+            spdlog::error("Unsupported texture format {}", vk::to_string(m_format));
+            throw std::runtime_error("Unsupported texture format");
+        }
+
+        if (extent.width == 0 || extent.height == 0)
+        {
+            throw std::runtime_error("Texture has no texels");
+        }
+
+        // Anything past the 1x1 level isn't a real level
+        uint32_t maxLevelCount = 1;
+        while (std::max(extent.width, extent.height) >> maxLevelCount != 0)
+        {
+            maxLevelCount++;
+        }
+        if (levelCount > maxLevelCount)
+        {
+            throw std::runtime_error("Texture has more levels than its size allows");
+        }
+
+        m_levels.clear();
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            auto width = std::max(extent.width >> i, 1u);
+            auto height = std::max(extent.height >> i, 1u);
+
+            Level level;
+            level.offset = 0;
+            level.size = static_cast<uint64_t>((width + block->width - 1) / block->width) *
+                ((height + block->height - 1) / block->height) * block->bytes;
+            level.extent = vk::Extent3D{width, height, 1};
+            m_levels.push_back(level);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Rendering
+{
+    // Mip chain of a 2D texture stored in a KTX2 or DDS file
+    // Only the header is read up front, and levels are read from disk as they're needed, so the file
+    // can be streamed in a few levels at a time
+    // Throws if the file isn't a single layer 2D texture in a format we can upload as is, like
+    // cube maps, arrays or supercompressed KTX2 files
+    class TextureFile
+    {
+        public:
+            struct Level
+            {
+                // Where the tightly packed level data starts in the file
+                uint64_t offset;
+                uint64_t size;
+                vk::Extent3D extent;
+            };
+
+            TextureFile(const std::string& path);
+
+            // Reads levels [firstLevel, getLevelCount()) in one go, one buffer per level
+            // Safe to call from several threads at once
+            std::vector<std::vector<char>> readLevels(uint32_t firstLevel) const;
+
+            const std::string& getPath() const {
+                return m_path;
+            }
+            vk::Format getFormat() const {
+                return m_format;
+            }
+            uint32_t getLevelCount() const {
+                return static_cast<uint32_t>(m_levels.size());
+            }
+            // Level 0 is the largest
+            const Level& getLevel(uint32_t level) const {
+                return m_levels[level];
+            }
+
+        private:
+            // Header parsing for each container
+            void readKtx2(std::ifstream& file);
+            void readDds(std::ifstream& file);
+
+            // Fills out the size and extent of every level from the format and the size of level 0
+            void setLevels(vk::Extent2D extent, uint32_t levelCount);
+
+            std::string m_path;
+            vk::Format m_format = vk::Format::eUndefined;
+            std::vector<Level> m_levels;
+    };
+}
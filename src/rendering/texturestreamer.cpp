@@ -0,0 +1,419 @@
+#include "texturestreamer.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "upload.hpp"
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    TextureStreamer::ResidentImage::~ResidentImage()
+    {
+        if (bindlessIndex != UINT32_MAX)
+        {
+            Context::getBindlessTable()->removeTexture(bindlessIndex);
+        }
+    }
+
+
+    TextureStreamer::TextureStreamer(UploadQueue& uploadQueue, Util::JobSystem& jobSystem, vk::DeviceSize budget) :
+        m_uploadQueue(uploadQueue), m_jobSystem(jobSystem), m_budget(budget), m_sampler(nullptr)
+    {
+        if (m_budget == 0)
+        {
+            auto properties = Context::get().getDevice().getProperties();
+            auto& memoryProperties = properties.getMemoryProperties();
+
+            vk::DeviceSize largestHeap = 0;
+            for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+            {
+                auto& heap = memoryProperties.memoryHeaps[i];
+                if (heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+                {
+                    largestHeap = std::max(largestHeap, heap.size);
+                }
+            }
+            m_budget = largestHeap / 4;
+        }
+
+        spdlog::info("Creating texture streamer with a {} MiB budget", m_budget / (1024 * 1024));
+
+        // Trilinear filtering across whatever levels are resident
+        vk::SamplerCreateInfo samplerInfo;
+        samplerInfo.magFilter = vk::Filter::eLinear;
+        samplerInfo.minFilter = vk::Filter::eLinear;
+        samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+        samplerInfo.addressModeU = vk::SamplerAddressMode::eRepeat;
+        samplerInfo.addressModeV = vk::SamplerAddressMode::eRepeat;
+        samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+        m_sampler = Context::getVulkanDevice().createSamplerUnique(samplerInfo);
+    }
+
+    TextureStreamer::~TextureStreamer()
+    {
+        spdlog::info("Waiting for {} texture loads to finish", m_pendingLoadCount.load());
+        m_jobSystem.wait(m_loadCounter);
+
+        // The last frames may still be sampling the images
+        for (auto& i : m_textures)
+        {
+            if (i.resident)
+            {
+                Context::getDeletionQueue().retire(std::move(i.resident));
+            }
+        }
+    }
+
+
+    TextureStreamer::Handle TextureStreamer::load(const std::string& path)
+    {
+        PROFILE_FUNCTION();
+
+        Texture texture{TextureFile(path)};
+        auto& file = texture.file;
+
+        auto properties = Context::get().getDevice().getProperties();
+        auto formatFeatures = properties.getPhysicalDevice().getFormatProperties(file.getFormat()).optimalTilingFeatures;
+        if (!(formatFeatures & vk::FormatFeatureFlagBits::eSampledImage) ||
+            !(formatFeatures & vk::FormatFeatureFlagBits::eTransferDst))
+        {
+            spdlog::error("Texture \"{}\" has format {}, which the device can't sample", path,
+                vk::to_string(file.getFormat()));
+            throw std::runtime_error("Texture format isn't supported by the device");
+        }
+
+        // The tail is the first level small enough to always keep around
+        auto lastLevel = file.getLevelCount() - 1;
+        texture.tailLevel = lastLevel;
+        for (uint32_t i = 0; i < lastLevel; i++)
+        {
+            auto& extent = file.getLevel(i).extent;
+            if (std::max(extent.width, extent.height) <= TailSize)
+            {
+                texture.tailLevel = i;
+                break;
+            }
+        }
+
+        // Each chain is uploaded in one go, so it has to fit in staging memory along with its padding
+        auto stagingSize = m_uploadQueue.getStagingSize();
+        auto fitsInStaging = [&](uint32_t firstLevel) {
+            auto padding = (file.getLevelCount() - firstLevel) * UploadQueue::getStagingAlignment();
+            return getChainSize(file, firstLevel) + padding <= stagingSize;
+        };
+
+        texture.minLevel = 0;
+        while (texture.minLevel < lastLevel && !fitsInStaging(texture.minLevel))
+        {
+            texture.minLevel++;
+        }
+        if (!fitsInStaging(texture.minLevel))
+        {
+            spdlog::error("Texture \"{}\" doesn't fit in {} bytes of staging memory", path, stagingSize);
+            throw std::runtime_error("Texture doesn't fit in staging memory");
+        }
+        texture.tailLevel = std::max(texture.tailLevel, texture.minLevel);
+
+        // Upload the tail right away so there's something to draw with
+        texture.resident = createResidentImage(file, texture.tailLevel, file.readLevels(texture.tailLevel));
+        texture.residentLevel = texture.tailLevel;
+        texture.targetLevel = texture.tailLevel;
+        m_residentSize += texture.resident->memory.getSize();
+
+        m_textures.push_back(std::move(texture));
+        return Handle{static_cast<uint32_t>(m_textures.size() - 1)};
+    }
+
+    void TextureStreamer::requestSize(Handle texture, float screenSize)
+    {
+        auto& i = m_textures[texture.index];
+
+        // The first request since the last update replaces the old size
+        if (i.lastRequest != m_updateCount)
+        {
+            i.requestedSize = 0.0f;
+        }
+        i.requestedSize = std::max(i.requestedSize, screenSize);
+        i.lastRequest = m_updateCount;
+    }
+
+    void TextureStreamer::update()
+    {
+        PROFILE_FUNCTION();
+
+        applyFinishedLoads();
+        planResidency();
+        startLoads();
+
+        m_updateCount++;
+    }
+
+
+    uint32_t TextureStreamer::getBindlessIndex(Handle texture) const
+    {
+        return m_textures[texture.index].resident->bindlessIndex;
+    }
+
+    void TextureStreamer::applyFinishedLoads()
+    {
+        std::vector<FinishedLoad> loads;
+        {
+            std::lock_guard<std::mutex> lock(m_finishedMutex);
+            std::swap(loads, m_finishedLoads);
+        }
+
+        if (loads.empty())
+        {
+            return;
+        }
+
+        PROFILE_SCOPE("apply texture loads");
+
+        // Uploading more than the staging ring holds in one frame would stall on the transfer queue,
+        // so anything past half of it waits for the next update
+        auto uploadLimit = m_uploadQueue.getStagingSize() / 2;
+        vk::DeviceSize uploadedSize = 0;
+
+        size_t applied = 0;
+        for (; applied < loads.size(); applied++)
+        {
+            auto& load = loads[applied];
+            auto& texture = m_textures[load.texture];
+
+            // The target may have moved while the load ran, so only swap in loads that get the texture
+            // closer to it, rather than rebuilding the image for nothing
+            auto distance = [](uint32_t a, uint32_t b) {
+                return a > b ? a - b : b - a;
+            };
+            bool isUseful = distance(load.firstLevel, texture.targetLevel) <
+                distance(texture.residentLevel, texture.targetLevel);
+
+            if (load.levels.empty())
+            {
+                spdlog::warn("Stopped streaming texture \"{}\" after it failed to load", texture.file.getPath());
+                texture.hasFailed = true;
+            }
+            else if (isUseful)
+            {
+                auto size = getChainSize(texture.file, load.firstLevel);
+                if (uploadedSize != 0 && uploadedSize + size > uploadLimit)
+                {
+                    break;
+                }
+                uploadedSize += size;
+
+                auto resident = createResidentImage(texture.file, load.firstLevel, load.levels);
+
+                // Recorded frames may still be sampling the old image
+                m_residentSize -= texture.resident->memory.getSize();
+                Context::getDeletionQueue().retire(std::move(texture.resident));
+
+                texture.resident = std::move(resident);
+                texture.residentLevel = load.firstLevel;
+                m_residentSize += texture.resident->memory.getSize();
+            }
+
+            texture.isLoading = false;
+            m_pendingLoadCount--;
+        }
+
+        if (applied < loads.size())
+        {
+            std::lock_guard<std::mutex> lock(m_finishedMutex);
+            m_finishedLoads.insert(m_finishedLoads.begin(), std::make_move_iterator(loads.begin() + applied),
+                std::make_move_iterator(loads.end()));
+        }
+    }
+
+    void TextureStreamer::planResidency()
+    {
+        // Start with the smallest level that still covers each texture's size on screen
+        vk::DeviceSize totalSize = 0;
+        for (auto& i : m_textures)
+        {
+            i.targetLevel = i.tailLevel;
+
+            bool isStale = i.requestedSize <= 0.0f || m_updateCount - i.lastRequest > StaleUpdates;
+            if (!isStale)
+            {
+                auto& extent = i.file.getLevel(0).extent;
+                auto levelSize = static_cast<float>(std::max(extent.width, extent.height));
+
+                i.targetLevel = 0;
+                while (i.targetLevel < i.tailLevel && levelSize / 2.0f >= i.requestedSize)
+                {
+                    levelSize /= 2.0f;
+                    i.targetLevel++;
+                }
+                i.targetLevel = std::max(i.targetLevel, i.minLevel);
+            }
+
+            totalSize += getChainSize(i.file, i.targetLevel);
+        }
+
+        if (totalSize <= m_budget)
+        {
+            return;
+        }
+
+        // Over budget, so keep dropping whichever top level is magnified the least on screen
+        using Candidate = std::pair<float, uint32_t>;
+        auto getScreenRatio = [&](const Texture& texture) {
+            auto& extent = texture.file.getLevel(texture.targetLevel).extent;
+            return texture.requestedSize / static_cast<float>(std::max(extent.width, extent.height));
+        };
+
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+        for (uint32_t i = 0; i < m_textures.size(); i++)
+        {
+            if (m_textures[i].targetLevel < m_textures[i].tailLevel)
+            {
+                candidates.emplace(getScreenRatio(m_textures[i]), i);
+            }
+        }
+
+        while (totalSize > m_budget && !candidates.empty())
+        {
+            auto& texture = m_textures[candidates.top().second];
+            candidates.pop();
+
+            totalSize -= texture.file.getLevel(texture.targetLevel).size;
+            texture.targetLevel++;
+
+            if (texture.targetLevel < texture.tailLevel)
+            {
+                candidates.emplace(getScreenRatio(texture), static_cast<uint32_t>(&texture - m_textures.data()));
+            }
+        }
+    }
+
+    void TextureStreamer::startLoads()
+    {
+        std::vector<uint32_t> loads;
+        for (uint32_t i = 0; i < m_textures.size(); i++)
+        {
+            auto& texture = m_textures[i];
+            if (texture.targetLevel != texture.residentLevel && !texture.isLoading && !texture.hasFailed)
+            {
+                loads.push_back(i);
+            }
+        }
+
+        // Shrinking textures go first to make room, then the ones covering the most of the screen
+        std::sort(loads.begin(), loads.end(), [&](uint32_t a, uint32_t b) {
+            auto& textureA = m_textures[a];
+            auto& textureB = m_textures[b];
+            bool isShrinkingA = textureA.targetLevel > textureA.residentLevel;
+            bool isShrinkingB = textureB.targetLevel > textureB.residentLevel;
+            if (isShrinkingA != isShrinkingB)
+            {
+                return isShrinkingA;
+            }
+            return textureA.requestedSize > textureB.requestedSize;
+        });
+
+        for (auto i : loads)
+        {
+            if (m_pendingLoadCount >= MaxPendingLoads)
+            {
+                break;
+            }
+
+            auto& texture = m_textures[i];
+            texture.isLoading = true;
+            m_pendingLoadCount++;
+
+            // The worker gets its own copy of the header, so textures can be added while it runs
+            m_jobSystem.run([this, i, file = texture.file, firstLevel = texture.targetLevel]() {
+                FinishedLoad load{i, firstLevel, {}};
+                try
+                {
+                    load.levels = file.readLevels(firstLevel);
+                }
+                catch (const std::exception& exception)
+                {
+                    // Handed back empty, so the update can give up on the texture
+                    spdlog::error("Failed to stream texture \"{}\": {}", file.getPath(), exception.what());
+                }
+
+                std::lock_guard<std::mutex> lock(m_finishedMutex);
+                m_finishedLoads.push_back(std::move(load));
+            }, &m_loadCounter);
+        }
+    }
+
+
+    std::unique_ptr<TextureStreamer::ResidentImage> TextureStreamer::createResidentImage(const TextureFile& file,
+        uint32_t firstLevel, const std::vector<std::vector<char>>& levels)
+    {
+        PROFILE_FUNCTION();
+
+        auto& device = Context::getVulkanDevice();
+        auto levelCount = file.getLevelCount() - firstLevel;
+
+        auto resident = std::make_unique<ResidentImage>();
+
+        // Only ever written by the upload queue, which hands it over to the graphics queue family
+        vk::ImageCreateInfo createInfo;
+        createInfo.imageType = vk::ImageType::e2D;
+        createInfo.format = file.getFormat();
+        createInfo.extent = file.getLevel(firstLevel).extent;
+        createInfo.mipLevels = levelCount;
+        createInfo.arrayLayers = 1;
+        createInfo.samples = vk::SampleCountFlagBits::e1;
+        createInfo.tiling = vk::ImageTiling::eOptimal;
+        createInfo.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+        createInfo.sharingMode = vk::SharingMode::eExclusive;
+        createInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+        resident->image = device.createImageUnique(createInfo);
+        resident->memory = Context::getAllocator().allocateForImage(*resident->image,
+            {vk::MemoryPropertyFlagBits::eDeviceLocal});
+
+        vk::ImageViewCreateInfo viewInfo;
+        viewInfo.image = *resident->image;
+        viewInfo.viewType = vk::ImageViewType::e2D;
+        viewInfo.format = file.getFormat();
+        viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+        viewInfo.subresourceRange.levelCount = levelCount;
+
+        resident->imageView = device.createImageViewUnique(viewInfo);
+
+        std::vector<UploadQueue::ImageLevel> uploads;
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            uploads.push_back({levels[i].data(), levels[i].size(), file.getLevel(firstLevel + i).extent});
+        }
+        m_uploadQueue.uploadImage(*resident->image, uploads, vk::PipelineStageFlagBits::eFragmentShader,
+            vk::AccessFlagBits::eShaderRead);
+
+        if (auto bindlessTable = Context::getBindlessTable())
+        {
+            resident->bindlessIndex = bindlessTable->addTexture(*resident->imageView, *m_sampler);
+        }
+
+        return resident;
+    }
+
+    vk::DeviceSize TextureStreamer::getChainSize(const TextureFile& file, uint32_t firstLevel) const
+    {
+        vk::DeviceSize size = 0;
+        for (uint32_t i = firstLevel; i < file.getLevelCount(); i++)
+        {
+            size += file.getLevel(i).size;
+        }
+        return size;
+    }
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "memory.hpp"
+#include "texturefile.hpp"
+#include "util/jobsystem.hpp"
+
+namespace Rendering
+{
+    class UploadQueue;
+
+    // Keeps a range of each texture's mip chain resident, from the smallest levels up to whatever its
+    // on-screen size needs, while staying under a memory budget
+    // Loading a texture uploads its small tail levels right away so it can be drawn on the first frame,
+    // and the bigger levels are read from disk on worker threads and uploaded over later frames
+    // When the textures want more than the budget, the levels that add the least on screen are dropped
+    // first
+    // Without sparse residency, changing what's resident builds a new image for the new range and
+    // retires the old one once the GPU is done with it
+    class TextureStreamer
+    {
+        public:
+            struct Handle
+            {
+                uint32_t index = UINT32_MAX;
+            };
+
+            // Levels at or below this size are always resident
+            static constexpr uint32_t TailSize = 64;
+
+            // Most loads running on worker threads at once
+            static constexpr size_t MaxPendingLoads = 4;
+
+            // Textures that haven't been requested for this many updates fall back to their tail
+            static constexpr uint64_t StaleUpdates = 60;
+
+            // A budget of 0 picks a quarter of the largest device local heap
+            TextureStreamer(UploadQueue& uploadQueue, Util::JobSystem& jobSystem, vk::DeviceSize budget = 0);
+            // Waits for loads in flight, and hands resident images to the deletion queue
+            ~TextureStreamer();
+
+            TextureStreamer(const TextureStreamer&) = delete;
+            TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+            // Reads the header and uploads the tail levels before returning
+            // Throws if the file can't be loaded
+            Handle load(const std::string& path);
+
+            // Records how many pixels the texture covers along its longest side this frame, keeping the
+            // largest size requested since the last update
+            void requestSize(Handle texture, float screenSize);
+
+            // Swaps in finished loads, works out what should be resident and starts loads for the rest
+            // Called once a frame before the upload queue is flushed, from the thread that records frames
+            void update();
+
+            // Index of the texture in the bindless table, or UINT32_MAX without one
+            // It changes whenever the texture's resident levels do, so it should be looked up every frame
+            uint32_t getBindlessIndex(Handle texture) const;
+
+            size_t getTextureCount() const {
+                return m_textures.size();
+            }
+            // Memory taken by resident images
+            vk::DeviceSize getResidentSize() const {
+                return m_residentSize;
+            }
+            vk::DeviceSize getBudget() const {
+                return m_budget;
+            }
+            size_t getPendingLoadCount() const {
+                return m_pendingLoadCount;
+            }
+
+        private:
+            // Image holding levels [firstLevel, levelCount) of the file, with level firstLevel as mip 0
+            struct ResidentImage
+            {
+                ResidentImage() :
+                    image(nullptr), imageView(nullptr)
+                {};
+                // Gives the bindless slot back
+                ~ResidentImage();
+
+                // Memory is declared first so it outlives the image bound to it
+                MemoryAllocation memory;
+                vk::UniqueImage image;
+                vk::UniqueImageView imageView;
+                uint32_t bindlessIndex = UINT32_MAX;
+            };
+
+            struct Texture
+            {
+                TextureFile file;
+                std::unique_ptr<ResidentImage> resident;
+                uint32_t residentLevel = 0;
+                // Smallest level that's always resident
+                uint32_t tailLevel = 0;
+                // Largest level whose chain still fits in staging memory
+                uint32_t minLevel = 0;
+                uint32_t targetLevel = 0;
+                bool isLoading = false;
+                // Set when reading the file fails, which stops any more loads
+                bool hasFailed = false;
+
+                float requestedSize = 0.0f;
+                uint64_t lastRequest = 0;
+            };
+
+            // Levels read by a worker, waiting to be uploaded on the next update
+            struct FinishedLoad
+            {
+                uint32_t texture;
+                uint32_t firstLevel;
+                std::vector<std::vector<char>> levels;
+            };
+
+            // Update steps
+            void applyFinishedLoads();
+            void planResidency();
+            void startLoads();
+
+            std::unique_ptr<ResidentImage> createResidentImage(const TextureFile& file, uint32_t firstLevel,
+                const std::vector<std::vector<char>>& levels);
+            vk::DeviceSize getChainSize(const TextureFile& file, uint32_t firstLevel) const;
+
+            UploadQueue& m_uploadQueue;
+            Util::JobSystem& m_jobSystem;
+            vk::DeviceSize m_budget;
+            vk::UniqueSampler m_sampler;
+
+            std::vector<Texture> m_textures;
+            vk::DeviceSize m_residentSize = 0;
+            uint64_t m_updateCount = 0;
+
+            // Filled out by workers
+            std::mutex m_finishedMutex;
+            std::vector<FinishedLoad> m_finishedLoads;
+            std::atomic<size_t> m_pendingLoadCount{0};
+            Util::JobSystem::Counter m_loadCounter;
+    };
+}
@@ -0,0 +1,111 @@
+#include "timeline.hpp"
+
+#include <limits>
+
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    void SemaphoreWaits::add(vk::Semaphore semaphore, uint64_t value, vk::PipelineStageFlags stages)
+    {
+        semaphores.push_back(semaphore);
+        values.push_back(value);
+        stageMasks.push_back(stages);
+    }
+
+    void SemaphoreWaits::add(const Timeline& timeline, uint64_t value, vk::PipelineStageFlags stages)
+    {
+        add(timeline.getSemaphore(), value, stages);
+    }
+
+
+
+    Timeline::Timeline(const vk::Device& device, const vk::Queue& queue) :
+        m_device(device), m_queue(queue), m_semaphore(nullptr)
+    {
+        vk::SemaphoreTypeCreateInfo typeInfo;
+        typeInfo.semaphoreType = vk::SemaphoreType::eTimeline;
+        typeInfo.initialValue = 0;
+
+        vk::SemaphoreCreateInfo createInfo;
+        createInfo.pNext = &typeInfo;
+        m_semaphore = m_device.createSemaphoreUnique(createInfo);
+    }
+
+
+    uint64_t Timeline::submit(const std::vector<vk::CommandBuffer>& commandBuffers, const SemaphoreWaits& waits,
+        const std::vector<vk::Semaphore>& binarySignals)
+    {
+        auto value = m_submittedValue + 1;
+
+        // Binary semaphores ignore their values, but every semaphore needs one
+        std::vector<vk::Semaphore> signalSemaphores = binarySignals;
+        std::vector<uint64_t> signalValues(binarySignals.size(), 0);
+        signalSemaphores.push_back(*m_semaphore);
+        signalValues.push_back(value);
+
+        vk::TimelineSemaphoreSubmitInfo timelineInfo;
+        timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waits.values.size());
+        timelineInfo.pWaitSemaphoreValues = waits.values.data();
+        timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+        vk::SubmitInfo submitInfo;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waits.semaphores.size());
+        submitInfo.pWaitSemaphores = waits.semaphores.data();
+        submitInfo.pWaitDstStageMask = waits.stageMasks.data();
+        submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+        submitInfo.pCommandBuffers = commandBuffers.data();
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+        m_queue.submit({submitInfo}, nullptr);
+
+        // Only counted once the submission has gone through, so a failed one is never waited on
+        m_submittedValue = value;
+        return value;
+    }
+
+    uint64_t Timeline::getCompletedValue()
+    {
+        auto value = m_device.getSemaphoreCounterValue(*m_semaphore);
+        updateCompletedValue(value);
+        return value;
+    }
+
+    bool Timeline::getIsComplete(uint64_t value)
+    {
+        return value <= m_completedValue || value <= getCompletedValue();
+    }
+
+    void Timeline::wait(uint64_t value)
+    {
+        if (getIsComplete(value))
+        {
+            return;
+        }
+
+        PROFILE_FUNCTION();
+
+        vk::SemaphoreWaitInfo waitInfo;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &(*m_semaphore);
+        waitInfo.pValues = &value;
+
+        auto result = m_device.waitSemaphores(waitInfo, std::numeric_limits<uint64_t>::max());
+        if (result == vk::Result::eSuccess)
+        {
+            updateCompletedValue(value);
+        }
+    }
+
+
+    void Timeline::updateCompletedValue(uint64_t value)
+    {
+        auto completedValue = m_completedValue.load();
+        while (completedValue < value && !m_completedValue.compare_exchange_weak(completedValue, value))
+        {
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Rendering
+{
+    class Timeline;
+
+    // Semaphores a submission waits on, with the value to wait for on timeline semaphores and 0 on
+    // binary ones like swapchain acquires
+    struct SemaphoreWaits
+    {
+        std::vector<vk::Semaphore> semaphores;
+        std::vector<uint64_t> values;
+        std::vector<vk::PipelineStageFlags> stageMasks;
+
+        void add(vk::Semaphore semaphore, uint64_t value, vk::PipelineStageFlags stages);
+        void add(const Timeline& timeline, uint64_t value, vk::PipelineStageFlags stages);
+    };
+
+    // Counts the work submitted to a queue on a timeline semaphore, which every submission through it
+    // signals with the next value
+    // Submissions finish in order, so a single number tells how far along the queue is, and anything a
+    // submission uses can be waited on or released by the value it signals, without fences to track
+    // Submitting needs the queue to be externally synchronized, but values can be checked from any thread
+    class Timeline
+    {
+        public:
+            Timeline(const vk::Device& device, const vk::Queue& queue);
+
+            Timeline(const Timeline&) = delete;
+            Timeline& operator=(const Timeline&) = delete;
+
+            // Submits the command buffers after the waits, returning the value signalled once they're done
+            // Binary semaphores are signalled along with it, like for presentation
+            uint64_t submit(const std::vector<vk::CommandBuffer>& commandBuffers, const SemaphoreWaits& waits = {},
+                const std::vector<vk::Semaphore>& binarySignals = {});
+
+            // Value signalled by the last submission
+            uint64_t getSubmittedValue() const {
+                return m_submittedValue;
+            }
+            // Queries the semaphore for the last value the GPU signalled
+            uint64_t getCompletedValue();
+            // Only queries the semaphore when the last known value doesn't already cover the one asked for
+            bool getIsComplete(uint64_t value);
+
+            // Blocks until the value has been signalled, which is right away for values already complete
+            void wait(uint64_t value);
+
+            const vk::Semaphore& getSemaphore() const {
+                return *m_semaphore;
+            }
+
+        private:
+            // Raises the cached completed value, never lowering it when another thread stored a newer one
+            void updateCompletedValue(uint64_t value);
+
+            vk::Device m_device;
+            vk::Queue m_queue;
+            vk::UniqueSemaphore m_semaphore;
+
+            std::atomic<uint64_t> m_submittedValue = 0;
+            std::atomic<uint64_t> m_completedValue = 0;
+    };
+}
@@ -0,0 +1,41 @@
+#include "uniformallocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+
+namespace Rendering
+{
+    UniformAllocator::UniformAllocator(vk::DeviceSize size, vk::BufferUsageFlags extraUsage) :
+        // Device local memory the CPU can write to directly is best, when the device has any
+        m_buffer(size, vk::BufferUsageFlagBits::eUniformBuffer | extraUsage, MemoryAllocator::AllocationInfo(
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            vk::MemoryPropertyFlagBits::eDeviceLocal)),
+        m_alignment(std::max<vk::DeviceSize>(Context::get().getDevice().getProperties().getDeviceProperties()
+            .limits.minUniformBufferOffsetAlignment, 16))
+    {
+        if (m_buffer.getMappedData() == nullptr)
+        {
+            throw std::runtime_error("Uniform buffer memory isn't mapped");
+        }
+    }
+
+
+    UniformAllocator::Allocation UniformAllocator::allocate(vk::DeviceSize size)
+    {
+        // The alignment is always a power of two
+        auto alignedSize = (size + m_alignment - 1) & ~(m_alignment - 1);
+        auto offset = m_offset.fetch_add(alignedSize);
+
+        if (offset + size > m_buffer.getSize())
+        {
+            spdlog::error("Uniform allocator ran out of space allocating {} bytes", size);
+            throw std::runtime_error("Uniform allocator out of space");
+        }
+
+        return {static_cast<char*>(m_buffer.getMappedData()) + offset, static_cast<uint32_t>(offset)};
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <vulkan/vulkan.hpp>
+
+#include "buffer.hpp"
+
+namespace Rendering
+{
+    // Linear allocator for uniform data that only lives for a single frame
+    // Backed by one persistently mapped, host coherent buffer, so handing out space is an atomic
+    // pointer bump that any recording thread can do, and the results are bound with dynamic offsets
+    // Each frame in flight needs its own allocator, reset once that frame has been waited on
+    class UniformAllocator
+    {
+        public:
+            // Space handed out for one allocation
+            struct Allocation
+            {
+                void* data;
+                // Dynamic offset to bind the allocation with
+                uint32_t offset;
+            };
+
+            // Extra usage lets the same buffer be read as a storage buffer too, like through a bindless table
+            UniformAllocator(vk::DeviceSize size = 4 * 1024 * 1024, vk::BufferUsageFlags extraUsage = {});
+
+            UniformAllocator(const UniformAllocator&) = delete;
+            UniformAllocator& operator=(const UniformAllocator&) = delete;
+
+            // Frees everything at once - the GPU must be done with the previous frame's data
+            void reset() {
+                m_offset = 0;
+            }
+
+            // Aligned to minUniformBufferOffsetAlignment and at least 16 bytes, so offsets can also index
+            // an array of vec4s, throwing if the buffer is out of space
+            Allocation allocate(vk::DeviceSize size);
+
+            // Copies the value into a new allocation, returning its dynamic offset
+            template <typename T>
+            uint32_t push(const T& value)
+            {
+                static_assert(std::is_trivially_copyable_v<T>, "Uniform data must be trivially copyable");
+
+                auto allocation = allocate(sizeof(T));
+                std::memcpy(allocation.data, &value, sizeof(T));
+                return allocation.offset;
+            }
+
+            const vk::Buffer& getBuffer() const {
+                return m_buffer.getBuffer();
+            }
+            vk::DeviceSize getUsedSize() const {
+                return m_offset;
+            }
+
+        private:
+            Buffer m_buffer;
+            vk::DeviceSize m_alignment;
+            std::atomic<vk::DeviceSize> m_offset = 0;
+    };
+}
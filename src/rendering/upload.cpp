@@ -0,0 +1,418 @@
+#include "upload.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "context.hpp"
+#include "util/profiler.hpp"
+
+namespace Rendering
+{
+    // Staging allocations are kept aligned for any kind of copy
+    static const vk::DeviceSize stagingAlignment = 16;
+
+    static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+
+
+    UploadQueue::UploadQueue(vk::DeviceSize stagingSize)
+    {
+        auto properties = Context::get().getDevice().getProperties();
+        m_transferQueueFamily = properties.getTransferQueue();
+        m_graphicsQueueFamily = properties.getGraphicsQueue();
+
+        vk::CommandPoolCreateInfo poolInfo;
+        poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+        poolInfo.queueFamilyIndex = m_transferQueueFamily;
+
+        spdlog::info("Creating upload queue with {} MiB of staging memory on queue family {}",
+            stagingSize / (1024 * 1024), m_transferQueueFamily);
+        m_commandPool = Context::getVulkanDevice().createCommandPoolUnique(poolInfo);
+
+        // Staging memory is written by the CPU and only ever read by copies
+        MemoryAllocator::AllocationInfo stagingMemory(
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        stagingMemory.dedicated = true;
+        m_stagingBuffer.emplace(stagingSize, vk::BufferUsageFlagBits::eTransferSrc, stagingMemory);
+    }
+
+    UploadQueue::~UploadQueue()
+    {
+        spdlog::info("Waiting for uploads to finish");
+        if (!m_submissions.empty())
+        {
+            Context::get().getDevice().getTransferTimeline().wait(m_submissions.back()->timelineValue);
+        }
+    }
+
+
+    void UploadQueue::uploadBuffer(const Buffer& destination, vk::DeviceSize destinationOffset,
+        const void* data, vk::DeviceSize size,
+        vk::PipelineStageFlags destinationStage, vk::AccessFlags destinationAccess)
+    {
+        PROFILE_FUNCTION();
+
+        // Break big uploads up into chunks so they always fit in the ring
+        auto chunkSize = m_stagingBuffer->getSize() / 4;
+
+        for (vk::DeviceSize uploaded = 0; uploaded < size; uploaded += chunkSize)
+        {
+            auto copySize = std::min(chunkSize, size - uploaded);
+            auto stagingOffset = allocateStaging(copySize);
+
+            std::memcpy(static_cast<char*>(m_stagingBuffer->getMappedData()) + stagingOffset,
+                static_cast<const char*>(data) + uploaded, static_cast<size_t>(copySize));
+
+            m_pendingCopies.push_back(Copy{
+                destination.getBuffer(),
+                destination.getIsConcurrent(),
+                vk::BufferCopy{stagingOffset, destinationOffset + uploaded, copySize},
+                destinationStage,
+                destinationAccess
+            });
+        }
+    }
+
+    void UploadQueue::uploadImage(const vk::Image& destination, const std::vector<ImageLevel>& levels,
+        vk::PipelineStageFlags destinationStage, vk::AccessFlags destinationAccess)
+    {
+        PROFILE_FUNCTION();
+
+        std::vector<vk::DeviceSize> levelOffsets;
+        vk::DeviceSize totalSize = 0;
+        for (auto& i : levels)
+        {
+            totalSize = alignUp(totalSize, stagingAlignment);
+            levelOffsets.push_back(totalSize);
+            totalSize += i.size;
+        }
+
+        // Waiting for space would never finish
+        if (totalSize > m_stagingBuffer->getSize())
+        {
+            spdlog::error("Image upload of {} bytes doesn't fit in {} bytes of staging memory", totalSize,
+                m_stagingBuffer->getSize());
+            throw std::runtime_error("Image upload doesn't fit in staging memory");
+        }
+
+        auto stagingOffset = allocateStaging(totalSize);
+
+        Copy copy{};
+        copy.stage = destinationStage;
+        copy.access = destinationAccess;
+        copy.image = destination;
+        copy.mipCount = static_cast<uint32_t>(levels.size());
+
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+            auto offset = stagingOffset + levelOffsets[i];
+            std::memcpy(static_cast<char*>(m_stagingBuffer->getMappedData()) + offset, levels[i].data,
+                static_cast<size_t>(levels[i].size));
+
+            vk::BufferImageCopy region;
+            region.bufferOffset = offset;
+            region.imageSubresource = vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor,
+                static_cast<uint32_t>(i), 0, 1};
+            region.imageExtent = levels[i].extent;
+            copy.imageRegions.push_back(region);
+        }
+
+        m_pendingCopies.push_back(std::move(copy));
+    }
+
+    vk::DeviceSize UploadQueue::getStagingAlignment()
+    {
+        return stagingAlignment;
+    }
+
+    void UploadQueue::flush()
+    {
+        updateSubmissions(false);
+
+        if (m_pendingCopies.empty())
+        {
+            return;
+        }
+
+        PROFILE_FUNCTION();
+
+        auto submission = std::make_unique<Submission>();
+        submission->commandBuffer = std::move(Context::getVulkanDevice().allocateCommandBuffersUnique({
+            *m_commandPool,
+            vk::CommandBufferLevel::ePrimary,
+            1
+        }).front());
+
+        auto& commandBuffer = *submission->commandBuffer;
+        commandBuffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+        // Images start out discarded, ready to be copied into
+        std::vector<vk::ImageMemoryBarrier> imageBarriers;
+        for (auto& i : m_pendingCopies)
+        {
+            if (i.image)
+            {
+                auto& barrier = imageBarriers.emplace_back(vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite,
+                    vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, i.image);
+                barrier.subresourceRange = vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, i.mipCount, 0, 1};
+            }
+        }
+        if (!imageBarriers.empty())
+        {
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+                {}, {}, {}, imageBarriers);
+        }
+
+        for (auto& i : m_pendingCopies)
+        {
+            if (i.image)
+            {
+                commandBuffer.copyBufferToImage(m_stagingBuffer->getBuffer(), i.image,
+                    vk::ImageLayout::eTransferDstOptimal, i.imageRegions);
+            }
+            else
+            {
+                commandBuffer.copyBuffer(m_stagingBuffer->getBuffer(), i.destination, {i.region});
+            }
+        }
+
+        // Release ownership to the graphics queue family if we're on a different one
+        // Otherwise the semaphore alone makes the writes visible
+        // Images move to their final layout either way, as part of the release when there is one
+        std::vector<vk::BufferMemoryBarrier> releaseBarriers;
+        std::vector<vk::ImageMemoryBarrier> imageReleaseBarriers;
+        for (auto& i : m_pendingCopies)
+        {
+            if (i.image)
+            {
+                imageReleaseBarriers.push_back(getImageBarrier(i, vk::AccessFlagBits::eTransferWrite, {}));
+            }
+            else if (m_transferQueueFamily != m_graphicsQueueFamily && !i.isConcurrent)
+            {
+                releaseBarriers.emplace_back(
+                    vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(),
+                    m_transferQueueFamily, m_graphicsQueueFamily,
+                    i.destination, i.region.dstOffset, i.region.size
+                );
+            }
+        }
+
+        if (!releaseBarriers.empty() || !imageReleaseBarriers.empty())
+        {
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, releaseBarriers, imageReleaseBarriers);
+        }
+
+        commandBuffer.end();
+
+        // The timeline value is both what the graphics queue waits on and how we know when the
+        // staging memory is free again
+        submission->timelineValue = Context::get().getDevice().getTransferTimeline().submit({commandBuffer});
+
+        spdlog::debug("Submitted {} uploads", m_pendingCopies.size());
+        submission->copies = std::move(m_pendingCopies);
+        submission->stagingBegin = m_pendingBegin;
+        m_submissions.push_back(std::move(submission));
+        m_pendingCopies.clear();
+    }
+
+    void UploadQueue::acquireUploads(const vk::CommandBuffer& commandBuffer, SemaphoreWaits& waits)
+    {
+        std::vector<vk::BufferMemoryBarrier> acquireBarriers;
+        std::vector<vk::ImageMemoryBarrier> imageAcquireBarriers;
+        vk::PipelineStageFlags acquireStages;
+        uint64_t waitValue = 0;
+
+        for (auto& i : m_submissions)
+        {
+            if (i->isAcquired)
+            {
+                continue;
+            }
+
+            // Wait for the copies right before the first stage that uses them
+            vk::PipelineStageFlags stages;
+            for (auto& j : i->copies)
+            {
+                stages |= j.stage;
+
+                if (m_transferQueueFamily == m_graphicsQueueFamily)
+                {
+                    continue;
+                }
+
+                if (j.image)
+                {
+                    imageAcquireBarriers.push_back(getImageBarrier(j, {}, j.access));
+                }
+                else if (!j.isConcurrent)
+                {
+                    acquireBarriers.emplace_back(
+                        vk::AccessFlags(), j.access,
+                        m_transferQueueFamily, m_graphicsQueueFamily,
+                        j.destination, j.region.dstOffset, j.region.size
+                    );
+                }
+            }
+
+            waitValue = i->timelineValue;
+            acquireStages |= stages;
+            i->isAcquired = true;
+        }
+
+        // Later values imply the earlier ones, so one wait covers every submission
+        if (waitValue != 0)
+        {
+            waits.add(Context::get().getDevice().getTransferTimeline(), waitValue, acquireStages);
+        }
+
+        // The acquire barriers start at the same stages the timeline is waited at
+        // so they are ordered after the waits
+        if (!acquireBarriers.empty() || !imageAcquireBarriers.empty())
+        {
+            commandBuffer.pipelineBarrier(acquireStages, acquireStages, {}, {}, acquireBarriers,
+                imageAcquireBarriers);
+        }
+    }
+
+
+    vk::DeviceSize UploadQueue::allocateStaging(vk::DeviceSize size)
+    {
+        while (true)
+        {
+            auto offset = tryAllocateStaging(size);
+            if (offset.has_value())
+            {
+                // Track where this batch starts in the ring
+                if (m_pendingCopies.empty())
+                {
+                    m_pendingBegin = offset.value();
+                }
+                return offset.value();
+            }
+
+            // Out of space - send off what we have and wait for the oldest upload to free up its memory
+            PROFILE_SCOPE("wait for staging memory");
+            flush();
+            updateSubmissions(true);
+        }
+    }
+
+    std::optional<vk::DeviceSize> UploadQueue::tryAllocateStaging(vk::DeviceSize size)
+    {
+        auto ringSize = m_stagingBuffer->getSize();
+        bool isEmpty = m_pendingCopies.empty() && std::all_of(m_submissions.begin(), m_submissions.end(),
+            [](const auto& i) { return i->isComplete; });
+
+        // Start from the beginning whenever nothing is in use
+        if (isEmpty)
+        {
+            m_stagingHead = 0;
+            m_stagingTail = 0;
+
+            if (size > ringSize)
+            {
+                return {};
+            }
+
+            m_stagingHead = size;
+            return 0;
+        }
+
+        // Never let the head catch up to the tail, so a full ring can be told apart from an empty one
+        auto alignedHead = alignUp(m_stagingHead, stagingAlignment);
+        if (m_stagingHead > m_stagingTail)
+        {
+            // Space left at the end of the ring
+            if (alignedHead + size <= ringSize)
+            {
+                m_stagingHead = alignedHead + size;
+                return alignedHead;
+            }
+
+            // Wrap around to the start
+            if (size < m_stagingTail)
+            {
+                m_stagingHead = size;
+                return 0;
+            }
+        }
+        else if (m_stagingHead < m_stagingTail && alignedHead + size < m_stagingTail)
+        {
+            m_stagingHead = alignedHead + size;
+            return alignedHead;
+        }
+
+        return {};
+    }
+
+    vk::ImageMemoryBarrier UploadQueue::getImageBarrier(const Copy& copy, vk::AccessFlags sourceAccess,
+        vk::AccessFlags destinationAccess) const
+    {
+        // Both halves of an ownership transfer have to describe the same layout transition
+        bool isTransferringOwnership = m_transferQueueFamily != m_graphicsQueueFamily;
+
+        vk::ImageMemoryBarrier barrier;
+        barrier.srcAccessMask = sourceAccess;
+        barrier.dstAccessMask = destinationAccess;
+        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        barrier.srcQueueFamilyIndex = isTransferringOwnership ? m_transferQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = isTransferringOwnership ? m_graphicsQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = copy.image;
+        barrier.subresourceRange = vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, copy.mipCount, 0, 1};
+        return barrier;
+    }
+
+    void UploadQueue::updateSubmissions(bool waitForOldest)
+    {
+        auto& timeline = Context::get().getDevice().getTransferTimeline();
+        for (auto& i : m_submissions)
+        {
+            if (i->isComplete)
+            {
+                continue;
+            }
+
+            if (waitForOldest)
+            {
+                timeline.wait(i->timelineValue);
+                waitForOldest = false;
+            }
+
+            // Submissions finish in order, so stop at the first one still running
+            if (!timeline.getIsComplete(i->timelineValue))
+            {
+                break;
+            }
+            i->isComplete = true;
+        }
+
+        // Submissions can be destroyed once they're finished and the graphics queue
+        // has waited on them
+        while (!m_submissions.empty() && m_submissions.front()->isComplete && m_submissions.front()->isAcquired)
+        {
+            m_submissions.pop_front();
+        }
+
+        // Move the tail up to the oldest staging memory still in use
+        auto oldestRunning = std::find_if(m_submissions.begin(), m_submissions.end(),
+            [](const auto& i) { return !i->isComplete; });
+
+        if (oldestRunning != m_submissions.end())
+        {
+            m_stagingTail = (*oldestRunning)->stagingBegin;
+        }
+        else if (!m_pendingCopies.empty())
+        {
+            m_stagingTail = m_pendingBegin;
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "buffer.hpp"
+#include "timeline.hpp"
+
+namespace Rendering
+{
+    // Streams data to device local buffers and images through a host visible staging ring buffer
+    // Uploads are batched up and sent to the transfer queue in a single submission per flush,
+    // which runs alongside rendering when the device has a dedicated transfer queue family
+    class UploadQueue
+    {
+        public:
+            // One mip level of an image upload, tightly packed
+            struct ImageLevel
+            {
+                const void* data;
+                vk::DeviceSize size;
+                vk::Extent3D extent;
+            };
+
+            UploadQueue(vk::DeviceSize stagingSize = 16 * 1024 * 1024);
+            ~UploadQueue();
+
+            // Copies the data into staging memory right away, and queues a copy into the destination
+            // The stage and access flags describe how the graphics queue will first use the data
+            void uploadBuffer(const Buffer& destination, vk::DeviceSize destinationOffset,
+                const void* data, vk::DeviceSize size,
+                vk::PipelineStageFlags destinationStage, vk::AccessFlags destinationAccess);
+
+            template <typename T>
+            void uploadBuffer(const Buffer& destination, const std::vector<T>& data,
+                vk::PipelineStageFlags destinationStage, vk::AccessFlags destinationAccess)
+            {
+                uploadBuffer(destination, 0, data.data(), data.size() * sizeof(T), destinationStage, destinationAccess);
+            }
+
+            // Fills the color aspect of a single layer image from mip 0 up, leaving it in shader read only layout
+            // The old contents are discarded, so the image can't be in use
+            // Unlike buffer uploads every level is staged at once, so they have to fit in staging memory
+            // together
+            void uploadImage(const vk::Image& destination, const std::vector<ImageLevel>& levels,
+                vk::PipelineStageFlags destinationStage, vk::AccessFlags destinationAccess);
+
+            // Largest image upload that fits, counting the alignment padding between levels
+            vk::DeviceSize getStagingSize() const {
+                return m_stagingBuffer->getSize();
+            }
+            static vk::DeviceSize getStagingAlignment();
+
+            // Submits every queued copy to the transfer queue in one batch
+            void flush();
+
+            // Must be recorded on the next graphics command buffer outside of a render pass
+            // Acquires ownership of everything flushed since the last call, and adds the transfer timeline
+            // wait the graphics submission needs before using the data
+            void acquireUploads(const vk::CommandBuffer& commandBuffer, SemaphoreWaits& waits);
+
+        private:
+            struct Copy
+            {
+                vk::Buffer destination;
+                // Concurrent destinations skip the ownership transfer to the graphics queue family
+                bool isConcurrent;
+                vk::BufferCopy region;
+                vk::PipelineStageFlags stage;
+                vk::AccessFlags access;
+
+                // Image copies leave the buffer fields empty and fill these out instead
+                vk::Image image;
+                uint32_t mipCount = 0;
+                std::vector<vk::BufferImageCopy> imageRegions;
+            };
+
+            struct Submission
+            {
+                Submission() :
+                    commandBuffer(nullptr)
+                {};
+
+                vk::UniqueCommandBuffer commandBuffer;
+                std::vector<Copy> copies;
+
+                // Transfer timeline value signalled once the copies are done
+                uint64_t timelineValue = 0;
+
+                // Range of the staging ring used by this submission
+                vk::DeviceSize stagingBegin = 0;
+                bool isComplete = false;
+                bool isAcquired = false;
+            };
+
+            // Returns an offset into the staging ring, waiting on old submissions if it's full
+            vk::DeviceSize allocateStaging(vk::DeviceSize size);
+            std::optional<vk::DeviceSize> tryAllocateStaging(vk::DeviceSize size);
+            void updateSubmissions(bool waitForOldest);
+
+            // Moves an uploaded image to shader read only layout, and between queue families if needed
+            vk::ImageMemoryBarrier getImageBarrier(const Copy& copy, vk::AccessFlags sourceAccess,
+                vk::AccessFlags destinationAccess) const;
+
+            uint32_t m_transferQueueFamily;
+            uint32_t m_graphicsQueueFamily;
+            vk::UniqueCommandPool m_commandPool;
+            std::optional<Buffer> m_stagingBuffer;
+
+            // In use part of the staging ring runs from the tail up to the head
+            vk::DeviceSize m_stagingHead = 0;
+            vk::DeviceSize m_stagingTail = 0;
+
+            std::vector<Copy> m_pendingCopies;
+            vk::DeviceSize m_pendingBegin = 0;
+
+            // In submission order
+            std::deque<std::unique_ptr<Submission>> m_submissions;
+    };
+}
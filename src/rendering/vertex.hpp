@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace Rendering
+{
+    // Basic 2D colored vertex, matching the inputs of test.vert
+    struct Vertex
+    {
+        std::array<float, 2> position;
+        std::array<float, 3> color;
+
+        static vk::VertexInputBindingDescription getBindingDescription() {
+            return {0, sizeof(Vertex), vk::VertexInputRate::eVertex};
+        }
+
+        static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions() {
+            return {
+                {0, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, position)},
+                {1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, color)}
+            };
+        }
+    };
+}
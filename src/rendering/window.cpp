@@ -1,6 +1,6 @@
 #include "window.hpp"
 
-#include <exception>
+#include <stdexcept>
 
 #include <spdlog/spdlog.h>
 #include <SDL2/SDL_vulkan.h>
@@ -14,13 +14,13 @@ namespace Rendering
         // Create SDL window
         spdlog::info("Creating SDL window of size {}x{}", width, height);
         m_window = SDL_CreateWindow("Simple-Render", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-            width, height, SDL_WINDOW_VULKAN);
+            width, height, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
 
         // Use C style error checking
         if (m_window == nullptr)
         {
             spdlog::error("Failed to create SDL window: {}", SDL_GetError());
-            throw std::exception("SDL window creation failed");
+            throw std::runtime_error("SDL window creation failed");
         }
 
         // Create Vulkan surface directly from window using SDL
@@ -30,7 +30,7 @@ namespace Rendering
             &rawSurface) == SDL_FALSE)
         {
             spdlog::error("Failed to create Vulkan surface: {}", SDL_GetError());
-            throw std::exception("Vulkan surface creation failed");
+            throw std::runtime_error("Vulkan surface creation failed");
         }
 
         // Assign C style surface to Vulkan-Hpp handle
@@ -47,4 +47,13 @@ namespace Rendering
         SDL_DestroyWindow(m_window);
     }
 
+
+    vk::Extent2D Window::getDrawableExtents()
+    {
+        int width, height;
+        SDL_Vulkan_GetDrawableSize(m_window, &width, &height);
+
+        return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+    }
+
 }
@@ -20,6 +20,9 @@ namespace Rendering
                 return m_surface;
             }
 
+            // Size of the drawable area in pixels, which is zero while minimized
+            vk::Extent2D getDrawableExtents();
+
         private:
             SDL_Window* m_window;
             vk::SurfaceKHR m_surface;
@@ -2,16 +2,177 @@
 
 #include <iostream>
 #include <exception>
+#include <stdexcept>
 #include <limits>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <string_view>
 
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
-int main()
+// The scene covers clip space, so the whole of it is in view
+static constexpr Rendering::GpuScene::ViewBounds sceneViewBounds = {-1.0f, -1.0f, 1.0f, 1.0f};
+
+static vk::PresentModeKHR parsePresentMode(std::string_view name)
+{
+    if (name == "fifo")
+    {
+        return vk::PresentModeKHR::eFifo;
+    }
+    else if (name == "fifo-relaxed")
+    {
+        return vk::PresentModeKHR::eFifoRelaxed;
+    }
+    else if (name == "mailbox")
+    {
+        return vk::PresentModeKHR::eMailbox;
+    }
+    else if (name == "immediate")
+    {
+        return vk::PresentModeKHR::eImmediate;
+    }
+
+    throw std::runtime_error(fmt::format("Unknown present mode {}", name));
+}
+
+// Parses command line arguments into application options
+// Rendering settings are written directly, as they need to be set before the rendering
+// singletons are created
+static SimpleRenderApp::Options parseArguments(int argc, char* argv[])
+{
+    SimpleRenderApp::Options options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view argument(argv[i]);
+
+        // Grabs the value following the current argument
+        auto nextValue = [&]() -> std::string_view {
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error(fmt::format("Missing value for argument {}", argument));
+            }
+            return argv[++i];
+        };
+
+        if (argument == "--headless")
+        {
+            Rendering::settings.headless = true;
+        }
+        else if (argument == "--frames")
+        {
+            options.frameLimit = std::stoull(std::string(nextValue()));
+        }
+        else if (argument == "--bench")
+        {
+            options.benchFrames = std::stoull(std::string(nextValue()));
+        }
+        else if (argument == "--bench-warmup")
+        {
+            options.benchWarmupFrames = std::stoull(std::string(nextValue()));
+        }
+        else if (argument == "--bench-output")
+        {
+            options.benchOutput = nextValue();
+        }
+        else if (argument == "--gpu-profile-log")
+        {
+            options.gpuProfileLogInterval = std::stoull(std::string(nextValue()));
+        }
+        else if (argument == "--trace")
+        {
+            options.tracePath = nextValue();
+        }
+        else if (argument == "--draws")
+        {
+            options.drawCount = static_cast<uint32_t>(std::stoul(std::string(nextValue())));
+        }
+        else if (argument == "--present-mode")
+        {
+            Rendering::settings.presentMode = parsePresentMode(nextValue());
+        }
+        else if (argument == "--frames-in-flight")
+        {
+            Rendering::settings.framesInFlight = static_cast<uint32_t>(std::stoul(std::string(nextValue())));
+            if (Rendering::settings.framesInFlight == 0)
+            {
+                throw std::runtime_error("Frames in flight must be at least 1");
+            }
+        }
+        else if (argument == "--pace")
+        {
+            options.pace = true;
+        }
+        else if (argument == "--record-threads")
+        {
+            options.recordThreads = static_cast<uint32_t>(std::stoul(std::string(nextValue())));
+        }
+        else if (argument == "--worker-threads")
+        {
+            options.workerThreads = static_cast<uint32_t>(std::stoul(std::string(nextValue())));
+        }
+        else if (argument == "--gpu-driven")
+        {
+            options.gpuDriven = true;
+        }
+        else if (argument == "--async-compute")
+        {
+            options.asyncCompute = true;
+        }
+        else if (argument == "--texture")
+        {
+            options.texturePaths.emplace_back(nextValue());
+        }
+        else if (argument == "--texture-budget")
+        {
+            options.textureBudget = std::stoull(std::string(nextValue()));
+        }
+        else if (argument == "--no-bindless")
+        {
+            Rendering::settings.bindless = false;
+        }
+        else if (argument == "--pipeline-cache")
+        {
+            Rendering::settings.pipelineCachePath = nextValue();
+        }
+        else if (argument == "--shader-cache")
+        {
+            Rendering::settings.shaderCacheDirectory = nextValue();
+        }
+        else if (argument == "--pipeline-manifest")
+        {
+            options.pipelineManifest = nextValue();
+        }
+        else if (argument == "--hot-reload")
+        {
+            options.hotReload = true;
+        }
+        else if (argument == "--width")
+        {
+            Rendering::settings.width = static_cast<uint32_t>(std::stoul(std::string(nextValue())));
+        }
+        else if (argument == "--height")
+        {
+            Rendering::settings.height = static_cast<uint32_t>(std::stoul(std::string(nextValue())));
+        }
+        else
+        {
+            throw std::runtime_error(fmt::format("Unknown argument {}", argument));
+        }
+    }
+
+    return options;
+}
+
+int main(int argc, char* argv[])
 {
     try
     {
-        SimpleRenderApp application;
+        auto options = parseArguments(argc, argv);
+
+        SimpleRenderApp application(options);
         application.loop();
     }
     catch (const std::exception& exception)
@@ -26,43 +187,153 @@ int main()
 
 
 
-SimpleRenderApp::SimpleRenderApp()
+SimpleRenderApp::SimpleRenderApp(const Options& options) :
+    m_options(options)
 {
     initializeLogger();
+    Util::Profiler::get().setThreadName("main");
+    m_jobSystem.emplace(m_options.workerThreads);
     Rendering::Instance::get();
     Rendering::Context::get();
 
-    m_mainVertexShader.emplace("rc/shaders/test_vert.spv");
-    m_mainFragmentShader.emplace("rc/shaders/test_frag.spv");
-
+    m_shaderCompiler.emplace(Rendering::settings.shaderCacheDirectory);
+    m_shaderLibrary.emplace(m_shaderCompiler.value());
     m_mainPass.emplace();
-    m_mainPipeline.emplace(m_mainVertexShader.value(), m_mainFragmentShader.value(), m_mainPass.value());
-    m_swapchain.emplace(Rendering::Context::get().getWindow(), m_mainPass.value());
+    m_pipelineLibrary.emplace(m_jobSystem.value());
+
+    // Draw data and textures come through the bindless table when we have one
+    bool isBindless = Rendering::Context::getBindlessTable() != nullptr;
+    m_mainPipelineDesc.vertexShader = &m_shaderLibrary->get(isBindless ?
+        "rc/shaders/bindless.vert" : "rc/shaders/test.vert");
+    m_mainPipelineDesc.fragmentShader = &m_shaderLibrary->get(isBindless ?
+        "rc/shaders/bindless.frag" : "rc/shaders/test.frag");
+    m_mainPipelineDesc.pass = &m_mainPass.value();
+
+    if (m_options.gpuDriven && !Rendering::Context::get().getDevice().getIsIndirectCountEnabled())
+    {
+        spdlog::warn("GPU driven rendering needs indirect draw counts, falling back to CPU draws");
+        m_options.gpuDriven = false;
+    }
+    if (m_options.asyncCompute && !m_options.gpuDriven)
+    {
+        spdlog::warn("Async compute only applies to GPU driven rendering, ignoring it");
+        m_options.asyncCompute = false;
+    }
+    if (m_options.asyncCompute && !Rendering::Context::get().getDevice().getHasAsyncCompute())
+    {
+        spdlog::warn("No separate compute queue, culling on the graphics queue instead");
+        m_options.asyncCompute = false;
+    }
+    if (m_options.gpuDriven)
+    {
+        m_scenePipelineDesc.vertexShader = &m_shaderLibrary->get("rc/shaders/gpudriven.vert");
+        m_scenePipelineDesc.fragmentShader = &m_shaderLibrary->get("rc/shaders/test.frag");
+        m_scenePipelineDesc.pass = &m_mainPass.value();
+    }
+
+    if (m_options.hotReload)
+    {
+        m_shaderWatcher.emplace(m_jobSystem.value(), m_shaderCompiler.value(),
+            std::string(SIMPLE_RENDER_SOURCE_DIR) + "/rc/shaders", "rc/shaders");
+    }
+
+    // Warm up every pipeline we know about in parallel before the first frame
+    {
+        PROFILE_SCOPE("precompile pipelines");
+        auto precompileSet = Rendering::loadPipelineManifest(m_options.pipelineManifest, m_shaderLibrary.value(),
+            m_mainPass.value());
+        precompileSet.push_back(m_mainPipelineDesc);
+        if (m_options.gpuDriven)
+        {
+            precompileSet.push_back(m_scenePipelineDesc);
+        }
+
+        m_pipelineLibrary->request(precompileSet);
+        m_pipelineLibrary->waitForCompiles();
+        spdlog::info("Precompiled {} pipelines sharing {} pipeline layouts", m_pipelineLibrary->getPipelineCount(),
+            Rendering::Context::getLayoutCache().getPipelineLayoutCount());
+        spdlog::info("Shader cache hits: {}, misses: {}", m_shaderCompiler->getCacheHits(),
+            m_shaderCompiler->getCacheMisses());
+    }
+
+    // Render into a swapchain when we have a window, or offscreen images otherwise
+    if (Rendering::Context::get().isHeadless())
+    {
+        m_offscreenTarget.emplace(vk::Extent2D{Rendering::settings.width, Rendering::settings.height},
+            Rendering::settings.framesInFlight);
+    }
+    else
+    {
+        m_swapchain.emplace(Rendering::Context::get().getWindow());
+    }
     createFrameData();
+    createMeshes();
+    Rendering::Context::getAllocator().logStatistics();
+
+    if (m_options.pace)
+    {
+        spdlog::info("Enabling frame pacing");
+        m_framePacer.emplace();
+    }
+
+    if (m_options.benchFrames != 0)
+    {
+        spdlog::info("Benchmarking {} frames after {} warmup frames", m_options.benchFrames,
+            m_options.benchWarmupFrames);
+        m_benchmark.emplace(m_options.benchWarmupFrames, m_options.benchFrames);
+        m_submissionTimer.emplace(Rendering::Context::get().getDevice().getGraphicsTimeline());
+    }
 
     m_isRunning = true;
 }
 
 SimpleRenderApp::~SimpleRenderApp()
 {
-    std::vector<vk::Fence> fences;
+    // Frames finish in order, so waiting on the last one covers all of them
+    spdlog::info("Waiting for last rendering commands to finish");
+    auto& graphicsTimeline = Rendering::Context::get().getDevice().getGraphicsTimeline();
+    graphicsTimeline.wait(graphicsTimeline.getSubmittedValue());
 
-    for (auto& i : m_frameData)
+    // Write out the trace if requested - this happens in the destructor so we still get a trace when
+    // the app exits through an exception
+    // Nothing can be thrown out of a destructor, so failing to write it only gets logged
+    if (!m_options.tracePath.empty())
     {
-        fences.push_back(*i.fence);
+        try
+        {
+            writeTrace();
+        }
+        catch (const std::exception& exception)
+        {
+            spdlog::error("Failed to write trace: {}", exception.what());
+        }
     }
-
-    spdlog::info("Waiting for last rendering commands to finish");
-    Rendering::Context::getVulkanDevice().waitForFences(fences, true, std::numeric_limits<uint64_t>::max());
 }
 
 void SimpleRenderApp::loop()
 {
+    PROFILE_FUNCTION();
+
     SDL_Event event;
 
+    // Benchmarks always run for a fixed number of frames
+    uint64_t frameLimit = m_benchmark.has_value() ? m_benchmark->getTotalFrames() : m_options.frameLimit;
+
     while (m_isRunning)
     {
-        while (SDL_PollEvent(&event))
+        PROFILE_SCOPE("frame");
+
+        // Sleep off the time we'd otherwise spend blocked on the GPU, so input is read as late as possible
+        if (m_framePacer.has_value())
+        {
+            PROFILE_SCOPE("frame pacing");
+            m_framePacer->waitForFrameStart();
+        }
+
+        auto frameStart = std::chrono::steady_clock::now();
+
+        // There's no window to send us events when rendering headless
+        while (!Rendering::Context::get().isHeadless() && SDL_PollEvent(&event))
         {
             switch (event.type)
             {
@@ -70,105 +341,565 @@ void SimpleRenderApp::loop()
                     m_isRunning = false;
                     break;
 
+                // Rebuild the swapchain at the start of the next frame after a resize
+                case SDL_EventType::SDL_WINDOWEVENT:
+                    if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                    {
+                        m_isSwapchainOutOfDate = true;
+                    }
+                    break;
+
+                // Dump a CPU trace on demand
+                case SDL_EventType::SDL_KEYDOWN:
+                    if (event.key.keysym.sym == SDLK_F12)
+                    {
+                        writeTrace();
+                    }
+                    break;
+
                 default:
                     break;
             }
         }
 
+        // Every metric is keyed by the frame number, which only counts frames that were submitted, so
+        // nothing is recorded for frames skipped while the window is minimized
+        auto frameNumber = m_frameNumber;
         render();
+
+        if (m_benchmark.has_value() && m_frameNumber != frameNumber)
+        {
+            std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+            m_benchmark->addSample(Util::Benchmark::Metric::CpuFrameTime, frameNumber, frameTime.count());
+        }
+
+        // Stop after a fixed number of frames if requested
+        if (frameLimit != 0 && m_frameNumber >= frameLimit)
+        {
+            m_isRunning = false;
+        }
+    }
+
+    if (m_benchmark.has_value())
+    {
+        finishBenchmark();
     }
 }
 
 void SimpleRenderApp::render()
 {
+    PROFILE_FUNCTION();
+
     auto& currentFrameData = m_frameData[m_currentFrame];
 
+    // Time spent blocked on the GPU or presentation engine feeds the frame pacer, which only covers
+    // the frame wait and the image acquire, not the CPU work between them
+    std::chrono::duration<double, std::milli> blockedTime(0.0);
+
     // Wait for the frame command buffer to be free
-    Rendering::Context::getVulkanDevice().waitForFences({*currentFrameData.fence}, true,
-        std::numeric_limits<uint64_t>::max());
+    auto& graphicsTimeline = Rendering::Context::get().getDevice().getGraphicsTimeline();
+    {
+        PROFILE_SCOPE("wait for frame");
+        auto waitStart = std::chrono::steady_clock::now();
+        graphicsTimeline.wait(currentFrameData.timelineValue);
+        blockedTime += std::chrono::steady_clock::now() - waitStart;
+    }
+
+    // The GPU is done with this frame's uniforms and descriptor sets
+    currentFrameData.uniforms->reset();
+    m_descriptorAllocator->beginFrame(m_currentFrame);
+
+    uint32_t swapchainImageIndex = 0;
+    Rendering::RenderGraph::ImportedImage colorTarget;
+
+    // Free whatever finished frames were the last to use, like old pipelines and swapchains, then
+    // swap in changed shaders between frames
+    Rendering::Context::getDeletionQueue().releaseRetired();
+    reloadShaders();
+
+    if (m_swapchain.has_value())
+    {
+        auto imageIndex = acquireSwapchainImage(currentFrameData, blockedTime);
+        if (!imageIndex.has_value())
+        {
+            // Nothing to draw to while the window is minimized
+            return;
+        }
+
+        swapchainImageIndex = imageIndex.value();
+        auto& swapchainImage =
+            m_swapchain.value().getSwapchainImages()[static_cast<size_t>(swapchainImageIndex)];
+        colorTarget.image = swapchainImage.image;
+        colorTarget.imageView = *swapchainImage.imageView;
+        colorTarget.format = m_swapchain->getSurfaceFormat().format;
+
+        // The first barrier chains onto the acquire semaphore's wait
+        colorTarget.initialStages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        colorTarget.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+    }
+    else
+    {
+        // Each frame owns its own offscreen image, so it's always free once the frame's previous
+        // submission has finished
+        auto& offscreenImage = m_offscreenTarget->getImages()[m_currentFrame];
+        colorTarget.image = *offscreenImage.image;
+        colorTarget.imageView = *offscreenImage.imageView;
+        colorTarget.format = m_offscreenTarget->getSurfaceFormat().format;
+        colorTarget.finalLayout = vk::ImageLayout::eTransferSrcOptimal;
+    }
+
+    if (m_parallelRecorder.has_value())
+    {
+        m_parallelRecorder->beginFrame(m_currentFrame);
+    }
+
+    if (m_framePacer.has_value())
+    {
+        m_framePacer->addBlockedTime(blockedTime.count());
+    }
 
     currentFrameData.commandBuffer->reset({});
     currentFrameData.commandBuffer->begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
 
-    // Aquire the next swapchain image and signal image available semaphore
-    // when it's ready
-    uint32_t swapchainImageIndex =
-        Rendering::Context::getVulkanDevice().acquireNextImageKHR(
-            m_swapchain->getSwapchain(),
-            std::numeric_limits<uint64_t>::max(),
-            *currentFrameData.imageAvailable,
-            nullptr
-        ).value;
+    // Each draw in the grid samples one of the textures, cycling through them, so they're requested
+    // at the size of a grid cell
+    // Levels loaded since last frame are swapped in before the uploads go out
+    if (m_textureStreamer.has_value())
+    {
+        auto renderExtents = getRenderExtents();
+        auto columns = std::ceil(std::sqrt(static_cast<double>(m_options.drawCount)));
+        auto cellSize = static_cast<float>(std::max(renderExtents.width, renderExtents.height) / columns);
 
-    auto& swapchainImage =
-        m_swapchain.value().getSwapchainImages()[static_cast<size_t>(swapchainImageIndex)];
+        for (auto& i : m_textures)
+        {
+            m_textureStreamer->requestSize(i, cellSize);
+        }
+        m_textureStreamer->update();
+    }
 
-    // Run our main render pass
-    vk::RenderPassBeginInfo renderPassInfo;
-    renderPassInfo.renderPass = m_mainPass->getRenderPass();
-    renderPassInfo.framebuffer = *swapchainImage.framebuffer;
-    renderPassInfo.renderArea.offset = vk::Offset2D({0, 0});
-    renderPassInfo.renderArea.extent = m_swapchain->getSwapchainExtents();
+    // Send off any queued uploads and pick up the ones that have been flushed
+    Rendering::SemaphoreWaits waits;
+    m_uploadQueue->flush();
+    m_uploadQueue->acquireUploads(*currentFrameData.commandBuffer, waits);
+
+    // Resolves GPU times from the last use of this frame's queries
+    m_gpuProfiler->beginFrame(m_currentFrame, m_frameNumber, *currentFrameData.commandBuffer);
+    collectFrameStatistics(currentFrameData);
+    std::optional<Rendering::GpuProfiler::Scope> frameScope;
+    frameScope.emplace(m_gpuProfiler.value(), *currentFrameData.commandBuffer, "frame");
+
+    auto renderExtents = getRenderExtents();
+    colorTarget.extent = renderExtents;
+
+    // Describe the frame, leaving the barriers and render passes to the graph
+    auto colorTargetHandle = m_renderGraph->importImage("color target", colorTarget);
+
+    Rendering::RenderGraph::BufferHandle drawCommands;
+    Rendering::RenderGraph::BufferHandle drawCount;
+    if (m_gpuScene.has_value())
+    {
+        drawCommands = m_renderGraph->importBuffer("draw commands", m_gpuScene->getDrawCommandBuffer(m_currentFrame));
+        drawCount = m_renderGraph->importBuffer("draw count", m_gpuScene->getDrawCountBuffer(m_currentFrame));
+    }
+    if (m_asyncCompute.has_value())
+    {
+        // Culling runs alongside the rest of the frame, and the graphics queue only waits for it at the
+        // indirect draw, so the graph sees the buffers as already written
+        auto& computeCommandBuffer = m_asyncCompute->begin(m_currentFrame);
+        m_gpuScene->cull(computeCommandBuffer, m_currentFrame, sceneViewBounds);
+        m_asyncCompute->submit(waits, vk::PipelineStageFlagBits::eDrawIndirect);
+    }
+    else if (m_gpuScene.has_value())
+    {
+        m_renderGraph->addPass("cull")
+            .writeBuffer(drawCommands, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite)
+            .writeBuffer(drawCount, vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+                vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderRead |
+                vk::AccessFlagBits::eShaderWrite)
+            .setExecute([&](const vk::CommandBuffer& commandBuffer, const auto&) {
+                m_gpuScene->cull(commandBuffer, m_currentFrame, sceneViewBounds);
+            });
+    }
 
     // Clear color to black
-    vk::ClearValue clearValue = vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f});
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearValue;
+    auto& mainPass = m_renderGraph->addPass("main pass")
+        .addColorAttachment(colorTargetHandle, vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}));
+    if (m_gpuScene.has_value())
+    {
+        // The whole scene is one draw, so there's nothing to spread across recording threads
+        mainPass
+            .readBuffer(drawCommands, vk::PipelineStageFlagBits::eDrawIndirect,
+                vk::AccessFlagBits::eIndirectCommandRead)
+            .readBuffer(drawCount, vk::PipelineStageFlagBits::eDrawIndirect, vk::AccessFlagBits::eIndirectCommandRead)
+            .setExecute([&](const vk::CommandBuffer& commandBuffer, const auto&) {
+                recordSceneDraw(commandBuffer, renderExtents);
+            });
+    }
+    else if (m_parallelRecorder.has_value())
+    {
+        // Draws are recorded into secondary command buffers across the recording threads
+        mainPass
+            .setSecondaryCommandBuffers()
+            .setExecute([&](const vk::CommandBuffer& commandBuffer,
+                const Rendering::RenderGraph::PassContext& context) {
+                vk::CommandBufferInheritanceInfo inheritanceInfo;
+                inheritanceInfo.renderPass = context.renderPass;
+                inheritanceInfo.subpass = 0;
+                inheritanceInfo.framebuffer = context.framebuffer;
+
+                m_parallelRecorder->record(commandBuffer, inheritanceInfo, m_options.drawCount,
+                    [&](const vk::CommandBuffer& secondaryCommandBuffer, size_t begin, size_t end) {
+                        recordDraws(secondaryCommandBuffer, currentFrameData, renderExtents, begin, end);
+                    });
+            });
+    }
+    else
+    {
+        mainPass.setExecute([&](const vk::CommandBuffer& commandBuffer, const auto&) {
+            recordDraws(commandBuffer, currentFrameData, renderExtents, 0, m_options.drawCount);
+        });
+    }
+
+    m_renderGraph->execute(*currentFrameData.commandBuffer, &m_gpuProfiler.value());
+
+    frameScope.reset();
+    currentFrameData.commandBuffer->end();
+
+    // Start compiling any pipelines that were missing this frame
+    m_pipelineLibrary->flush();
+
+    // Wait until the current frame image is ready before drawing, and notify the
+    // render finished semaphore on completion
+    // Offscreen images don't go through presentation so they skip both
+    std::vector<vk::Semaphore> signalSemaphores;
+    if (m_swapchain.has_value())
+    {
+        waits.add(*currentFrameData.imageAvailable, 0, vk::PipelineStageFlagBits::eColorAttachmentOutput);
+        signalSemaphores.push_back(*currentFrameData.renderFinished);
+    }
+
+    // Every frame signals the next graphics timeline value, which is what the slot waits on next time
+    currentFrameData.timelineValue = graphicsTimeline.submit({*currentFrameData.commandBuffer}, waits,
+        signalSemaphores);
+    currentFrameData.submittedFrame = m_frameNumber;
+    if (m_submissionTimer.has_value())
+    {
+        m_submissionTimer->track(currentFrameData.timelineValue, m_frameNumber);
+    }
+
+    // Present the image
+    if (m_swapchain.has_value())
+    {
+        PROFILE_SCOPE("present");
+
+        vk::PresentInfoKHR presentInfo;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &(*currentFrameData.renderFinished);
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = &(m_swapchain->getSwapchain());
+        presentInfo.pImageIndices = &swapchainImageIndex;
+
+        auto result = Rendering::Context::get().getDevice().getPresentationQueue().presentKHR(
+            &presentInfo
+        );
+
+        // The frame still made it out, so just rebuild the swapchain before the next one
+        if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR)
+        {
+            m_isSwapchainOutOfDate = true;
+        }
+        else if (result != vk::Result::eSuccess)
+        {
+            spdlog::error("Failed to present swapchain image: {}", vk::to_string(result));
+            throw std::runtime_error("Swapchain presentation failed");
+        }
+    }
+
+    // Increment frame count
+    m_currentFrame = (m_currentFrame + 1) % m_frameData.size();
+    m_frameNumber++;
+}
+
+
+
+void SimpleRenderApp::collectFrameStatistics(FrameData& frameData)
+{
+    if (!m_benchmark.has_value())
+    {
+        return;
+    }
+
+    // Timed on the submission timer's thread as each frame finishes, not when its slot comes round again
+    for (auto& i : m_submissionTimer->takeResults())
+    {
+        m_benchmark->addSample(Util::Benchmark::Metric::SubmitToComplete, i.tag, i.milliseconds);
+    }
+
+    if (!frameData.submittedFrame.has_value())
+    {
+        return;
+    }
+
+    auto frameNumber = frameData.submittedFrame.value();
+    frameData.submittedFrame.reset();
+
+    // The GPU profiler resolves this frame slot's queries at the start of the frame
+    if (m_gpuProfiler->getResultsFrameNumber() == frameNumber)
+    {
+        auto gpuTime = m_gpuProfiler->getScopeMilliseconds("frame");
+        if (gpuTime.has_value())
+        {
+            m_benchmark->addSample(Util::Benchmark::Metric::GpuTime, frameNumber, gpuTime.value());
+        }
+    }
+}
+
+void SimpleRenderApp::finishBenchmark()
+{
+    // Wait for the frames still in flight so their results make it into the report
+    // Go in submission order, as the GPU profiler only holds on to the latest results
+    m_submissionTimer->finish();
+    for (size_t i = 0; i < m_frameData.size(); i++)
+    {
+        auto frameIndex = (m_currentFrame + i) % m_frameData.size();
+        auto& frameData = m_frameData[frameIndex];
+
+        Rendering::Context::get().getDevice().getGraphicsTimeline().wait(frameData.timelineValue);
+        m_gpuProfiler->resolve(frameIndex);
+        collectFrameStatistics(frameData);
+    }
+
+    // Record what we ran on so reports from different machines and drivers can be compared
+    auto properties = Rendering::Context::get().getDevice().getProperties();
+    auto& deviceProperties = properties.getDeviceProperties();
+    m_benchmark->setInfo("device", std::string(deviceProperties.deviceName));
+    m_benchmark->setInfo("vendorId", fmt::format("{:#06x}", deviceProperties.vendorID));
+    m_benchmark->setInfo("deviceId", fmt::format("{:#06x}", deviceProperties.deviceID));
+    m_benchmark->setInfo("driverVersion", fmt::format("{:#010x}", deviceProperties.driverVersion));
+    m_benchmark->setInfo("apiVersion", fmt::format("{}.{}.{}", VK_VERSION_MAJOR(deviceProperties.apiVersion),
+        VK_VERSION_MINOR(deviceProperties.apiVersion), VK_VERSION_PATCH(deviceProperties.apiVersion)));
+    m_benchmark->setInfo("headless", Rendering::Context::get().isHeadless());
+    m_benchmark->setInfo("resolution", fmt::format("{}x{}", getRenderExtents().width, getRenderExtents().height));
+    m_benchmark->setInfo("drawCount", std::to_string(m_options.drawCount));
+    m_benchmark->setInfo("workerThreads", std::to_string(m_options.workerThreads));
+    m_benchmark->setInfo("recordThreads", std::to_string(m_options.recordThreads));
+    m_benchmark->setInfo("framesInFlight", std::to_string(m_frameData.size()));
+    m_benchmark->setInfo("framePacing", m_options.pace);
+    m_benchmark->setInfo("gpuDriven", m_options.gpuDriven);
+    m_benchmark->setInfo("asyncCompute", m_options.asyncCompute);
+    if (m_textureStreamer.has_value())
+    {
+        m_benchmark->setInfo("textureCount", std::to_string(m_textureStreamer->getTextureCount()));
+        m_benchmark->setInfo("textureBudgetMiB", std::to_string(m_textureStreamer->getBudget() / (1024 * 1024)));
+        m_benchmark->setInfo("textureResidentMiB",
+            std::to_string(m_textureStreamer->getResidentSize() / (1024 * 1024)));
+    }
+    if (m_swapchain.has_value())
+    {
+        m_benchmark->setInfo("presentMode", vk::to_string(m_swapchain->getPresentMode()));
+    }
+
+    m_benchmark->writeReport(m_options.benchOutput);
+}
+
+void SimpleRenderApp::writeTrace()
+{
+    auto tracePath = m_options.tracePath.empty() ? std::string("trace.json") : m_options.tracePath;
+    Util::Profiler::get().writeChromeTrace(tracePath);
+}
+
+void SimpleRenderApp::reloadShaders()
+{
+    if (!m_shaderWatcher.has_value())
+    {
+        return;
+    }
+
+    m_shaderWatcher->poll();
+    for (auto& i : m_shaderWatcher->takeCompiledShaders())
+    {
+        PROFILE_SCOPE("reload shader");
+
+        try
+        {
+            // Nothing can be compiling against the shader while its module is replaced
+            m_pipelineLibrary->waitForCompiles();
+
+            // Shaders that haven't been loaded yet will pick up the new file when they are
+            for (auto shader : m_shaderLibrary->reload(i))
+            {
+                m_pipelineLibrary->rebuild(*shader);
+            }
+        }
+        catch (const std::exception& exception)
+        {
+            spdlog::error("Failed to reload shader \"{}\": {}", i, exception.what());
+        }
+    }
+}
+
+void SimpleRenderApp::recordDraws(const vk::CommandBuffer& commandBuffer, const FrameData& frameData,
+    vk::Extent2D renderExtents, size_t begin, size_t end)
+{
+    PROFILE_FUNCTION();
+
+    setViewport(commandBuffer, renderExtents);
+
+    // Skip the draws if the pipeline is still compiling rather than stalling the frame
+    auto pipeline = m_pipelineLibrary->tryGet(m_mainPipelineDesc);
+    if (pipeline == nullptr)
+    {
+        return;
+    }
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->getPipeline());
+    m_triangleMesh->bind(commandBuffer);
 
-    // Record the render pass on the command buffer
-    currentFrameData.commandBuffer->beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-    currentFrameData.commandBuffer->setViewport(0, {vk::Viewport{
+    // The bindless table is bound once for every draw
+    auto bindlessTable = Rendering::Context::getBindlessTable();
+    if (bindlessTable != nullptr)
+    {
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline->getPipelineLayout(), 0,
+            {bindlessTable->getSet()}, {});
+    }
+
+    // Lay the triangles out in a square grid that fills the screen
+    auto columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_options.drawCount))));
+    float cellSize = 2.0f / static_cast<float>(columns);
+
+    for (size_t i = begin; i < end; i++)
+    {
+        DrawData drawData;
+        drawData.offset = {
+            -1.0f + (static_cast<float>(i % columns) + 0.5f) * cellSize,
+            -1.0f + (static_cast<float>(i / columns) + 0.5f) * cellSize
+        };
+        drawData.scale = 1.0f / static_cast<float>(columns);
+
+        if (bindlessTable != nullptr)
+        {
+            // Nothing to bind per draw, the shaders find their data and texture from the push constants
+            BindlessDrawIndices drawIndices{frameData.drawDataBuffer, frameData.uniforms->push(drawData) / 16,
+                UINT32_MAX};
+            if (!m_textures.empty())
+            {
+                drawIndices.textureIndex = m_textureStreamer->getBindlessIndex(m_textures[i % m_textures.size()]);
+            }
+            commandBuffer.pushConstants(pipeline->getPipelineLayout(),
+                vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0,
+                sizeof(drawIndices), &drawIndices);
+        }
+        else
+        {
+            // Only the dynamic offset changes between draws, so the set itself is never rewritten
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline->getPipelineLayout(), 0,
+                {frameData.drawDataSet}, {frameData.uniforms->push(drawData)});
+        }
+        commandBuffer.drawIndexed(m_triangleMesh->getIndexCount(), 1, 0, 0, 0);
+    }
+}
+
+void SimpleRenderApp::recordSceneDraw(const vk::CommandBuffer& commandBuffer, vk::Extent2D renderExtents)
+{
+    PROFILE_FUNCTION();
+
+    setViewport(commandBuffer, renderExtents);
+
+    auto pipeline = m_pipelineLibrary->tryGet(m_scenePipelineDesc);
+    if (pipeline == nullptr)
+    {
+        return;
+    }
+    m_gpuScene->draw(commandBuffer, m_currentFrame, *pipeline, sceneViewBounds);
+}
+
+void SimpleRenderApp::setViewport(const vk::CommandBuffer& commandBuffer, vk::Extent2D renderExtents)
+{
+    commandBuffer.setViewport(0, {vk::Viewport{
         0, 0,
-        static_cast<float>(m_swapchain->getSwapchainExtents().width), 
-        static_cast<float>(m_swapchain->getSwapchainExtents().height),
+        static_cast<float>(renderExtents.width),
+        static_cast<float>(renderExtents.height),
         0.0f, 1.0f
     }});
-    currentFrameData.commandBuffer->setScissor(0, {vk::Rect2D{
+    commandBuffer.setScissor(0, {vk::Rect2D{
         {0, 0},
-        m_swapchain->getSwapchainExtents()
+        renderExtents
     }});
-    currentFrameData.commandBuffer->bindPipeline(
-        vk::PipelineBindPoint::eGraphics, m_mainPipeline->getPipeline());
-    currentFrameData.commandBuffer->draw(3, 1, 0, 0);
-    currentFrameData.commandBuffer->endRenderPass();
-    currentFrameData.commandBuffer->end();
+}
 
-    // Submit the command buffer
-    vk::SubmitInfo submitInfo;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &(*currentFrameData.commandBuffer);
+std::optional<uint32_t> SimpleRenderApp::acquireSwapchainImage(FrameData& frameData,
+    std::chrono::duration<double, std::milli>& blockedTime)
+{
+    PROFILE_FUNCTION();
 
-    // Wait until the current frame image is ready before drawing
-    vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    submitInfo.pWaitDstStageMask = &waitStage;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &(*currentFrameData.imageAvailable);
+    auto& window = Rendering::Context::get().getWindow();
 
-    // Notify the render finished semaphore on completion
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &(*currentFrameData.renderFinished);
+    // A new swapchain is only needed once and we get a second try after rebuilding it, so
+    // a resize never costs a frame
+    for (size_t attempt = 0; attempt < 2; attempt++)
+    {
+        if (m_isSwapchainOutOfDate)
+        {
+            // Swapchains can't have a zero size, so wait for the window to be restored
+            auto drawableExtents = window.getDrawableExtents();
+            if (drawableExtents.width == 0 || drawableExtents.height == 0)
+            {
+                return {};
+            }
 
-    // Fence will be signalled on buffer completion
-    Rendering::Context::getVulkanDevice().resetFences({*currentFrameData.fence});
-    Rendering::Context::get().getDevice().getGraphicsQueue().submit(
-        {submitInfo},
-        *currentFrameData.fence
-    );
+            // No need to wait on the device - the old swapchain is retired once the frames
+            // submitted so far have finished
+            m_swapchain->recreate(window);
+            m_renderGraph->retireFramebuffers();
+            m_isSwapchainOutOfDate = false;
+        }
 
-    // Present the image
-    vk::PresentInfoKHR presentInfo;
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &(*currentFrameData.renderFinished);
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = &(m_swapchain->getSwapchain());
-    presentInfo.pImageIndices = &swapchainImageIndex;
+        // Aquire the next swapchain image and signal image available semaphore
+        // when it's ready
+        uint32_t imageIndex = 0;
+        auto acquireStart = std::chrono::steady_clock::now();
+        auto result = Rendering::Context::getVulkanDevice().acquireNextImageKHR(
+            m_swapchain->getSwapchain(),
+            std::numeric_limits<uint64_t>::max(),
+            *frameData.imageAvailable,
+            nullptr,
+            &imageIndex
+        );
+        blockedTime += std::chrono::steady_clock::now() - acquireStart;
+
+        if (result == vk::Result::eSuccess)
+        {
+            return imageIndex;
+        }
+        else if (result == vk::Result::eSuboptimalKHR)
+        {
+            // The image is still usable, so draw this frame and recreate afterwards
+            m_isSwapchainOutOfDate = true;
+            return imageIndex;
+        }
+        else if (result == vk::Result::eErrorOutOfDateKHR)
+        {
+            // Nothing was acquired so the semaphore is untouched
+            m_isSwapchainOutOfDate = true;
+        }
+        else
+        {
+            spdlog::error("Failed to acquire swapchain image: {}", vk::to_string(result));
+            throw std::runtime_error("Swapchain image acquisition failed");
+        }
+    }
 
-    Rendering::Context::get().getDevice().getPresentationQueue().presentKHR(
-        &presentInfo
-    );
+    // Still out of date, so skip the frame and try again next time
+    return {};
+}
 
-    // Increment frame count
-    m_currentFrame = (m_currentFrame + 1) % FrameCount;
+vk::Extent2D SimpleRenderApp::getRenderExtents() const
+{
+    if (m_swapchain.has_value())
+    {
+        return m_swapchain->getSwapchainExtents();
+    }
+
+    return m_offscreenTarget->getExtents();
 }
 
 
@@ -188,17 +919,110 @@ void SimpleRenderApp::initializeLogger()
 
 void SimpleRenderApp::createFrameData()
 {
-    spdlog::info("Creating frame data for {} frames", m_frameData.size());
+    spdlog::info("Creating frame data for {} frames in flight", Rendering::settings.framesInFlight);
+    m_frameData.resize(Rendering::settings.framesInFlight);
     for (auto& i : m_frameData)
     {
         i.imageAvailable = Rendering::Context::getVulkanDevice().createSemaphoreUnique({});
         i.renderFinished = Rendering::Context::getVulkanDevice().createSemaphoreUnique({});
-        i.fence = Rendering::Context::getVulkanDevice().createFenceUnique({vk::FenceCreateFlagBits::eSignaled});
         
         i.commandBuffer = std::move(Rendering::Context::getVulkanDevice().allocateCommandBuffersUnique({
             Rendering::Context::get().getCommandPool(),
             vk::CommandBufferLevel::ePrimary,
             1
         }).front());
+
+        // Leave room for every draw at the largest alignment the spec allows
+        // The bindless table reads the buffer as a storage buffer
+        auto bindlessTable = Rendering::Context::getBindlessTable();
+        i.uniforms = std::make_unique<Rendering::UniformAllocator>(
+            std::max<vk::DeviceSize>(4 * 1024 * 1024, m_options.drawCount * 256ull),
+            bindlessTable != nullptr ? vk::BufferUsageFlagBits::eStorageBuffer : vk::BufferUsageFlags());
+        if (bindlessTable != nullptr)
+        {
+            i.drawDataBuffer = bindlessTable->addBuffer(i.uniforms->getBuffer());
+        }
+    }
+
+    m_descriptorAllocator.emplace(m_frameData.size());
+
+    if (Rendering::Context::getBindlessTable() == nullptr)
+    {
+        // Every pipeline drawing the triangle shares the main pipeline's layout for its draw data
+        auto& drawDataLayout = m_pipelineLibrary->get(m_mainPipelineDesc).getDescriptorSetLayouts().front();
+
+        for (auto& i : m_frameData)
+        {
+            // The set never changes, so it comes from the cache rather than being rewritten every frame
+            Rendering::DescriptorAllocator::Binding binding;
+            binding.binding = 0;
+            binding.type = vk::DescriptorType::eUniformBufferDynamic;
+            binding.buffer = vk::DescriptorBufferInfo{i.uniforms->getBuffer(), 0, sizeof(DrawData)};
+            i.drawDataSet = m_descriptorAllocator->getCachedSet(drawDataLayout, {binding});
+        }
     }
+
+    m_gpuProfiler.emplace(m_frameData.size());
+    m_renderGraph.emplace();
+
+    if (m_options.recordThreads != 1)
+    {
+        m_parallelRecorder.emplace(m_jobSystem.value(), m_frameData.size(), m_options.recordThreads);
+    }
+    m_gpuProfiler->setLogInterval(m_options.gpuProfileLogInterval);
+}
+
+void SimpleRenderApp::createMeshes()
+{
+    m_uploadQueue.emplace();
+
+    std::vector<Rendering::Vertex> vertices = {
+        {{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+        {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+        {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
+    };
+    std::vector<uint32_t> indices = {0, 1, 2};
+
+    m_triangleMesh.emplace(m_uploadQueue.value(), vertices, indices);
+
+    if (!m_options.texturePaths.empty())
+    {
+        if (Rendering::Context::getBindlessTable() == nullptr || m_options.gpuDriven)
+        {
+            spdlog::warn("Textures are only drawn by CPU draws through the bindless table, streaming them anyway");
+        }
+        m_textureStreamer.emplace(m_uploadQueue.value(), m_jobSystem.value(), m_options.textureBudget * 1024 * 1024);
+        for (auto& i : m_options.texturePaths)
+        {
+            m_textures.push_back(m_textureStreamer->load(i));
+        }
+    }
+
+    if (m_options.gpuDriven)
+    {
+        // Same grid as the CPU draws, with bounding circles around the scaled triangle
+        auto columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_options.drawCount))));
+        float cellSize = 2.0f / static_cast<float>(columns);
+
+        std::vector<Rendering::GpuScene::Instance> instances(m_options.drawCount);
+        for (size_t i = 0; i < instances.size(); i++)
+        {
+            instances[i].position = {
+                -1.0f + (static_cast<float>(i % columns) + 0.5f) * cellSize,
+                -1.0f + (static_cast<float>(i / columns) + 0.5f) * cellSize
+            };
+            instances[i].scale = 1.0f / static_cast<float>(columns);
+            instances[i].radius = 0.71f * instances[i].scale;
+        }
+
+        m_gpuScene.emplace(m_shaderLibrary->get("rc/shaders/cull.comp"), m_uploadQueue.value(),
+            m_descriptorAllocator.value(), m_triangleMesh.value(), instances, m_frameData.size(),
+            m_options.asyncCompute);
+        if (m_options.asyncCompute)
+        {
+            m_asyncCompute.emplace(m_frameData.size());
+        }
+    }
+
+    m_uploadQueue->flush();
 }
@@ -1,14 +1,24 @@
 #pragma once
 
+#include <array>
 #include <memory>
 #include <exception>
 #include <optional>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <vector>
 
 #include <spdlog/spdlog.h>
 #include <SDL2/SDL_vulkan.h>
 #include <vulkan/vulkan.hpp>
 
 #include "rendering/rendering.hpp"
+#include "util/benchmark.hpp"
+#include "util/framepacer.hpp"
+#include "util/jobsystem.hpp"
+#include "util/profiler.hpp"
 
 class SimpleRenderApp
 {
@@ -16,40 +26,157 @@ class SimpleRenderApp
         struct FrameData
         {
             FrameData() :
-                imageAvailable(nullptr), renderFinished(nullptr),
-                fence(nullptr)
+                imageAvailable(nullptr), renderFinished(nullptr)
             {};
 
+            // Presentation only works with binary semaphores
             vk::UniqueSemaphore imageAvailable;
             vk::UniqueSemaphore renderFinished;
-            vk::UniqueFence fence;
             vk::UniqueCommandBuffer commandBuffer;
+
+            // Graphics timeline value signalled by the last submission from this frame slot
+            uint64_t timelineValue = 0;
+
+            // Per-draw uniform data, bound through drawDataSet with dynamic offsets, or read through
+            // the bindless table at drawDataBuffer
+            std::unique_ptr<Rendering::UniformAllocator> uniforms;
+            vk::DescriptorSet drawDataSet;
+            uint32_t drawDataBuffer = 0;
+
+            // Frame timing
+            std::optional<uint64_t> submittedFrame;
+        };
+
+        // Uniforms for each draw of the test triangle, matching test.vert
+        struct DrawData
+        {
+            std::array<float, 2> offset;
+            float scale;
+        };
+
+        // Push constants locating a draw's data in the bindless table, matching bindless.vert and
+        // bindless.frag
+        struct BindlessDrawIndices
+        {
+            uint32_t bufferIndex;
+            // In vec4s from the start of the buffer
+            uint32_t dataIndex;
+            // UINT32_MAX to draw with vertex colors
+            uint32_t textureIndex;
         };
 
-        static const size_t FrameCount = 2;
+        // Options parsed from the command line
+        struct Options
+        {
+            // Number of frames to render before quitting, or 0 to run until closed
+            size_t frameLimit = 0;
+
+            // Number of frames to benchmark, or 0 to run normally
+            uint64_t benchFrames = 0;
+            uint64_t benchWarmupFrames = 60;
+            std::string benchOutput = "bench.json";
+
+            // Log per-scope GPU times every N frames, or 0 to never log
+            uint64_t gpuProfileLogInterval = 600;
+
+            // CPU trace written on exit and when F12 is pressed, or empty to only write
+            // trace.json on F12
+            std::string tracePath;
+
+            // Pipelines compiled before the first frame
+            std::string pipelineManifest = "rc/pipelines.txt";
 
+            // Recompile and reload shaders when their sources change
+            bool hotReload = false;
 
-        SimpleRenderApp();
+            // Number of triangles drawn each frame
+            uint32_t drawCount = 1;
+
+            // Job system worker threads, defaulting to one per core besides the main thread
+            uint32_t workerThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+            // Slices of draws recorded in parallel into secondary command buffers, 0 for one per
+            // job system thread, or 1 to record inline
+            uint32_t recordThreads = 1;
+
+            // Delay the start of each frame to cut down on input latency
+            bool pace = false;
+
+            // Cull and draw the triangles on the GPU with a single indirect draw
+            bool gpuDriven = false;
+
+            // Cull GPU driven draws on a compute queue of their own, overlapping with rendering
+            bool asyncCompute = false;
+
+            // KTX2 or DDS textures streamed in at the size of a grid cell
+            std::vector<std::string> texturePaths;
+            // Memory the streamed textures can use in MiB, or 0 to size it from the device's heaps
+            uint64_t textureBudget = 0;
+        };
+
+
+        SimpleRenderApp(const Options& options);
         ~SimpleRenderApp();
 
         void loop();
         void render();
 
     private:
+        vk::Extent2D getRenderExtents() const;
+        // Adds the time spent blocked waiting for an image to blockedTime
+        std::optional<uint32_t> acquireSwapchainImage(FrameData& frameData,
+            std::chrono::duration<double, std::milli>& blockedTime);
+        void reloadShaders();
+        void recordDraws(const vk::CommandBuffer& commandBuffer, const FrameData& frameData,
+            vk::Extent2D renderExtents, size_t begin, size_t end);
+        void recordSceneDraw(const vk::CommandBuffer& commandBuffer, vk::Extent2D renderExtents);
+        void setViewport(const vk::CommandBuffer& commandBuffer, vk::Extent2D renderExtents);
+        void writeTrace();
+
+        // Benchmarking
+        void collectFrameStatistics(FrameData& frameData);
+        void finishBenchmark();
+
         // Initialization steps
         void initializeLogger();
         void createFrameData();
+        void createMeshes();
 
 
+        Options m_options;
         bool m_isRunning = false;
         std::shared_ptr<class spdlog::logger> m_mainLogger;
 
+        // Declared early so it outlives everything that queues jobs on it
+        std::optional<Util::JobSystem> m_jobSystem;
+
         // Rendering resources
-        std::optional<Rendering::Shader> m_mainVertexShader;
-        std::optional<Rendering::Shader> m_mainFragmentShader;
+        std::optional<Rendering::ShaderCompiler> m_shaderCompiler;
+        std::optional<Rendering::ShaderLibrary> m_shaderLibrary;
         std::optional<Rendering::Pass> m_mainPass;
-        std::optional<Rendering::Pipeline> m_mainPipeline;
+        std::optional<Rendering::PipelineLibrary> m_pipelineLibrary;
+        Rendering::PipelineDesc m_mainPipelineDesc;
+        std::optional<Rendering::ShaderWatcher> m_shaderWatcher;
+        std::optional<Rendering::UploadQueue> m_uploadQueue;
+        std::optional<Rendering::TextureStreamer> m_textureStreamer;
+        std::vector<Rendering::TextureStreamer::Handle> m_textures;
+        std::optional<Rendering::Mesh> m_triangleMesh;
+        Rendering::PipelineDesc m_scenePipelineDesc;
+        std::optional<Rendering::GpuScene> m_gpuScene;
+        std::optional<Rendering::AsyncCompute> m_asyncCompute;
         std::optional<Rendering::Swapchain> m_swapchain;
+        std::optional<Rendering::OffscreenTarget> m_offscreenTarget;
+        std::optional<Rendering::RenderGraph> m_renderGraph;
+        bool m_isSwapchainOutOfDate = false;
         size_t m_currentFrame = 0;
-        std::array<FrameData, FrameCount> m_frameData;
+        uint64_t m_frameNumber = 0;
+        std::vector<FrameData> m_frameData;
+
+        // Timing
+        std::optional<Rendering::GpuProfiler> m_gpuProfiler;
+        std::optional<Util::Benchmark> m_benchmark;
+        std::optional<Rendering::SubmissionTimer> m_submissionTimer;
+        std::optional<Util::FramePacer> m_framePacer;
+        std::optional<Rendering::ParallelRecorder> m_parallelRecorder;
+        std::optional<Rendering::DescriptorAllocator> m_descriptorAllocator;
 };
@@ -0,0 +1,135 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "json.hpp"
+
+namespace Util
+{
+    // Nearest rank percentile of an already sorted sample list
+    static double getPercentile(const std::vector<double>& sortedSamples, double percentile)
+    {
+        auto rank = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(sortedSamples.size())));
+        return sortedSamples[std::clamp<size_t>(rank, 1, sortedSamples.size()) - 1];
+    }
+
+
+    Benchmark::Benchmark(uint64_t warmupFrames, uint64_t measuredFrames) :
+        m_warmupFrames(warmupFrames), m_measuredFrames(measuredFrames)
+    {
+        for (auto& i : m_samples)
+        {
+            i.reserve(static_cast<size_t>(measuredFrames));
+        }
+    }
+
+    void Benchmark::addSample(Metric metric, uint64_t frameNumber, double milliseconds)
+    {
+        if (frameNumber < m_warmupFrames || frameNumber >= getTotalFrames())
+        {
+            return;
+        }
+
+        m_samples[static_cast<size_t>(metric)].push_back(milliseconds);
+    }
+
+    void Benchmark::setInfo(const std::string& key, const std::string& value)
+    {
+        m_info[key] = fmt::format("\"{}\"", escapeJson(value));
+    }
+
+    Benchmark::Summary Benchmark::summarize(Metric metric) const
+    {
+        Summary summary;
+        auto samples = m_samples[static_cast<size_t>(metric)];
+
+        if (samples.empty())
+        {
+            return summary;
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        summary.sampleCount = samples.size();
+        summary.min = samples.front();
+        summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+        summary.p50 = getPercentile(samples, 50.0);
+        summary.p95 = getPercentile(samples, 95.0);
+        summary.p99 = getPercentile(samples, 99.0);
+
+        return summary;
+    }
+
+    void Benchmark::writeReport(const std::string& filePath) const
+    {
+        std::string report = "{\n";
+
+        // Run information
+        report += fmt::format("    \"warmupFrames\": {},\n", m_warmupFrames);
+        report += fmt::format("    \"measuredFrames\": {},\n", m_measuredFrames);
+        for (auto& [key, value] : m_info)
+        {
+            report += fmt::format("    \"{}\": {},\n", escapeJson(key), value);
+        }
+
+        // Metric summaries - metrics with no samples (like GPU time on devices without
+        // timestamp support) are written as null
+        report += "    \"metrics\": {\n";
+        for (size_t i = 0; i < m_samples.size(); i++)
+        {
+            auto metric = static_cast<Metric>(i);
+            auto summary = summarize(metric);
+            const char* separator = (i + 1 < m_samples.size()) ? "," : "";
+
+            if (summary.sampleCount == 0)
+            {
+                report += fmt::format("        \"{}\": null{}\n", getMetricName(metric), separator);
+                continue;
+            }
+
+            report += fmt::format(
+                "        \"{}\": {{\"samples\": {}, \"min\": {:.4f}, \"mean\": {:.4f}, "
+                "\"p50\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}}}{}\n",
+                getMetricName(metric), summary.sampleCount, summary.min, summary.mean,
+                summary.p50, summary.p95, summary.p99, separator);
+
+            spdlog::info("Benchmark {}: min {:.3f}ms mean {:.3f}ms p50 {:.3f}ms p95 {:.3f}ms p99 {:.3f}ms",
+                getMetricName(metric), summary.min, summary.mean, summary.p50, summary.p95, summary.p99);
+        }
+        report += "    }\n}\n";
+
+        std::ofstream file(filePath, std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+        {
+            spdlog::error("Cannot open benchmark report \"{}\"", filePath);
+            throw std::runtime_error("Cannot open benchmark report");
+        }
+
+        file << report;
+        spdlog::info("Wrote benchmark report to \"{}\"", filePath);
+    }
+
+    std::string_view Benchmark::getMetricName(Metric metric)
+    {
+        switch (metric)
+        {
+            case Metric::CpuFrameTime:
+                return "cpuFrameMs";
+
+            case Metric::GpuTime:
+                return "gpuFrameMs";
+
+            case Metric::SubmitToComplete:
+                return "submitToCompleteMs";
+
+            default:
+                return "unknown";
+        }
+    }
+}
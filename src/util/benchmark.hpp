@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Util
+{
+    // Collects per-frame timing samples over a fixed number of frames after a warmup period,
+    // and reports min/mean/percentile summaries as JSON
+    class Benchmark
+    {
+        public:
+            enum class Metric
+            {
+                CpuFrameTime,
+                GpuTime,
+                // From submitting the frame to the GPU finishing it, without presentation
+                SubmitToComplete,
+                Count
+            };
+
+            struct Summary
+            {
+                size_t sampleCount = 0;
+                double min = 0.0;
+                double mean = 0.0;
+                double p50 = 0.0;
+                double p95 = 0.0;
+                double p99 = 0.0;
+            };
+
+            Benchmark(uint64_t warmupFrames, uint64_t measuredFrames);
+
+            // Records a sample in milliseconds for the given frame
+            // Samples from warmup frames or past the end of the run are ignored
+            void addSample(Metric metric, uint64_t frameNumber, double milliseconds);
+
+            // Extra key/value pairs written to the report (device name, driver version...)
+            void setInfo(const std::string& key, const std::string& value);
+            void setInfo(const std::string& key, const char* value) {
+                setInfo(key, std::string(value));
+            }
+            // Written as a JSON bool rather than a string
+            void setInfo(const std::string& key, bool value) {
+                m_info[key] = value ? "true" : "false";
+            }
+
+            uint64_t getTotalFrames() const {
+                return m_warmupFrames + m_measuredFrames;
+            }
+
+            Summary summarize(Metric metric) const;
+            void writeReport(const std::string& filePath) const;
+
+            static std::string_view getMetricName(Metric metric);
+
+        private:
+            uint64_t m_warmupFrames;
+            uint64_t m_measuredFrames;
+            std::array<std::vector<double>, static_cast<size_t>(Metric::Count)> m_samples;
+            // Values are stored already encoded as JSON
+            std::map<std::string, std::string> m_info;
+    };
+}
@@ -0,0 +1,49 @@
+#include "framepacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace Util
+{
+    FramePacer::FramePacer(double marginMilliseconds) :
+        m_margin(marginMilliseconds)
+    {}
+
+
+    void FramePacer::waitForFrameStart()
+    {
+        using Clock = std::chrono::steady_clock;
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+
+        m_lastDelay = m_delay;
+        if (m_delay <= 0.0)
+        {
+            return;
+        }
+
+        auto start = Clock::now();
+        auto target = start + std::chrono::duration_cast<Clock::duration>(Milliseconds(m_delay));
+
+        // Sleep for most of the delay, and spin for the rest as sleeps tend to overshoot
+        auto sleepTarget = target - std::chrono::milliseconds(1);
+        if (sleepTarget > start)
+        {
+            std::this_thread::sleep_until(sleepTarget);
+        }
+        while (Clock::now() < target)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    void FramePacer::addBlockedTime(double milliseconds)
+    {
+        // Had we not delayed the frame, it would have been blocked for the delay as well
+        auto slack = milliseconds + m_lastDelay;
+        m_slack += (slack - m_slack) * SmoothingFactor;
+
+        // If the frame still blocked for longer than the margin, there's more room to delay,
+        // and if it didn't block at all we've overshot and the estimate shrinks on its own
+        m_delay = std::max(0.0, m_slack - m_margin);
+    }
+}
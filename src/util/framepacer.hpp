@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+
+namespace Util
+{
+    // Delays the start of each frame so the CPU finishes its work just before the GPU is ready for it
+    // Instead of sampling input and then blocking on a frame fence or swapchain image, the expected
+    // wait is slept off up front, which keeps the same throughput with less input latency
+    class FramePacer
+    {
+        public:
+            // The margin is how early the frame should be ready, to absorb CPU time jitter
+            FramePacer(double marginMilliseconds = 1.0);
+
+            // Sleeps until the predicted start of the next frame
+            void waitForFrameStart();
+
+            // Reports how long the frame was blocked on the GPU or presentation engine
+            void addBlockedTime(double milliseconds);
+
+            auto getDelayMilliseconds() const {
+                return m_delay;
+            }
+
+        private:
+            // Weight given to each new measurement in the slack estimate
+            static constexpr double SmoothingFactor = 0.1;
+
+            double m_margin;
+
+            // Estimated time a frame would spend blocked if it weren't delayed
+            double m_slack = 0.0;
+            double m_delay = 0.0;
+            double m_lastDelay = 0.0;
+    };
+}
@@ -0,0 +1,327 @@
+#include "jobsystem.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "profiler.hpp"
+
+namespace Util
+{
+    // Threads outside the job system all share index 0
+    static thread_local size_t threadIndex = 0;
+
+
+
+    bool JobSystem::Counter::isDone()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pendingJobs == 0;
+    }
+
+
+
+    JobSystem::JobSystem(size_t workerCount) :
+        m_ownerThread(std::this_thread::get_id())
+    {
+        spdlog::info("Creating job system with {} worker threads", workerCount);
+
+        for (size_t i = 0; i < workerCount + 1; i++)
+        {
+            m_queues.push_back(std::make_unique<Queue>());
+        }
+
+        for (size_t i = 1; i < workerCount + 1; i++)
+        {
+            m_workers.emplace_back(&JobSystem::workerMain, this, i);
+        }
+    }
+
+    JobSystem::~JobSystem()
+    {
+        spdlog::info("Stopping job system worker threads");
+
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_isStopping = true;
+        }
+        m_wakeCondition.notify_all();
+
+        for (auto& i : m_workers)
+        {
+            i.join();
+        }
+    }
+
+
+    void JobSystem::run(Job job, Counter* counter)
+    {
+        if (counter != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(counter->m_mutex);
+            counter->m_pendingJobs++;
+        }
+
+        push({std::move(job), counter});
+    }
+
+    void JobSystem::runAfter(Counter& dependency, Job job, Counter* counter)
+    {
+        // The job counts as pending right away, so waiting on its counter also waits for the dependency
+        if (counter != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(counter->m_mutex);
+            counter->m_pendingJobs++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(dependency.m_mutex);
+            if (dependency.m_pendingJobs != 0)
+            {
+                dependency.m_continuations.push_back([this, job = std::move(job), counter]() mutable {
+                    push({std::move(job), counter});
+                });
+                return;
+            }
+        }
+
+        // Dependency already finished
+        push({std::move(job), counter});
+    }
+
+    void JobSystem::wait(Counter& counter)
+    {
+        PROFILE_FUNCTION();
+
+        checkCanRunJobs();
+
+        while (!counter.isDone())
+        {
+            // Help out instead of blocking
+            Task task;
+            if (tryPop(getThreadIndex(), task))
+            {
+                execute(task);
+                continue;
+            }
+
+            // Everything left is already running on other threads
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wakeCondition.wait(lock, [&]() { return m_queuedJobs > 0 || counter.isDone(); });
+        }
+
+        std::exception_ptr exception;
+        {
+            std::lock_guard<std::mutex> lock(counter.m_mutex);
+            std::swap(exception, counter.m_exception);
+        }
+
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    void JobSystem::parallelFor(size_t count, size_t minBatchSize,
+        const std::function<void(size_t begin, size_t end)>& function)
+    {
+        checkCanRunJobs();
+
+        if (count == 0)
+        {
+            return;
+        }
+
+        // No more batches than there are threads to run them
+        minBatchSize = std::max<size_t>(minBatchSize, 1);
+        auto batchCount = std::clamp<size_t>((count + minBatchSize - 1) / minBatchSize, 1, getThreadCount());
+
+        Counter counter;
+        for (size_t i = 1; i < batchCount; i++)
+        {
+            run([&function, count, batchCount, i]() {
+                function(count * i / batchCount, count * (i + 1) / batchCount);
+            }, &counter);
+        }
+
+        // The calling thread takes the first batch, and has to wait for the rest even if it throws,
+        // as the jobs reference the counter and function
+        std::exception_ptr exception;
+        try
+        {
+            function(0, count / batchCount);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        wait(counter);
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    size_t JobSystem::getThreadIndex()
+    {
+        return threadIndex;
+    }
+
+
+    void JobSystem::push(Task task)
+    {
+        // Count the job first so a thread looking for work never misses it - at worst it checks
+        // the queues once more before the job lands
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_queuedJobs++;
+        }
+
+        {
+            auto& queue = *m_queues[std::min(getThreadIndex(), m_queues.size() - 1)];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        m_wakeCondition.notify_one();
+    }
+
+    bool JobSystem::tryPop(size_t index, Task& task)
+    {
+        index = std::min(index, m_queues.size() - 1);
+
+        // Newest job from our own queue first
+        {
+            auto& queue = *m_queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                m_queuedJobs--;
+                return true;
+            }
+        }
+
+        // Then steal the oldest job from someone else
+        for (size_t i = 1; i < m_queues.size(); i++)
+        {
+            auto& queue = *m_queues[(index + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                m_queuedJobs--;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void JobSystem::execute(Task& task)
+    {
+        std::exception_ptr exception;
+        try
+        {
+            task.job();
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        if (task.counter != nullptr)
+        {
+            finishJob(*task.counter, exception);
+        }
+        else if (exception)
+        {
+            // Nobody is waiting to hear about it
+            try
+            {
+                std::rethrow_exception(exception);
+            }
+            catch (const std::exception& error)
+            {
+                spdlog::error("Untracked job threw an exception: {}", error.what());
+            }
+            catch (...)
+            {
+                spdlog::error("Untracked job threw an unknown exception");
+            }
+        }
+    }
+
+    void JobSystem::finishJob(Counter& counter, std::exception_ptr exception)
+    {
+        std::vector<Job> continuations;
+        bool isDone = false;
+
+        {
+            std::lock_guard<std::mutex> lock(counter.m_mutex);
+            if (exception && !counter.m_exception)
+            {
+                counter.m_exception = exception;
+            }
+
+            counter.m_pendingJobs--;
+            isDone = counter.m_pendingJobs == 0;
+            if (isDone)
+            {
+                std::swap(continuations, counter.m_continuations);
+            }
+        }
+
+        // The counter may be gone as soon as the lock is released, so only the local copies are used here
+        for (auto& i : continuations)
+        {
+            i();
+        }
+
+        if (isDone)
+        {
+            // Lock so a thread can't miss the wake up between checking the counter and going to sleep
+            {
+                std::lock_guard<std::mutex> lock(m_wakeMutex);
+            }
+            m_wakeCondition.notify_all();
+        }
+    }
+
+    void JobSystem::checkCanRunJobs() const
+    {
+        if (getThreadIndex() == 0 && std::this_thread::get_id() != m_ownerThread)
+        {
+            spdlog::error("Jobs can only be waited on by the thread that owns the job system or its workers");
+            throw std::runtime_error("Waiting on jobs from a thread outside the job system");
+        }
+    }
+
+    void JobSystem::workerMain(size_t index)
+    {
+        threadIndex = index;
+        Profiler::get().setThreadName(fmt::format("worker {}", index));
+
+        while (true)
+        {
+            Task task;
+            if (tryPop(index, task))
+            {
+                execute(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wakeCondition.wait(lock, [this]() { return m_isStopping || m_queuedJobs > 0; });
+
+            if (m_isStopping)
+            {
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Util
+{
+    // Work stealing job scheduler with one worker thread per core
+    // Each thread pushes and pops jobs at the back of its own queue, and steals from the front of
+    // other queues once it runs dry, so threads mostly stay on their own recent (cache-warm) work
+    // Waiting on jobs never blocks outright - the waiting thread runs other jobs until its work is done
+    class JobSystem
+    {
+        public:
+            using Job = std::function<void()>;
+
+            // Tracks a group of jobs, and runs continuations once all of them have finished
+            // A counter has to outlive the jobs it tracks, which waiting on it guarantees
+            class Counter
+            {
+                friend class JobSystem;
+
+                public:
+                    Counter() = default;
+                    Counter(const Counter&) = delete;
+                    Counter& operator=(const Counter&) = delete;
+
+                    bool isDone();
+
+                private:
+                    // Everything is guarded by the mutex, so the counter can be destroyed as soon as
+                    // a waiter sees it finish
+                    std::mutex m_mutex;
+                    size_t m_pendingJobs = 0;
+                    // Each continuation queues a job that was waiting on this counter
+                    std::vector<Job> m_continuations;
+                    std::exception_ptr m_exception;
+            };
+
+            // With no workers every job runs on whichever thread waits for it
+            // The thread creating the system owns it, and is the only thread outside it that can wait
+            JobSystem(size_t workerCount);
+            ~JobSystem();
+
+            // Queues a job on the calling thread's queue, tracked by the counter if given
+            void run(Job job, Counter* counter = nullptr);
+
+            // Queues a job once every job tracked by the dependency has finished
+            void runAfter(Counter& dependency, Job job, Counter* counter = nullptr);
+
+            // Runs jobs on this thread until the counter's jobs have all finished
+            // Rethrows the first exception thrown by any of them
+            // Only the owning thread and workers can wait, as jobs may use per-thread state by thread index
+            void wait(Counter& counter);
+
+            // Splits [0, count) into batches of at least minBatchSize, runs them across all threads and waits
+            // Like waiting, only the owning thread and workers can call this
+            void parallelFor(size_t count, size_t minBatchSize, const std::function<void(size_t begin, size_t end)>& function);
+
+            // Worker threads plus the thread that owns the system
+            auto getThreadCount() const {
+                return m_queues.size();
+            }
+
+            // Index of the calling thread, from 1 for workers, and 0 for any thread outside the system
+            // Threads other than the owner that use per-thread state by index would share slot 0 with it,
+            // which is why they can't run jobs
+            static size_t getThreadIndex();
+
+        private:
+            struct Task
+            {
+                Job job;
+                Counter* counter;
+            };
+
+            struct Queue
+            {
+                std::mutex mutex;
+                std::deque<Task> tasks;
+            };
+
+            void push(Task task);
+            bool tryPop(size_t index, Task& task);
+            void execute(Task& task);
+            void finishJob(Counter& counter, std::exception_ptr exception);
+            void workerMain(size_t index);
+
+            // Throws if the calling thread is neither the owner nor a worker
+            void checkCanRunJobs() const;
+
+            // Queue 0 belongs to the threads outside the system
+            std::vector<std::unique_ptr<Queue>> m_queues;
+            std::vector<std::thread> m_workers;
+            std::thread::id m_ownerThread;
+
+            // Sleeping threads are woken when jobs are queued or a counter finishes
+            std::mutex m_wakeMutex;
+            std::condition_variable m_wakeCondition;
+            std::atomic<size_t> m_queuedJobs{0};
+            bool m_isStopping = false;
+    };
+}
@@ -0,0 +1,43 @@
+#include "json.hpp"
+
+#include <fmt/format.h>
+
+namespace Util
+{
+    std::string escapeJson(const std::string_view& value)
+    {
+        std::string result;
+        result.reserve(value.size());
+
+        for (char i : value)
+        {
+            switch (i)
+            {
+                case '"':
+                    result += "\\\"";
+                    break;
+
+                case '\\':
+                    result += "\\\\";
+                    break;
+
+                case '\n':
+                    result += "\\n";
+                    break;
+
+                default:
+                    if (static_cast<unsigned char>(i) < 0x20)
+                    {
+                        result += fmt::format("\\u{:04x}", static_cast<int>(i));
+                    }
+                    else
+                    {
+                        result += i;
+                    }
+                    break;
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace Util
+{
+    // Escapes a string for use as a JSON string value (without the surrounding quotes)
+    std::string escapeJson(const std::string_view& value);
+}
@@ -0,0 +1,132 @@
+#include "profiler.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "json.hpp"
+
+namespace Util
+{
+    Profiler& Profiler::get()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    uint64_t Profiler::now()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - get().m_startTime;
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    void Profiler::record(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds)
+    {
+        auto& buffer = getThreadBuffer();
+
+        // Only this thread ever writes to its buffer, so a relaxed load of our own index is fine
+        auto index = buffer.writeIndex.load(std::memory_order_relaxed);
+        auto& event = buffer.events[index % EventsPerThread];
+        event.name.store(name, std::memory_order_relaxed);
+        event.start.store(startNanoseconds, std::memory_order_relaxed);
+        event.duration.store(endNanoseconds - startNanoseconds, std::memory_order_relaxed);
+
+        // Publish the event to readers
+        buffer.writeIndex.store(index + 1, std::memory_order_release);
+    }
+
+    void Profiler::setThreadName(const std::string_view& name)
+    {
+        auto& buffer = getThreadBuffer();
+
+        std::lock_guard lock(m_threadsMutex);
+        buffer.name = name;
+    }
+
+    void Profiler::writeChromeTrace(const std::string& filePath)
+    {
+        std::ofstream file(filePath, std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+        {
+            spdlog::error("Cannot open trace file \"{}\"", filePath);
+            throw std::runtime_error("Cannot open trace file");
+        }
+
+        std::lock_guard lock(m_threadsMutex);
+
+        size_t eventCount = 0;
+        bool isFirstEvent = true;
+        auto separator = [&]() {
+            const char* result = isFirstEvent ? "\n" : ",\n";
+            isFirstEvent = false;
+            return result;
+        };
+
+        file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+        for (auto& thread : m_threads)
+        {
+            // Thread name metadata
+            if (!thread->name.empty())
+            {
+                file << separator() << fmt::format(
+                    "{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": {}, \"args\": {{\"name\": \"{}\"}}}}",
+                    thread->threadId, escapeJson(thread->name));
+            }
+
+            // Copy out whatever is still in the ring
+            auto end = thread->writeIndex.load(std::memory_order_acquire);
+            auto begin = (end > EventsPerThread) ? end - EventsPerThread : 0;
+
+            for (auto i = begin; i < end; i++)
+            {
+                auto& event = thread->events[i % EventsPerThread];
+                auto name = event.name.load(std::memory_order_relaxed);
+                auto start = event.start.load(std::memory_order_relaxed);
+                auto duration = event.duration.load(std::memory_order_relaxed);
+
+                // The owning thread may have wrapped around and overwritten this slot while we were
+                // reading it, in which case the event is dropped
+                auto currentEnd = thread->writeIndex.load(std::memory_order_acquire);
+                if (currentEnd > EventsPerThread && i < currentEnd - EventsPerThread)
+                {
+                    continue;
+                }
+
+                // Chrome traces use microseconds
+                file << separator() << fmt::format(
+                    "{{\"name\": \"{}\", \"cat\": \"cpu\", \"ph\": \"X\", \"ts\": {:.3f}, \"dur\": {:.3f}, "
+                    "\"pid\": 1, \"tid\": {}}}",
+                    escapeJson(name), static_cast<double>(start) / 1000.0,
+                    static_cast<double>(duration) / 1000.0, thread->threadId);
+                eventCount++;
+            }
+        }
+
+        file << "\n]}\n";
+        spdlog::info("Wrote {} profiler events from {} threads to \"{}\"", eventCount, m_threads.size(), filePath);
+    }
+
+
+    Profiler::Profiler() :
+        m_startTime(std::chrono::steady_clock::now())
+    {}
+
+    Profiler::ThreadBuffer& Profiler::getThreadBuffer()
+    {
+        // Buffers are shared with the profiler so events survive after their thread exits
+        thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+
+        if (!threadBuffer)
+        {
+            threadBuffer = std::make_shared<ThreadBuffer>();
+
+            std::lock_guard lock(m_threadsMutex);
+            threadBuffer->threadId = static_cast<uint32_t>(m_threads.size());
+            m_threads.push_back(threadBuffer);
+        }
+
+        return *threadBuffer;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Util
+{
+    // Collects timed CPU scopes from any thread and exports them as Chrome trace JSON
+    // (viewable in chrome://tracing or Perfetto)
+    // Each thread records into its own ring buffer, so recording never takes a lock - the mutex is
+    // only used when a thread records its first event or when the trace is written out
+    class Profiler
+    {
+        public:
+            // Times the lifetime of the object
+            // Names must be string literals (or otherwise live forever) as only the pointer is stored
+            class Scope
+            {
+                public:
+                    Scope(const char* name) :
+                        m_name(name), m_start(Profiler::now())
+                    {};
+                    ~Scope() {
+                        Profiler::get().record(m_name, m_start, Profiler::now());
+                    }
+
+                    Scope(const Scope&) = delete;
+                    Scope& operator=(const Scope&) = delete;
+
+                private:
+                    const char* m_name;
+                    uint64_t m_start;
+            };
+
+            // Events kept per thread before the oldest ones are overwritten
+            static constexpr size_t EventsPerThread = 1 << 16;
+
+            static Profiler& get();
+
+            // Nanoseconds since the profiler was created
+            static uint64_t now();
+
+            void record(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds);
+            void setThreadName(const std::string_view& name);
+
+            void writeChromeTrace(const std::string& filePath);
+
+        private:
+            // Fields are atomic so the trace can be written while other threads are recording
+            struct Event
+            {
+                std::atomic<const char*> name;
+                std::atomic<uint64_t> start;
+                std::atomic<uint64_t> duration;
+            };
+
+            struct ThreadBuffer
+            {
+                uint32_t threadId;
+                std::string name;
+                std::atomic<uint64_t> writeIndex{0};
+                std::array<Event, EventsPerThread> events;
+            };
+
+            Profiler();
+
+            ThreadBuffer& getThreadBuffer();
+
+            std::chrono::steady_clock::time_point m_startTime;
+            std::mutex m_threadsMutex;
+            std::vector<std::shared_ptr<ThreadBuffer>> m_threads;
+    };
+}
+
+
+// Scoped timing macros, compiled out unless profiling is enabled
+#ifdef SIMPLE_RENDER_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ::Util::Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#endif